@@ -1,6 +1,9 @@
 #include "Config.h"
 
 #include <cstdlib>
+#include <sstream>
+
+#include <sched.h>
 
 Config::Config(int argc, char** argv)
 {
@@ -25,8 +28,37 @@ Config::Config(int argc, char** argv)
 
     enable_dc_spike_removal_ = true;
 
+    enable_zoom_fft_ = false;
+
+    bin_storage_ = "float";
+    slice_order_ = "linear";
+
+    affinity_ = "";
+    realtime_priority_ = 0;
+    fft_threads_ = 1;
+
+    history_depth_ = 64;
+
     font_path_ = "/usr/share/fonts/truetype/ttf-bitstream-vera";
 
+    occupancy_directory_ = "";
+    occupancy_margin_db_ = 6.0f;
+
+    stats_file_ = "";
+
+    control_socket_path_ = "";
+
+    iq_capture_directory_ = "";
+    iq_trigger_snr_db_ = 20.0f;
+    iq_record_directory_ = "";
+
+    publish_shm_name_ = "";
+    view_shm_name_ = "";
+
+    stream_port_ = 0;
+    stream_connect_host_ = "";
+    stream_connect_port_ = 0;
+
     argp_parse(&parser_, argc, argv, 0, 0, this);
 
     validateOptions();
@@ -64,6 +96,36 @@ error_t Config::parse(int key, char* arg)
         case 'x':
             enable_dc_spike_removal_ = strtoul(arg, NULL, 10);
             break;
+        case 'z':
+            enable_zoom_fft_ = strtoul(arg, NULL, 10);
+            break;
+        case 'b':
+            bin_storage_ = std::string(arg);
+            break;
+        case 'O':
+            slice_order_ = std::string(arg);
+            break;
+        case 'A':
+            affinity_ = std::string(arg);
+            break;
+        case 'R':
+            realtime_priority_ = strtol(arg, NULL, 10);
+            break;
+        case 'F':
+            fft_threads_ = strtol(arg, NULL, 10);
+            break;
+        case 'I':
+            iq_capture_directory_ = std::string(arg);
+            break;
+        case 'T':
+            iq_trigger_snr_db_ = strtof(arg, NULL);
+            break;
+        case 'W':
+            iq_record_directory_ = std::string(arg);
+            break;
+        case 'H':
+            history_depth_ = static_cast<uint16_t>(strtoul(arg, NULL, 10));
+            break;
         case 'p':
             device_prefix_ = std::string(arg);
             break;
@@ -76,6 +138,30 @@ error_t Config::parse(int key, char* arg)
         case 'f':
             font_path_ = std::string(arg);
             break;
+        case 'o':
+            occupancy_directory_ = std::string(arg);
+            break;
+        case 'm':
+            occupancy_margin_db_ = atof(arg);
+            break;
+        case 't':
+            stats_file_ = std::string(arg);
+            break;
+        case 'k':
+            control_socket_path_ = std::string(arg);
+            break;
+        case 'P':
+            publish_shm_name_ = std::string(arg);
+            break;
+        case 'V':
+            view_shm_name_ = std::string(arg);
+            break;
+        case 'S':
+            stream_port_ = static_cast<uint16_t>(strtoul(arg, NULL, 10));
+            break;
+        case 'C':
+            stream_connect_host_ = std::string(arg);     // split into host and port by validateOptions()
+            break;
 
         default:
             return ARGP_ERR_UNKNOWN;
@@ -105,6 +191,137 @@ void Config::validateOptions()
     {
         throw "Gain must be greater than or equal to 0.0";
     }
+
+    if (bin_storage_ != "float" && bin_storage_ != "int16" && bin_storage_ != "ema")
+    {
+        throw "Bin storage must be one of float, int16 or ema";
+    }
+
+    if (slice_order_ != "linear" && slice_order_ != "interleaved" && slice_order_ != "coarse")
+    {
+        throw "Slice order must be one of linear, interleaved or coarse";
+    }
+
+    // Each device takes the next group of cores, wrapping around if there are more devices than groups
+    std::istringstream affinity(affinity_);
+    std::string device_cores;
+    while (std::getline(affinity, device_cores, ':'))
+    {
+        device_cores_.push_back(std::vector<int>());
+        if ( ! parseCores(device_cores, device_cores_.back()))
+        {
+            throw "Affinity must be a list of cores (ie. 0,2,4-7) for each device, separated by colons";
+        }
+    }
+
+    if (realtime_priority_ < 0)
+    {
+        throw "Real-time priority must be greater than or equal to 0";
+    }
+
+    if (realtime_priority_ > sched_get_priority_max(SCHED_FIFO))
+    {
+        throw "Real-time priority is higher than SCHED_FIFO allows";
+    }
+
+    if (fft_threads_ < 1)
+    {
+        throw "FFT threads must be greater than or equal to 1";
+    }
+
+    if (fft_threads_ > UINT8_MAX)
+    {
+        throw "FFT threads must be less than or equal to 255";
+    }
+
+    if (occupancy_margin_db_ <= 0)
+    {
+        throw "Occupancy margin must be greater than 0.0";
+    }
+
+    if (iq_trigger_snr_db_ <= 0)
+    {
+        throw "IQ trigger SNR must be greater than 0.0";
+    }
+
+    if ( ! publish_shm_name_.empty() && ! view_shm_name_.empty())
+    {
+        throw "Cannot both publish to and view from shared memory";
+    }
+
+    if ( ! stream_connect_host_.empty())
+    {
+        size_t separator = stream_connect_host_.rfind(':');
+        if (separator == std::string::npos)
+        {
+            throw "Stream server must be given as HOST:PORT";
+        }
+
+        stream_connect_port_ = static_cast<uint16_t>(strtoul(stream_connect_host_.c_str() + separator + 1, NULL, 10));
+        stream_connect_host_.erase(separator);
+    }
+
+    if ( ! stream_connect_host_.empty() && ! view_shm_name_.empty())
+    {
+        throw "Cannot view from both shared memory and a stream server";
+    }
+
+    if ( ! stream_connect_host_.empty() && stream_connect_port_ == 0)
+    {
+        throw "Stream server port must be greater than 0";
+    }
+
+    // POSIX shared memory names must start with a slash
+    if ( ! publish_shm_name_.empty() && publish_shm_name_[0] != '/')
+    {
+        publish_shm_name_.insert(0, "/");
+    }
+
+    if ( ! view_shm_name_.empty() && view_shm_name_[0] != '/')
+    {
+        view_shm_name_.insert(0, "/");
+    }
+}
+
+bool Config::parseCores(const std::string& cores, std::vector<int>& parsed)
+{
+    std::istringstream stream(cores);
+    std::string range;
+
+    while (std::getline(stream, range, ','))
+    {
+        char* end = nullptr;
+        long first = strtol(range.c_str(), &end, 10);
+        long last = first;
+
+        if (end == range.c_str())
+        {
+            return false;
+        }
+
+        if (*end == '-')
+        {
+            const char* last_start = end + 1;
+            last = strtol(last_start, &end, 10);
+
+            if (end == last_start)
+            {
+                return false;
+            }
+        }
+
+        if (*end != '\0' || first < 0 || last < first || last >= CPU_SETSIZE)
+        {
+            return false;
+        }
+
+        for (long core = first; core <= last; core++)
+        {
+            parsed.push_back(static_cast<int>(core));
+        }
+    }
+
+    return ! parsed.empty();
 }
 
 std::string Config::getDevicePrefix()
@@ -152,6 +369,80 @@ bool Config::getDcSpikeRemoval()
     return enable_dc_spike_removal_;
 }
 
+bool Config::getZoomFft()
+{
+    return enable_zoom_fft_;
+}
+
+std::string Config::getBinStorage()
+{
+    return bin_storage_;
+}
+
+std::string Config::getSliceOrder()
+{
+    return slice_order_;
+}
+
+std::vector<int> Config::getDeviceCores(uint8_t device_id)
+{
+    if (device_cores_.empty())
+    {
+        return std::vector<int>();
+    }
+
+    return device_cores_[device_id % device_cores_.size()];
+}
+
+uint8_t Config::getRealtimePriority()
+{
+    return static_cast<uint8_t>(realtime_priority_);
+}
+
+uint8_t Config::getFftThreads()
+{
+    return static_cast<uint8_t>(fft_threads_);
+}
+
+uint16_t Config::getHistoryDepth()
+{
+    return history_depth_;
+}
+
+bool Config::setDwellTime(uint32_t dwell_time_us)
+{
+    if (dwell_time_us < 100000)
+    {
+        return false;
+    }
+
+    dwell_time_ = dwell_time_us;
+
+    return true;
+}
+
+bool Config::setGain(float gain)
+{
+    if (gain < 0)
+    {
+        return false;
+    }
+
+    gain_ = gain;
+
+    return true;
+}
+
+void Config::setAgc(bool enable_agc)
+{
+    enable_agc_ = enable_agc;
+}
+
+void Config::setDcSpikeRemoval(bool enable_dc_spike_removal)
+{
+    enable_dc_spike_removal_ = enable_dc_spike_removal;
+}
+
 uint16_t Config::getAveragingWindow()
 {
     return averaging_window_;
@@ -162,6 +453,66 @@ std::string Config::getFontPath()
     return font_path_;
 }
 
+std::string Config::getOccupancyDirectory()
+{
+    return occupancy_directory_;
+}
+
+float Config::getOccupancyMargin()
+{
+    return occupancy_margin_db_;
+}
+
+std::string Config::getStatsFile()
+{
+    return stats_file_;
+}
+
+std::string Config::getControlSocketPath()
+{
+    return control_socket_path_;
+}
+
+std::string Config::getIqCaptureDirectory()
+{
+    return iq_capture_directory_;
+}
+
+float Config::getIqTriggerSnr()
+{
+    return iq_trigger_snr_db_;
+}
+
+std::string Config::getIqRecordDirectory()
+{
+    return iq_record_directory_;
+}
+
+std::string Config::getPublishSharedMemory()
+{
+    return publish_shm_name_;
+}
+
+std::string Config::getViewSharedMemory()
+{
+    return view_shm_name_;
+}
+
+uint16_t Config::getStreamPort()
+{
+    return stream_port_;
+}
+
+std::string Config::getStreamConnectHost()
+{
+    return stream_connect_host_;
+}
+
+uint16_t Config::getStreamConnectPort()
+{
+    return stream_connect_port_;
+}
+
 argp Config::parser_ = {
         options_,
         parse_argument,
@@ -174,13 +525,31 @@ argp_option Config::options_[] = {
         {"end", 'e', "FREQUENCY", 0, "End scanning at this frequency in Hz (default 108000000 (108Mhz)", 0},
         {"sample_rate", 'r', "RATE", 0, "Hardware sample rate in Hz (default 2400000Hz (2.4Mhz))", 1},
         {"averaging_window", 'w', "COUNT", 0, "Number of samples to average FFT measurements over (default 4)", 1},
+        {"bin_storage", 'b', "MODE", 0, "Keep averaging history as float, int16 (0.01dB steps) or ema (no history) (default float)", 1},
+        {"slice_order", 'O', "ORDER", 0, "Visit slices in linear, interleaved or coarse order each sweep (default linear)", 1},
+        {"affinity", 'A', "CORES", 0, "Pin each device's sample thread and flowgraph to a group of cores, ie. 0-3:4-7 (default off)", 1},
+        {"realtime", 'R', "PRIORITY", 0, "Run sample threads and flowgraphs with this SCHED_FIFO priority (default 0 (off))", 1},
+        {"fft_threads", 'F', "COUNT", 0, "Spread each device's FFTs over this many threads, for high sample rates (default 1)", 1},
+        {"history", 'H', "SWEEPS", 0, "Keep this many completed sweeps for time-sliced views and export, 0 for none (default 64)", 1},
         {"dwell", 'd', "USEC", 0, "Dwell time per sampling slice in usec (default 500000 (0.5 sec))", 1},
         {"gain", 'g', "DB", 0, "Hardware gain (default 15.0)", 1},
         {"agc", 'a', "ON", 0, "Enable auto gain control (default 1 (on))", 1},
         {"despike", 'x', "ON", 0, "Enable DC spike removal (default 1 (on))", 1},
-        {"device_prefix", 'p', "STRING", 0, "Device prefix as known by osmosdr (default 'rtl')", 1},
+        {"zoom_fft", 'z', "ON", 0, "Decimate narrow spans before the FFT for finer frequency resolution (default 0 (off))", 1},
+        {"device_prefix", 'p', "STRING", 0, "Device prefix as known by osmosdr, or 'synthetic' for a generated test signal (default 'rtl')", 1},
         {"device_count", 'c', "COUNT", 0, "Use this many hardware devices to scan range (default 1)", 1},
         {"font_path", 'f', "STRING", 0, "Full path (excluding trailing slash) to where TTF fonts are stored", 2},
+        {"occupancy_dir", 'o', "STRING", 0, "Record hourly per-bin occupancy into files in this directory (default off)", 3},
+        {"occupancy_margin", 'm', "DB", 0, "Samples this far above the noise floor count as occupied (default 6.0)", 3},
+        {"stats_file", 't', "FILE", 0, "Periodically write sampler statistics to this file (default off)", 3},
+        {"control_socket", 'k', "PATH", 0, "Accept gain, agc, dwell and despike changes on this unix socket (default off)", 3},
+        {"iq_dir", 'I', "DIRECTORY", 0, "Write raw IQ around triggers to SigMF recordings in this directory (default off)", 3},
+        {"iq_trigger_snr", 'T', "DB", 0, "Bins this far above the noise floor trigger an IQ capture (default 20.0)", 3},
+        {"iq_record", 'W', "DIRECTORY", 0, "Continuously record every device's raw IQ to SigMF recordings in this directory (default off)", 3},
+        {"publish_shm", 'P', "NAME", 0, "Publish samples to this shared memory segment for other processes (default off)", 4},
+        {"view_shm", 'V', "NAME", 0, "View samples published to this shared memory segment instead of using capture devices", 4},
+        {"stream_port", 'S', "PORT", 0, "Stream samples to remote viewers connecting on this TCP port (default off)", 4},
+        {"stream_connect", 'C', "HOST:PORT", 0, "View samples streamed from this server instead of using capture devices", 4},
         0
 };
 
@@ -1,8 +1,10 @@
 #ifndef WAVEGUIDE_CONFIG_H
 #define WAVEGUIDE_CONFIG_H
 
+#include <atomic>
 #include <cstdint>
 #include <string>
+#include <vector>
 
 #include <argp.h>
 
@@ -25,14 +27,69 @@ public:
 
     bool getDcSpikeRemoval();
 
+    // The capture settings above can be changed while sampling (see sdr::SpectrumSampler), these return false if the
+    // new value is invalid.
+    bool setDwellTime(uint32_t dwell_time_us);
+    bool setGain(float gain);
+    void setAgc(bool enable_agc);
+    void setDcSpikeRemoval(bool enable_dc_spike_removal);
+
+    // Narrow spans are decimated before the FFT so that they get finer bins (see sdr::SpectrumSampler).
+    bool getZoomFft();
+
+    // How each bin keeps its sample history: "float", "int16" (quantized) or "ema" (no history).
+    std::string getBinStorage();
+
+    // Order slices are visited in each sweep: "linear" (low to high), "interleaved" (bit-reversed, so the whole range is
+    // covered coarsely early in each sweep) or "coarse" (every ~sqrt(n)th slice first, then the rest).
+    std::string getSliceOrder();
+
+    // Cores that device_id's flowgraph and sample thread are pinned to (empty if they aren't pinned).
+    std::vector<int> getDeviceCores(uint8_t device_id);
+
+    // SCHED_FIFO priority for the sample threads and their flowgraphs (0 leaves them with the default scheduler).
+    uint8_t getRealtimePriority();
+
+    // Number of threads each device's FFTs are spread over (1 runs them in a single chain).
+    uint8_t getFftThreads();
+
+    // Number of completed sweeps kept for time-sliced views and export (0 if off).
+    uint16_t getHistoryDepth();
+
     std::string getFontPath();
 
+    std::string getOccupancyDirectory();
+    float getOccupancyMargin();
+
+    std::string getStatsFile();
+
+    std::string getControlSocketPath();
+
+    // Directory to write triggered IQ captures to (empty if off), and the SNR above which a bin triggers a capture.
+    std::string getIqCaptureDirectory();
+    float getIqTriggerSnr();
+
+    // Directory to continuously record every device's raw IQ to (empty if off).
+    std::string getIqRecordDirectory();
+
+    // Names of the shared memory segments to publish samples to, or view samples from (in place of capture devices).
+    std::string getPublishSharedMemory();
+    std::string getViewSharedMemory();
+
+    // Port to stream samples to remote viewers on (0 if off), and the server to view streamed samples from.
+    uint16_t getStreamPort();
+    std::string getStreamConnectHost();
+    uint16_t getStreamConnectPort();
+
 private:
     static error_t parse_argument(int key, char *arg, struct argp_state* state);
     error_t parse(int key, char *arg);
 
     void validateOptions();
 
+    // Parses a list of cores such as "0,2,4-7", returns false if it's malformed.
+    static bool parseCores(const std::string& cores, std::vector<int>& parsed);
+
     uint8_t device_count_;
     std::string device_prefix_;
 
@@ -40,16 +97,47 @@ private:
     uint64_t start_frequency_;
     uint64_t end_frequency_;
 
-    uint32_t dwell_time_;
+    // Atomic as they can be changed from the control socket thread while sampler threads read them
+    std::atomic<uint32_t> dwell_time_;
     uint16_t averaging_window_;
 
-    float gain_;
-    bool enable_agc_;
+    std::atomic<float> gain_;
+    std::atomic<bool> enable_agc_;
+
+    std::atomic<bool> enable_dc_spike_removal_;
+
+    bool enable_zoom_fft_;
+
+    std::string bin_storage_;
+    std::string slice_order_;
+
+    std::string affinity_;                              // split into device_cores_ by validateOptions()
+    std::vector<std::vector<int>> device_cores_;
+    long realtime_priority_;                            // parsed wide so validateOptions() sees out of range values
+    long fft_threads_;
 
-    bool enable_dc_spike_removal_;
+    uint16_t history_depth_;
 
     std::string font_path_;
 
+    std::string occupancy_directory_;
+    float occupancy_margin_db_;
+
+    std::string stats_file_;
+
+    std::string control_socket_path_;
+
+    std::string iq_capture_directory_;
+    float iq_trigger_snr_db_;
+    std::string iq_record_directory_;
+
+    std::string publish_shm_name_;
+    std::string view_shm_name_;
+
+    uint16_t stream_port_;
+    std::string stream_connect_host_;
+    uint16_t stream_connect_port_;
+
     static argp parser_;
     static argp_option options_[];
 };
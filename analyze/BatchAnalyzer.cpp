@@ -0,0 +1,608 @@
+#include "BatchAnalyzer.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <memory>
+#include <limits>
+#include <map>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <gnuradio/fft/fft.h>
+
+#include "sdr/SampleThread.h"
+#include "sdr/SweepHistory.h"
+#include "scenario/SimpleSpectrum.h"
+
+// FFTs per chunk, ~0.4 seconds at 20MS/s. Large enough that scheduling is negligible, small enough that a single
+// recording spreads across every core.
+#define ANALYZE_CHUNK_FRAMES 1024
+
+// The sweeps output gets a row per chunk, with neighbouring bins averaged into at most this many columns.
+#define ANALYZE_SWEEP_MAX_COLUMNS 1024
+#define ANALYZE_SWEEP_MAX_ROWS 65535
+
+// Only the strongest peaks are listed.
+#define ANALYZE_MAX_PEAKS 100
+
+// Stands in for the log of an FFT bin with no power at all.
+#define ANALYZE_MIN_DB -200.0f
+
+// Gets the value following "key": in json between from and to (strings without their quotes), or an empty string.
+static std::string findValue(const std::string& json, const std::string& key, size_t from, size_t to)
+{
+    size_t position = json.find("\"" + key + "\"", from);
+    if (position == std::string::npos || position >= to)
+    {
+        return "";
+    }
+
+    // SigMF keys have colons of their own
+    position = json.find(':', position + key.size() + 2);
+    if (position == std::string::npos || position >= to)
+    {
+        return "";
+    }
+
+    size_t start = json.find_first_not_of(" \t\r\n", position + 1);
+    if (start == std::string::npos || start >= to)
+    {
+        return "";
+    }
+
+    if (json[start] == '"')
+    {
+        size_t end = json.find('"', start + 1);
+        return (end == std::string::npos) ? "" : json.substr(start + 1, end - start - 1);
+    }
+
+    size_t end = json.find_first_of(",}] \t\r\n", start);
+    return json.substr(start, std::min(end, to) - start);
+}
+
+// Parses a SigMF core:datetime (ie. 2020-01-01T12:00:00.000Z) into nanoseconds since the epoch, 0 if it can't.
+static int64_t parseDatetime(const std::string& datetime)
+{
+    struct tm time_tm;
+    memset(&time_tm, 0, sizeof(time_tm));
+    double secs = 0.0;
+
+    if (sscanf(datetime.c_str(), "%d-%d-%dT%d:%d:%lf", &time_tm.tm_year, &time_tm.tm_mon, &time_tm.tm_mday,
+               &time_tm.tm_hour, &time_tm.tm_min, &secs) != 6)
+    {
+        return 0;
+    }
+
+    time_tm.tm_year -= 1900;
+    time_tm.tm_mon -= 1;
+
+    return (static_cast<int64_t>(timegm(&time_tm)) * 1000000000) + static_cast<int64_t>(secs * 1000000000.0);
+}
+
+static bool endsWith(const std::string& value, const std::string& suffix)
+{
+    return value.size() >= suffix.size() && value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+analyze::BatchAnalyzer::BatchAnalyzer(const std::string& output_directory, float busy_margin_db, uint16_t averaging_window) :
+        output_directory_(output_directory), busy_margin_db_(busy_margin_db), averaging_window_(averaging_window)
+{
+    samples_analyzed_ = 0;
+    recorded_secs_ = 0.0;
+}
+
+analyze::BatchAnalyzer::~BatchAnalyzer()
+{
+    // Only those that were never run are left
+    for (Recording* recording : recordings_)
+    {
+        if (recording->data_)
+        {
+            munmap(const_cast<std::complex<float>*>(recording->data_), recording->mapped_bytes_);
+        }
+
+        if (recording->fd_ >= 0)
+        {
+            close(recording->fd_);
+        }
+
+        delete recording->samples_;
+        delete recording;
+    }
+}
+
+bool analyze::BatchAnalyzer::addRecording(const std::string& path)
+{
+    Recording* recording = new Recording();
+    recording->fd_ = -1;
+    recording->data_ = nullptr;
+    recording->mapped_bytes_ = 0;
+    recording->samples_ = nullptr;
+
+    recording->base_path_ = path;
+    for (const std::string suffix : {".sigmf-meta", ".sigmf-data"})
+    {
+        if (endsWith(recording->base_path_, suffix))
+        {
+            recording->base_path_.erase(recording->base_path_.size() - suffix.size());
+        }
+    }
+
+    size_t name_start = recording->base_path_.find_last_of('/');
+    recording->name_ = (name_start == std::string::npos) ? recording->base_path_ : recording->base_path_.substr(name_start + 1);
+
+    if ( ! readMetadata(recording) || ! mapData(recording))
+    {
+        delete recording;
+        return false;
+    }
+
+    // The bins cover every frequency the recording was tuned to
+    uint64_t half_bw_hz = recording->sample_rate_hz_ / 2;
+    uint64_t start_freq_hz = UINT64_MAX, end_freq_hz = 0;
+    for (const Segment& segment : recording->segments_)
+    {
+        start_freq_hz = std::min(start_freq_hz, segment.freq_hz_ - half_bw_hz);
+        end_freq_hz = std::max(end_freq_hz, segment.freq_hz_ + half_bw_hz);
+    }
+
+    recording->samples_ = new sdr::SpectrumSamples(start_freq_hz, end_freq_hz, recording->sample_rate_hz_, averaging_window_);
+    recording->fft_size_ = recording->samples_->getFFTSize();
+
+    uint64_t bin_count = recording->samples_->getBinCount();
+    recording->db_sums_.assign(bin_count, 0.0);
+    recording->max_db_.assign(bin_count, -std::numeric_limits<float>::infinity());
+    recording->frame_counts_.assign(bin_count, 0);
+    recording->busy_counts_.assign(bin_count, 0);
+    recording->noise_floor_sums_.assign(bin_count, 0.0);
+    recording->next_chunk_ = 0;
+    recording->coalesce_factor_ = static_cast<uint32_t>((bin_count + ANALYZE_SWEEP_MAX_COLUMNS - 1) / ANALYZE_SWEEP_MAX_COLUMNS);
+
+    // Long recordings get longer chunks, so that every chunk has a row in the sweeps output
+    uint64_t frame_count = 0;
+    for (const Segment& segment : recording->segments_)
+    {
+        frame_count += segment.sample_count_ / recording->fft_size_;
+    }
+
+    uint64_t frames_per_chunk = std::max<uint64_t>(ANALYZE_CHUNK_FRAMES, (frame_count + ANALYZE_SWEEP_MAX_ROWS - 1) / ANALYZE_SWEEP_MAX_ROWS);
+
+    uint32_t chunk_id = 0;
+    for (uint32_t segment = 0; segment < recording->segments_.size(); segment++)
+    {
+        uint64_t segment_frames = recording->segments_[segment].sample_count_ / recording->fft_size_;
+        for (uint64_t first_frame = 0; first_frame < segment_frames; first_frame += frames_per_chunk)
+        {
+            chunks_.push_back({recording, segment, first_frame, std::min(frames_per_chunk, segment_frames - first_frame), chunk_id++});
+        }
+    }
+
+    if ( ! chunk_id)
+    {
+        std::cerr << recording->name_ << " is shorter than a single FFT" << std::endl;
+        munmap(const_cast<std::complex<float>*>(recording->data_), recording->mapped_bytes_);
+        close(recording->fd_);
+        delete recording->samples_;
+        delete recording;
+        return false;
+    }
+
+    recording->chunk_count_ = chunk_id;
+    recording->chunks_remaining_ = chunk_id;
+    recording->chunk_rows_.resize(chunk_id);
+    recording->chunk_times_ns_.resize(chunk_id, 0);
+
+    recorded_secs_ += (frame_count * recording->fft_size_) / static_cast<double>(recording->sample_rate_hz_);
+    recordings_.push_back(recording);
+
+    return true;
+}
+
+void analyze::BatchAnalyzer::run(WorkStealingPool& pool)
+{
+    // Chunks are submitted in recording order, so each thread starts on a different part of the first recording
+    for (const Chunk& chunk : chunks_)
+    {
+        pool.submit([this, chunk]() {
+            analyzeChunk(chunk);
+        });
+    }
+
+    pool.wait();
+
+    chunks_.clear();
+    recordings_.clear();
+}
+
+uint32_t analyze::BatchAnalyzer::getRecordingCount()
+{
+    return static_cast<uint32_t>(recordings_.size());
+}
+
+uint64_t analyze::BatchAnalyzer::getSamplesAnalyzed()
+{
+    return samples_analyzed_.load(std::memory_order_relaxed);
+}
+
+double analyze::BatchAnalyzer::getRecordedSecs()
+{
+    return recorded_secs_;
+}
+
+bool analyze::BatchAnalyzer::readMetadata(Recording* recording)
+{
+    std::string meta_path = recording->base_path_ + ".sigmf-meta";
+
+    std::ifstream meta_file(meta_path);
+    if ( ! meta_file.is_open())
+    {
+        std::cerr << "Could not open " << meta_path << std::endl;
+        return false;
+    }
+
+    std::stringstream contents;
+    contents << meta_file.rdbuf();
+    std::string meta = contents.str();
+
+    // Samples are analyzed in place, so they must be in the format the recorders write
+    std::string datatype = findValue(meta, "core:datatype", 0, meta.size());
+    if (datatype != "cf32_le" && datatype != "cf32")
+    {
+        std::cerr << meta_path << " has " << (datatype.empty() ? "no" : datatype) << " samples, only cf32_le can be analyzed" << std::endl;
+        return false;
+    }
+
+    recording->sample_rate_hz_ = strtoull(findValue(meta, "core:sample_rate", 0, meta.size()).c_str(), NULL, 10);
+    if ( ! recording->sample_rate_hz_)
+    {
+        std::cerr << meta_path << " has no sample rate" << std::endl;
+        return false;
+    }
+
+    size_t captures_start = meta.find("\"captures\"");
+    size_t captures_end = (captures_start == std::string::npos) ? std::string::npos : meta.find(']', captures_start);
+
+    // Segment lengths are filled in once the length of the data is known
+    for (size_t position = meta.find('{', captures_start); captures_start != std::string::npos && position < captures_end; position = meta.find('{', position + 1))
+    {
+        size_t object_end = meta.find('}', position);
+
+        Segment segment;
+        segment.sample_start_ = strtoull(findValue(meta, "core:sample_start", position, object_end).c_str(), NULL, 10);
+        segment.sample_count_ = 0;
+        segment.freq_hz_ = strtoull(findValue(meta, "core:frequency", position, object_end).c_str(), NULL, 10);
+        segment.time_ns_ = parseDatetime(findValue(meta, "core:datetime", position, object_end));
+
+        // Without a frequency the recording is analyzed as baseband
+        segment.freq_hz_ = std::max(segment.freq_hz_, recording->sample_rate_hz_ / 2);
+
+        recording->segments_.push_back(segment);
+    }
+
+    if (recording->segments_.empty())
+    {
+        recording->segments_.push_back({0, 0, recording->sample_rate_hz_ / 2, 0});
+    }
+
+    std::sort(recording->segments_.begin(), recording->segments_.end(), [](const Segment& a, const Segment& b) {
+        return a.sample_start_ < b.sample_start_;
+    });
+
+    return true;
+}
+
+bool analyze::BatchAnalyzer::mapData(Recording* recording)
+{
+    std::string data_path = recording->base_path_ + ".sigmf-data";
+
+    recording->fd_ = open(data_path.c_str(), O_RDONLY);
+    if (recording->fd_ < 0)
+    {
+        std::cerr << "Could not open " << data_path << std::endl;
+        return false;
+    }
+
+    struct stat data_stat;
+    if (fstat(recording->fd_, &data_stat) != 0 || data_stat.st_size < static_cast<off_t>(sizeof(std::complex<float>)))
+    {
+        std::cerr << data_path << " is empty" << std::endl;
+        close(recording->fd_);
+        return false;
+    }
+
+    recording->mapped_bytes_ = data_stat.st_size;
+    void* mapping = mmap(nullptr, recording->mapped_bytes_, PROT_READ, MAP_SHARED, recording->fd_, 0);
+    if (mapping == MAP_FAILED)
+    {
+        std::cerr << "Could not map " << data_path << std::endl;
+        close(recording->fd_);
+        return false;
+    }
+
+    // Each chunk reads its part of the file once from start to end
+    madvise(mapping, recording->mapped_bytes_, MADV_SEQUENTIAL);
+    recording->data_ = static_cast<const std::complex<float>*>(mapping);
+
+    uint64_t sample_count = recording->mapped_bytes_ / sizeof(std::complex<float>);
+    for (size_t i = 0; i < recording->segments_.size(); i++)
+    {
+        Segment& segment = recording->segments_[i];
+        uint64_t end = (i + 1 < recording->segments_.size()) ? recording->segments_[i + 1].sample_start_ : sample_count;
+
+        segment.sample_start_ = std::min(segment.sample_start_, sample_count);
+        segment.sample_count_ = std::min(end, sample_count) - segment.sample_start_;
+    }
+
+    return true;
+}
+
+void analyze::BatchAnalyzer::analyzeChunk(const Chunk& chunk)
+{
+    Recording* recording = chunk.recording_;
+    const Segment& segment = recording->segments_[chunk.segment_];
+    sdr::SpectrumSamples* samples = recording->samples_;
+    uint32_t fft_size = recording->fft_size_;
+
+    // FFT plans are slow to create, so each thread keeps one per size
+    static thread_local std::map<uint32_t, std::unique_ptr<gr::fft::fft_complex>> ffts;
+    std::unique_ptr<gr::fft::fft_complex>& fft = ffts[fft_size];
+    if ( ! fft)
+    {
+        fft.reset(new gr::fft::fft_complex(fft_size, true, 1));
+    }
+
+    // Same window and scaling as the live flowgraph (see SampleThread)
+    std::vector<float> window = sdr::SampleThread::getWindow(fft_size);
+
+    float window_power = 0.0f;
+    for (float tap : window)
+    {
+        window_power += tap*tap;
+    }
+
+    float db_offset = -20 * log10(fft_size) - 10 * log10(window_power / fft_size);
+
+    // Bin each FFT output lands in once shifted to run from the lowest frequency, UINT64_MAX if it's outside the bins
+    uint64_t start_fft_freq_hz = segment.freq_hz_ - (recording->sample_rate_hz_ / 2);
+    std::vector<uint64_t> bins(fft_size);
+    for (uint32_t i = 0; i < fft_size; i++)
+    {
+        uint64_t bin = samples->getBinNumber(start_fft_freq_hz + static_cast<uint64_t>(i * samples->getBinBandwidth()));
+        bins[i] = (bin < samples->getBinCount()) ? bin : UINT64_MAX;
+    }
+
+    // Nothing is shared with the other chunks until the results are merged
+    ChunkResult result;
+    result.frame_count_ = chunk.frame_count_;
+    result.db_sums_.assign(fft_size, 0.0);
+    result.max_db_.assign(fft_size, -std::numeric_limits<float>::infinity());
+    result.busy_counts_.assign(fft_size, 0);
+    result.noise_floors_db_.assign(fft_size, 0.0f);
+
+    gr_complex* fft_in = fft->get_inbuf();
+    const gr_complex* fft_out = fft->get_outbuf();
+
+    const std::complex<float>* frame = recording->data_ + segment.sample_start_ + (chunk.first_frame_ * fft_size);
+    for (uint64_t f = 0; f < chunk.frame_count_; f++, frame += fft_size)
+    {
+        for (uint32_t i = 0; i < fft_size; i++)
+        {
+            fft_in[i] = frame[i] * window[i];
+        }
+
+        fft->execute();
+
+        for (uint32_t i = 0; i < fft_size; i++)
+        {
+            if (bins[i] == UINT64_MAX)
+            {
+                continue;
+            }
+
+            // The lowest frequency is in the middle of the FFT's output
+            float power = std::norm(fft_out[(i + (fft_size / 2)) % fft_size]);
+            float db = (power > 0.0f) ? (10 * log10(power)) + db_offset : ANALYZE_MIN_DB;
+
+            result.db_sums_[i] += db;
+            result.max_db_[i] = std::max(result.max_db_[i], db);
+
+            // The chunk's own estimate starts from its first frame, and settles well within ANALYZE_CHUNK_FRAMES
+            float& noise_floor_db = result.noise_floors_db_[i];
+            noise_floor_db = (f == 0) ? db : sdr::FrequencyBin::stepNoiseFloor(noise_floor_db, db);
+
+            // Counted against the noise floor as it stood, as live occupancy is
+            if (db - noise_floor_db >= busy_margin_db_)
+            {
+                result.busy_counts_[i]++;
+            }
+        }
+    }
+
+    // The chunk's row in the sweeps output
+    std::vector<float> column_sums((samples->getBinCount() + recording->coalesce_factor_ - 1) / recording->coalesce_factor_, 0.0f);
+    std::vector<uint32_t> column_counts(column_sums.size(), 0);
+    for (uint32_t i = 0; i < fft_size; i++)
+    {
+        if (bins[i] != UINT64_MAX)
+        {
+            column_sums[bins[i] / recording->coalesce_factor_] += result.db_sums_[i] / chunk.frame_count_;
+            column_counts[bins[i] / recording->coalesce_factor_]++;
+        }
+    }
+
+    std::vector<float> row(column_sums.size());
+    for (size_t column = 0; column < row.size(); column++)
+    {
+        row[column] = column_counts[column] ? column_sums[column] / column_counts[column] : NAN;
+    }
+
+    result.bins_ = std::move(bins);
+
+    {
+        std::lock_guard<std::mutex> guard(recording->lock_);
+
+        // Merged in chunk order whichever order the chunks finish in, so that the sums (and so the output) are the
+        // same from run to run
+        recording->finished_chunks_.emplace(chunk.chunk_id_, std::move(result));
+        auto next = recording->finished_chunks_.begin();
+        while (next != recording->finished_chunks_.end() && next->first == recording->next_chunk_)
+        {
+            mergeChunk(recording, next->second);
+            next = recording->finished_chunks_.erase(next);
+            recording->next_chunk_++;
+        }
+
+        recording->chunk_rows_[chunk.chunk_id_] = std::move(row);
+
+        if (segment.time_ns_)
+        {
+            recording->chunk_times_ns_[chunk.chunk_id_] = segment.time_ns_ + static_cast<int64_t>(((chunk.first_frame_ * fft_size) * 1000000000.0) / recording->sample_rate_hz_);
+        }
+    }
+
+    samples_analyzed_.fetch_add(chunk.frame_count_ * fft_size, std::memory_order_relaxed);
+
+    if (recording->chunks_remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        finishRecording(recording);
+    }
+}
+
+void analyze::BatchAnalyzer::mergeChunk(Recording* recording, const ChunkResult& result)
+{
+    for (size_t i = 0; i < result.bins_.size(); i++)
+    {
+        uint64_t bin = result.bins_[i];
+        if (bin == UINT64_MAX)
+        {
+            continue;
+        }
+
+        recording->db_sums_[bin] += result.db_sums_[i];
+        recording->max_db_[bin] = std::max(recording->max_db_[bin], result.max_db_[i]);
+        recording->frame_counts_[bin] += result.frame_count_;
+        recording->busy_counts_[bin] += result.busy_counts_[i];
+        recording->noise_floor_sums_[bin] += static_cast<double>(result.noise_floors_db_[i]) * result.frame_count_;
+    }
+}
+
+void analyze::BatchAnalyzer::finishRecording(Recording* recording)
+{
+    std::string output_base = output_directory_.empty() ? recording->base_path_ : output_directory_ + "/" + recording->name_;
+
+    writeSpectrum(recording, output_base + ".spectrum.csv");
+    writePeaks(recording, output_base + ".peaks.csv");
+    writeSweeps(recording, output_base + ".sweeps.csv");
+
+    munmap(const_cast<std::complex<float>*>(recording->data_), recording->mapped_bytes_);
+    close(recording->fd_);
+
+    delete recording->samples_;
+    delete recording;
+}
+
+void analyze::BatchAnalyzer::writeSpectrum(Recording* recording, const std::string& path)
+{
+    std::ofstream csv(path, std::ios::out | std::ios::trunc);
+    if ( ! csv.is_open())
+    {
+        std::cerr << "Could not write " << path << std::endl;
+        return;
+    }
+
+    sdr::SpectrumSamples* samples = recording->samples_;
+
+    csv << "freq_hz,mean_db,max_db,noise_floor_db,snr_db,duty_cycle\n";
+    for (uint64_t bin = 0; bin < samples->getBinCount(); bin++)
+    {
+        if ( ! recording->frame_counts_[bin])
+        {
+            continue;
+        }
+
+        float mean_db = recording->db_sums_[bin] / recording->frame_counts_[bin];
+        float noise_floor_db = recording->noise_floor_sums_[bin] / recording->frame_counts_[bin];
+
+        csv << samples->getBinFrequency(bin) << "," << mean_db << "," << recording->max_db_[bin] << "," << noise_floor_db << ","
+            << (mean_db - noise_floor_db) << "," << (recording->busy_counts_[bin] / static_cast<double>(recording->frame_counts_[bin])) << "\n";
+    }
+}
+
+void analyze::BatchAnalyzer::writePeaks(Recording* recording, const std::string& path)
+{
+    std::ofstream csv(path, std::ios::out | std::ios::trunc);
+    if ( ! csv.is_open())
+    {
+        std::cerr << "Could not write " << path << std::endl;
+        return;
+    }
+
+    sdr::SpectrumSamples* samples = recording->samples_;
+    uint64_t bin_count = samples->getBinCount();
+
+    std::vector<float> mean_db(bin_count, -std::numeric_limits<float>::infinity());
+    std::vector<float> noise_floors_db;
+    for (uint64_t bin = 0; bin < bin_count; bin++)
+    {
+        if (recording->frame_counts_[bin])
+        {
+            mean_db[bin] = recording->db_sums_[bin] / recording->frame_counts_[bin];
+            noise_floors_db.push_back(recording->noise_floor_sums_[bin] / recording->frame_counts_[bin]);
+        }
+    }
+
+    // A carrier that's on for the whole recording raises its own bin's noise floor to its level, so peaks are measured
+    // against the noise floor of the recording as a whole
+    std::nth_element(noise_floors_db.begin(), noise_floors_db.begin() + (noise_floors_db.size() / 2), noise_floors_db.end());
+    float noise_floor_db = noise_floors_db[noise_floors_db.size() / 2];
+
+    // Only local maxima are ranked, so that a strong signal spread over several bins is listed once
+    std::vector<float> maxima(bin_count, -std::numeric_limits<float>::infinity());
+    for (uint64_t bin = 0; bin < bin_count; bin++)
+    {
+        if ((bin == 0 || mean_db[bin] >= mean_db[bin - 1]) && (bin + 1 == bin_count || mean_db[bin] > mean_db[bin + 1]))
+        {
+            maxima[bin] = mean_db[bin] - noise_floor_db;
+        }
+    }
+
+    std::map<float, uint64_t> ranking;
+    SimpleSpectrum::rankLocalMaxima(maxima, busy_margin_db_, ranking);
+
+    csv << "rank,freq_hz,mean_db,snr_db,duty_cycle\n";
+
+    uint32_t rank = 1;
+    for (auto peak = ranking.rbegin(); peak != ranking.rend() && rank <= ANALYZE_MAX_PEAKS; peak++, rank++)
+    {
+        uint64_t bin = peak->second;
+        csv << rank << "," << samples->getBinFrequency(bin) << "," << mean_db[bin] << "," << peak->first << ","
+            << (recording->busy_counts_[bin] / static_cast<double>(recording->frame_counts_[bin])) << "\n";
+    }
+
+    std::cout << recording->name_ << ": " << ranking.size() << " peaks above " << busy_margin_db_ << "dB" << std::endl;
+}
+
+void analyze::BatchAnalyzer::writeSweeps(Recording* recording, const std::string& path)
+{
+    sdr::SpectrumSamples* samples = recording->samples_;
+
+    // Published in chunk order, whichever order they finished in (recordings with very many retunes keep the latest)
+    sdr::SweepHistory history(samples->getStartFrequency(), samples->getBinBandwidth(), samples->getBinCount(), recording->coalesce_factor_,
+                              static_cast<uint16_t>(std::min<uint32_t>(recording->chunk_count_, ANALYZE_SWEEP_MAX_ROWS)));
+
+    for (uint32_t chunk_id = 0; chunk_id < recording->chunk_count_; chunk_id++)
+    {
+        history.publish(chunk_id + 1, recording->chunk_times_ns_[chunk_id], recording->chunk_times_ns_[chunk_id], recording->chunk_rows_[chunk_id].data());
+    }
+
+    history.exportCsv(path);
+}
@@ -0,0 +1,132 @@
+#ifndef WAVEGUIDE_ANALYZE_BATCHANALYZER_H
+#define WAVEGUIDE_ANALYZE_BATCHANALYZER_H
+
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <complex>
+#include <cstdint>
+
+#include "sdr/SpectrumSamples.h"
+#include "WorkStealingPool.h"
+
+namespace analyze {
+
+    // Analyzes SigMF IQ recordings (ie. from --iq_dir or --iq_record) offline, as fast as the cores allow. Each
+    // recording is split into chunks of FFTs that run in parallel on a WorkStealingPool, with the same FFT, bins (a
+    // SpectrumSamples per recording) and noise floor estimator as a live capture. Each chunk accumulates into its own
+    // results, which are merged into the recording's in chunk order so that the output doesn't depend on scheduling.
+    // When its last chunk is merged a recording's results are written alongside it (or to the output directory) as:
+    //
+    //   NAME.spectrum.csv  mean, maximum, noise floor, SNR and duty cycle of every bin
+    //   NAME.peaks.csv     the strongest local maxima, ranked by how far they are above the recording's median noise
+    //                      floor (at least the busy margin)
+    //   NAME.sweeps.csv    the mean of each chunk as a sweep, in the same format as exported sweep history
+    class BatchAnalyzer {
+    public:
+        // Samples busy_margin_db above a bin's noise floor count towards its duty cycle (as with --occupancy_margin).
+        BatchAnalyzer(const std::string& output_directory, float busy_margin_db, uint16_t averaging_window);
+        ~BatchAnalyzer();
+
+        // Reads the recording's metadata (path is its .sigmf-meta or .sigmf-data), returns false if it can't be analyzed.
+        bool addRecording(const std::string& path);
+
+        // Analyzes every recording added on pool's threads, returning once all of their results are written.
+        void run(WorkStealingPool& pool);
+
+        // Recordings added and not yet run.
+        uint32_t getRecordingCount();
+        uint64_t getSamplesAnalyzed();
+
+        // Total length of the recordings analyzed, to compare against the time taken.
+        double getRecordedSecs();
+
+    private:
+        typedef struct
+        {
+            uint64_t sample_start_;
+            uint64_t sample_count_;
+            uint64_t freq_hz_;              // center frequency
+            int64_t time_ns_;               // when its first sample was captured (0 if unknown)
+        } Segment;
+
+        // A chunk's results, per FFT output, waiting to be merged into its recording's.
+        typedef struct
+        {
+            uint64_t frame_count_;
+            std::vector<uint64_t> bins_;    // bin each output lands in (UINT64_MAX if outside the bins)
+            std::vector<double> db_sums_;
+            std::vector<float> max_db_;
+            std::vector<uint64_t> busy_counts_;
+            std::vector<float> noise_floors_db_;    // estimated over the chunk alone
+        } ChunkResult;
+
+        struct Recording
+        {
+            std::string base_path_;         // without the .sigmf-meta or .sigmf-data
+            std::string name_;
+
+            uint64_t sample_rate_hz_;
+            std::vector<Segment> segments_;
+
+            int fd_;
+            const std::complex<float>* data_;   // the whole .sigmf-data file, memory mapped
+            size_t mapped_bytes_;
+
+            sdr::SpectrumSamples* samples_;
+            uint32_t fft_size_;
+            uint32_t chunk_count_;
+            std::atomic<uint32_t> chunks_remaining_;
+
+            std::mutex lock_;               // guards everything below, as each chunk merges its results
+            uint32_t next_chunk_;           // the next chunk to be merged
+            std::map<uint32_t, ChunkResult> finished_chunks_;   // finished ahead of next_chunk_, keyed by chunk id
+            std::vector<double> db_sums_;   // per bin
+            std::vector<float> max_db_;
+            std::vector<uint64_t> frame_counts_;
+            std::vector<uint64_t> busy_counts_;
+            std::vector<double> noise_floor_sums_;  // each chunk's noise floor weighted by its frames
+            uint32_t coalesce_factor_;      // bins averaged into each column of chunk_rows_
+            std::vector<std::vector<float>> chunk_rows_;
+            std::vector<int64_t> chunk_times_ns_;
+        };
+
+        typedef struct
+        {
+            Recording* recording_;
+            uint32_t segment_;
+            uint64_t first_frame_;          // counted from the start of the segment
+            uint64_t frame_count_;
+            uint32_t chunk_id_;
+        } Chunk;
+
+        bool readMetadata(Recording* recording);
+        bool mapData(Recording* recording);
+
+        void analyzeChunk(const Chunk& chunk);
+
+        // Adds a chunk's results to its recording's, with the recording locked.
+        void mergeChunk(Recording* recording, const ChunkResult& result);
+
+        // Writes a recording's results once its last chunk is done, then releases it.
+        void finishRecording(Recording* recording);
+        void writeSpectrum(Recording* recording, const std::string& path);
+        void writePeaks(Recording* recording, const std::string& path);
+        void writeSweeps(Recording* recording, const std::string& path);
+
+        std::string output_directory_;
+        float busy_margin_db_;
+        uint16_t averaging_window_;
+
+        std::vector<Recording*> recordings_;
+        std::vector<Chunk> chunks_;
+
+        std::atomic<uint64_t> samples_analyzed_;
+        double recorded_secs_;
+    };
+
+}
+
+#endif //WAVEGUIDE_ANALYZE_BATCHANALYZER_H
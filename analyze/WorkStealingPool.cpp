@@ -0,0 +1,166 @@
+#include "WorkStealingPool.h"
+
+#include <algorithm>
+
+// Index of the pool thread running on this thread (or -1 if it isn't one), so that tasks submitted by tasks are queued
+// where they were submitted.
+static thread_local int32_t current_thread_id = -1;
+
+analyze::WorkStealingPool::WorkStealingPool(uint32_t thread_count)
+{
+    thread_count = std::max<uint32_t>(thread_count, 1);
+
+    next_queue_ = 0;
+    tasks_queued_ = 0;
+    tasks_pending_ = 0;
+    stop_ = false;
+
+    tasks_run_ = 0;
+    tasks_stolen_ = 0;
+
+    for (uint32_t i = 0; i < thread_count; i++)
+    {
+        queues_.push_back(new Queue());
+    }
+
+    for (uint32_t i = 0; i < thread_count; i++)
+    {
+        threads_.push_back(new std::thread(&WorkStealingPool::run, this, i));
+    }
+}
+
+analyze::WorkStealingPool::~WorkStealingPool()
+{
+    wait();
+
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        stop_ = true;
+        task_queued_.notify_all();
+    }
+
+    for (std::thread* thread : threads_)
+    {
+        thread->join();
+        delete thread;
+    }
+
+    for (Queue* queue : queues_)
+    {
+        delete queue;
+    }
+}
+
+void analyze::WorkStealingPool::submit(std::function<void()> task)
+{
+    uint32_t queue_id = (current_thread_id >= 0) ? static_cast<uint32_t>(current_thread_id)
+                                                 : next_queue_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+
+    {
+        std::lock_guard<std::mutex> guard(queues_[queue_id]->lock_);
+        queues_[queue_id]->tasks_.push_back(std::move(task));
+    }
+
+    std::lock_guard<std::mutex> guard(lock_);
+    tasks_queued_++;
+    tasks_pending_++;
+    task_queued_.notify_one();
+}
+
+void analyze::WorkStealingPool::wait()
+{
+    std::unique_lock<std::mutex> guard(lock_);
+    tasks_finished_.wait(guard, [this]() {
+        return tasks_pending_ == 0;
+    });
+}
+
+uint32_t analyze::WorkStealingPool::getThreadCount()
+{
+    return static_cast<uint32_t>(threads_.size());
+}
+
+uint64_t analyze::WorkStealingPool::getTasksRun()
+{
+    return tasks_run_.load(std::memory_order_relaxed);
+}
+
+uint64_t analyze::WorkStealingPool::getTasksStolen()
+{
+    return tasks_stolen_.load(std::memory_order_relaxed);
+}
+
+void analyze::WorkStealingPool::run(uint32_t thread_id)
+{
+    current_thread_id = static_cast<int32_t>(thread_id);
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> guard(lock_);
+            task_queued_.wait(guard, [this]() {
+                return stop_ || tasks_queued_ > 0;
+            });
+
+            if (stop_)
+            {
+                break;
+            }
+        }
+
+        // Another thread may have taken the task that woke us, in which case we go back to waiting
+        std::function<void()> task;
+        if ( ! takeTask(thread_id, task))
+        {
+            continue;
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            tasks_queued_--;
+        }
+
+        task();
+        tasks_run_.fetch_add(1, std::memory_order_relaxed);
+
+        std::lock_guard<std::mutex> guard(lock_);
+        if (--tasks_pending_ == 0)
+        {
+            tasks_finished_.notify_all();
+        }
+    }
+}
+
+bool analyze::WorkStealingPool::takeTask(uint32_t thread_id, std::function<void()>& task)
+{
+    // Own tasks are run oldest first, as they were submitted in order (ie. successive chunks of a file)
+    {
+        Queue* queue = queues_[thread_id];
+        std::lock_guard<std::mutex> guard(queue->lock_);
+
+        if ( ! queue->tasks_.empty())
+        {
+            task = std::move(queue->tasks_.front());
+            queue->tasks_.pop_front();
+            return true;
+        }
+    }
+
+    // Stolen from the end furthest from the owner, so the two rarely contend for the same tasks
+    for (uint32_t i = 1; i < queues_.size(); i++)
+    {
+        Queue* queue = queues_[(thread_id + i) % queues_.size()];
+        std::lock_guard<std::mutex> guard(queue->lock_);
+
+        if ( ! queue->tasks_.empty())
+        {
+            task = std::move(queue->tasks_.back());
+            queue->tasks_.pop_back();
+
+            tasks_stolen_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,65 @@
+#ifndef WAVEGUIDE_ANALYZE_WORKSTEALINGPOOL_H
+#define WAVEGUIDE_ANALYZE_WORKSTEALINGPOOL_H
+
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+#include <cstdint>
+
+namespace analyze {
+
+    // Fixed pool of threads that each run tasks from their own queue, taking from the far end of another thread's
+    // queue when theirs is empty. Tasks are spread across the queues as they are submitted, so with similarly sized
+    // tasks threads rarely touch each other's queues, and when they do vary (ie. files of different lengths) idle
+    // threads take over the remaining work rather than waiting on the slowest thread.
+    class WorkStealingPool {
+    public:
+        WorkStealingPool(uint32_t thread_count);
+
+        // Waits for every task to run.
+        ~WorkStealingPool();
+
+        // Tasks may be submitted from any thread, including by tasks (which queue them on their own thread).
+        void submit(std::function<void()> task);
+
+        // Blocks until every task submitted so far (and any they submit) has run.
+        void wait();
+
+        uint32_t getThreadCount();
+        uint64_t getTasksRun();
+        uint64_t getTasksStolen();
+
+    private:
+        typedef struct
+        {
+            std::mutex lock_;
+            std::deque<std::function<void()>> tasks_;
+        } Queue;
+
+        void run(uint32_t thread_id);
+
+        // Takes the oldest task from thread_id's own queue, otherwise steals the newest from another thread.
+        bool takeTask(uint32_t thread_id, std::function<void()>& task);
+
+        std::vector<Queue*> queues_;
+        std::vector<std::thread*> threads_;
+        std::atomic<uint32_t> next_queue_;  // where tasks submitted from outside the pool are queued next
+
+        std::mutex lock_;                   // guards everything below
+        std::condition_variable task_queued_;
+        std::condition_variable tasks_finished_;
+        uint64_t tasks_queued_;             // waiting in a queue
+        uint64_t tasks_pending_;            // submitted but not yet finished running
+        bool stop_;
+
+        std::atomic<uint64_t> tasks_run_;
+        std::atomic<uint64_t> tasks_stolen_;
+    };
+
+}
+
+#endif //WAVEGUIDE_ANALYZE_WORKSTEALINGPOOL_H
@@ -0,0 +1,96 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+
+#include "BatchAnalyzer.h"
+#include "WorkStealingPool.h"
+
+// Same defaults as a live capture (see Config).
+#define DEFAULT_BUSY_MARGIN_DB 6.0f
+#define DEFAULT_AVERAGING_WINDOW 6
+
+static void usage()
+{
+    std::cerr << "Usage: waveguide_analyze [--threads N] [--margin DB] [--window COUNT] [--output DIR] RECORDING.sigmf-meta .." << std::endl;
+    std::cerr << "  Writes RECORDING.spectrum.csv, RECORDING.peaks.csv and RECORDING.sweeps.csv for each recording (next to it unless --output is given)." << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t thread_count = std::thread::hardware_concurrency();
+    float busy_margin_db = DEFAULT_BUSY_MARGIN_DB;
+    uint16_t averaging_window = DEFAULT_AVERAGING_WINDOW;
+    std::string output_directory;
+    std::vector<std::string> paths;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool has_value = (i + 1) < argc;
+
+        if (strcmp(argv[i], "--threads") == 0 && has_value)
+        {
+            thread_count = static_cast<uint32_t>(strtoul(argv[++i], NULL, 10));
+        }
+        else if (strcmp(argv[i], "--margin") == 0 && has_value)
+        {
+            busy_margin_db = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--window") == 0 && has_value)
+        {
+            averaging_window = static_cast<uint16_t>(strtoul(argv[++i], NULL, 10));
+        }
+        else if (strcmp(argv[i], "--output") == 0 && has_value)
+        {
+            output_directory = argv[++i];
+        }
+        else if (argv[i][0] == '-')
+        {
+            usage();
+            return -1;
+        }
+        else
+        {
+            paths.push_back(argv[i]);
+        }
+    }
+
+    if (paths.empty() || ! thread_count || busy_margin_db <= 0 || ! averaging_window)
+    {
+        usage();
+        return -1;
+    }
+
+    analyze::BatchAnalyzer analyzer(output_directory, busy_margin_db, averaging_window);
+    for (const std::string& path : paths)
+    {
+        if ( ! analyzer.addRecording(path))
+        {
+            std::cerr << "Skipping " << path << std::endl;
+        }
+    }
+
+    uint32_t recording_count = analyzer.getRecordingCount();
+    if ( ! recording_count)
+    {
+        return -1;
+    }
+
+    std::cout << "Analyzing " << recording_count << " recordings (" << analyzer.getRecordedSecs() << " seconds) on " << thread_count << " threads" << std::endl;
+
+    auto t_start = std::chrono::steady_clock::now();
+
+    analyze::WorkStealingPool pool(thread_count);
+    analyzer.run(pool);
+
+    double secs = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now() - t_start).count();
+
+    std::cout << "Analyzed " << analyzer.getSamplesAnalyzed() << " samples in " << secs << " seconds ("
+              << (analyzer.getSamplesAnalyzed() / (secs * 1e6)) << " MS/s, " << (analyzer.getRecordedSecs() / secs) << "x real time, "
+              << pool.getTasksStolen() << " of " << pool.getTasksRun() << " chunks stolen)" << std::endl;
+
+    return 0;
+}
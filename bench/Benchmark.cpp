@@ -0,0 +1,58 @@
+#include "Benchmark.h"
+
+#include <chrono>
+
+bench::Benchmark::Benchmark(std::ostream& output, double min_secs) : output_(output), min_secs_(min_secs)
+{
+}
+
+void bench::Benchmark::run(const std::string& name, uint64_t ops_per_call, std::function<void()> operation)
+{
+    // Warm up caches (and lazily allocated state) before timing anything
+    operation();
+
+    uint64_t calls = 0;
+    uint64_t calls_per_check = 1;
+    double elapsed_secs = 0.0;
+
+    auto t_start = std::chrono::steady_clock::now();
+
+    while (elapsed_secs < min_secs_)
+    {
+        for (uint64_t i = 0; i < calls_per_check; i++)
+        {
+            operation();
+        }
+
+        calls += calls_per_check;
+        elapsed_secs = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now() - t_start).count();
+
+        // Check the clock less often as it becomes clear how fast the operation is
+        if (elapsed_secs < min_secs_ / 10.0)
+        {
+            calls_per_check *= 2;
+        }
+    }
+
+    double ops = static_cast<double>(calls) * ops_per_call;
+
+    report(name, {
+            {"calls", static_cast<double>(calls)},
+            {"ops", ops},
+            {"secs", elapsed_secs},
+            {"ns_per_op", (elapsed_secs * 1e9) / ops},
+            {"ops_per_sec", ops / elapsed_secs}
+    });
+}
+
+void bench::Benchmark::report(const std::string& name, const std::map<std::string, double>& metrics)
+{
+    output_ << "{\"benchmark\": \"" << name << "\"";
+
+    for (auto& metric : metrics)
+    {
+        output_ << ", \"" << metric.first << "\": " << metric.second;
+    }
+
+    output_ << "}" << std::endl;
+}
@@ -0,0 +1,33 @@
+#ifndef WAVEGUIDE_BENCH_BENCHMARK_H
+#define WAVEGUIDE_BENCH_BENCHMARK_H
+
+#include <map>
+#include <string>
+#include <ostream>
+#include <functional>
+#include <cstdint>
+
+namespace bench {
+
+    // Times repeated operations and reports each result as a single line of JSON, so that runs can be collected and
+    // compared over time to spot regressions.
+    class Benchmark {
+    public:
+        Benchmark(std::ostream& output, double min_secs = 1.0);
+        ~Benchmark() = default;
+
+        // Calls operation repeatedly until at least min_secs_ have elapsed and reports the time per operation, where
+        // each call performs ops_per_call operations (ie. the number of bins updated).
+        void run(const std::string& name, uint64_t ops_per_call, std::function<void()> operation);
+
+        // Reports arbitrary named metrics (used by benchmarks that can't be expressed as a repeated operation).
+        void report(const std::string& name, const std::map<std::string, double>& metrics);
+
+    private:
+        std::ostream& output_;
+        double min_secs_;
+    };
+
+}
+
+#endif //WAVEGUIDE_BENCH_BENCHMARK_H
@@ -0,0 +1,174 @@
+#include "MacroBenchmarks.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+
+#include <gnuradio/top_block.h>
+#include <gnuradio/blocks/vector_source.h>
+#include <gnuradio/blocks/head.h>
+#include <gnuradio/blocks/stream_to_vector.h>
+#include <gnuradio/blocks/null_sink.h>
+
+#include "Config.h"
+#include "sdr/SpectrumSampler.h"
+#include "sdr/FftFanoutBlock.h"
+
+// Each device sweeps this many multiples of the sample rate, giving several retunes per sweep.
+#define BENCH_SLICES_PER_DEVICE 4
+
+// Shortest dwell Config allows, so that sweeps complete quickly.
+#define BENCH_DWELL_US "100000"
+
+// Samples pushed through the FFT chain at each number of threads (several seconds' worth at 50MS/s).
+#define BENCH_FANOUT_SAMPLES 200000000
+#define BENCH_FANOUT_VECTOR_LENGTH 8192
+#define BENCH_FANOUT_SOURCE_VECTORS 64
+
+bench::MacroBenchmarks::MacroBenchmarks(const std::vector<uint64_t>& sample_rates, const std::vector<uint8_t>& device_counts, double run_secs) :
+        sample_rates_(sample_rates), device_counts_(device_counts), run_secs_(run_secs)
+{
+}
+
+void bench::MacroBenchmarks::run(Benchmark& benchmark)
+{
+    for (uint64_t sample_rate_hz : sample_rates_)
+    {
+        for (uint8_t device_count : device_counts_)
+        {
+            runSampler(benchmark, sample_rate_hz, device_count);
+        }
+    }
+
+    for (uint32_t worker_count : {1, 2, 4, 8})
+    {
+        runFftFanout(benchmark, worker_count);
+    }
+}
+
+void bench::MacroBenchmarks::runSampler(Benchmark& benchmark, uint64_t sample_rate_hz, uint8_t device_count)
+{
+    uint64_t start_freq_hz = 100000000;
+    uint64_t end_freq_hz = start_freq_hz + (sample_rate_hz * BENCH_SLICES_PER_DEVICE * device_count);
+
+    std::string start_freq = std::to_string(start_freq_hz), end_freq = std::to_string(end_freq_hz);
+    std::string sample_rate = std::to_string(sample_rate_hz), devices = std::to_string(device_count);
+
+    // Config only knows how to parse a command line
+    const char* argv[] = {
+            "waveguide_bench", "-p", "synthetic", "-c", devices.c_str(), "-r", sample_rate.c_str(),
+            "-s", start_freq.c_str(), "-e", end_freq.c_str(), "-d", BENCH_DWELL_US
+    };
+    Config config(sizeof(argv) / sizeof(argv[0]), const_cast<char**>(argv));
+
+    sdr::SpectrumSampler sampler(&config);
+
+    auto t_start = std::chrono::steady_clock::now();
+    sampler.start(start_freq_hz, end_freq_hz);
+
+    // Time to first sweep includes opening the "devices", building the flowgraphs and a full sweep of every slice
+    double first_sweep_secs = -1.0;
+    double elapsed_secs = 0.0;
+
+    while (elapsed_secs < run_secs_)
+    {
+        // Woken as soon as every device completes the first sweep rather than on the next poll
+        bool first_sweep_completed = false;
+        if (first_sweep_secs < 0)
+        {
+            first_sweep_completed = sampler.getSamples()->waitForCompletedSweep(0, 10);
+        }
+        else
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        elapsed_secs = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now() - t_start).count();
+
+        if (first_sweep_completed)
+        {
+            first_sweep_secs = elapsed_secs;
+        }
+    }
+
+    uint64_t sweeps = sampler.getSamples()->getCompletedSweepCount();
+    uint64_t bin_count = sampler.getSamples()->getBinCount();
+
+    // Devices start in parallel, so startup is as slow as the slowest device at each stage
+    double open_device_ms = 0.0, build_flowgraph_ms = 0.0, start_flowgraph_ms = 0.0;
+    for (sdr::SampleThread::StartupTimings& timings : sampler.getStartupTimings())
+    {
+        open_device_ms = std::max(open_device_ms, timings.open_device_ms_);
+        build_flowgraph_ms = std::max(build_flowgraph_ms, timings.build_flowgraph_ms_);
+        start_flowgraph_ms = std::max(start_flowgraph_ms, timings.start_flowgraph_ms_);
+    }
+
+    uint64_t vectors_received = 0, vectors_discarded = 0, vectors_lost = 0, retune_latency_p99_us = 0;
+    for (uint8_t i = 0; i < sampler.getDeviceCount(); i++)
+    {
+        sdr::SamplerStats* stats = sampler.getStats(i);
+
+        vectors_received += stats->getVectorsReceived();
+        vectors_discarded += stats->getVectorsDiscarded();
+        vectors_lost += stats->getVectorsLost();
+        retune_latency_p99_us = std::max(retune_latency_p99_us, stats->getRetuneLatency().getPercentile(0.99f));
+    }
+
+    sampler.stop();
+
+    benchmark.report("sampler_synthetic", {
+            {"sample_rate_hz", static_cast<double>(sample_rate_hz)},
+            {"device_count", static_cast<double>(device_count)},
+            {"bin_count", static_cast<double>(bin_count)},
+            {"secs", elapsed_secs},
+            {"open_device_ms", open_device_ms},
+            {"build_flowgraph_ms", build_flowgraph_ms},
+            {"start_flowgraph_ms", start_flowgraph_ms},
+            {"first_sweep_secs", first_sweep_secs},
+            {"sweeps", static_cast<double>(sweeps)},
+            {"sweeps_per_sec", sweeps / elapsed_secs},
+            {"vectors_per_sec", vectors_received / elapsed_secs},
+            {"vectors_discarded", static_cast<double>(vectors_discarded)},
+            {"vectors_lost", static_cast<double>(vectors_lost)},
+            {"retune_latency_p99_us", static_cast<double>(retune_latency_p99_us)}
+    });
+}
+
+void bench::MacroBenchmarks::runFftFanout(Benchmark& benchmark, uint32_t worker_count)
+{
+    // Noise repeated from memory, so that generating samples costs as little as possible
+    std::mt19937 generator(1);
+    std::normal_distribution<float> noise(0.0f, 0.1f);
+
+    std::vector<gr_complex> source_samples(BENCH_FANOUT_VECTOR_LENGTH * BENCH_FANOUT_SOURCE_VECTORS);
+    for (gr_complex& sample : source_samples)
+    {
+        sample = gr_complex(noise(generator), noise(generator));
+    }
+
+    gr::top_block_sptr top_block = gr::make_top_block("fft_fanout");
+
+    gr::blocks::vector_source_c::sptr source = gr::blocks::vector_source_c::make(source_samples, true);
+    gr::blocks::head::sptr head = gr::blocks::head::make(sizeof(gr_complex), BENCH_FANOUT_SAMPLES);
+    gr::blocks::stream_to_vector::sptr stream_to_vec = gr::blocks::stream_to_vector::make(sizeof(gr_complex), BENCH_FANOUT_VECTOR_LENGTH);
+    sdr::FftFanoutBlock::sptr fft = sdr::FftFanoutBlock::make(BENCH_FANOUT_VECTOR_LENGTH, sdr::SampleThread::getWindow(BENCH_FANOUT_VECTOR_LENGTH), worker_count);
+    gr::blocks::null_sink::sptr sink = gr::blocks::null_sink::make(sizeof(float) * BENCH_FANOUT_VECTOR_LENGTH);
+
+    top_block->connect(source, 0, head, 0);
+    top_block->connect(head, 0, stream_to_vec, 0);
+    top_block->connect(stream_to_vec, 0, fft, 0);
+    top_block->connect(fft, 0, sink, 0);
+
+    auto t_start = std::chrono::steady_clock::now();
+    top_block->run();
+    double secs = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now() - t_start).count();
+
+    benchmark.report("fft_fanout", {
+            {"worker_count", static_cast<double>(worker_count)},
+            {"samples", static_cast<double>(BENCH_FANOUT_SAMPLES)},
+            {"secs", secs},
+            {"samples_per_sec", BENCH_FANOUT_SAMPLES / secs}
+    });
+}
@@ -0,0 +1,35 @@
+#ifndef WAVEGUIDE_BENCH_MACROBENCHMARKS_H
+#define WAVEGUIDE_BENCH_MACROBENCHMARKS_H
+
+#include <vector>
+#include <cstdint>
+
+#include "Benchmark.h"
+
+namespace bench {
+
+    // Runs the complete sampler (sdr::SpectrumSampler and its sdr::SampleThread flowgraphs) against the synthetic
+    // capture device at each combination of sample rate and device count, and the FFT chain on its own at each number
+    // of FFT threads.
+    class MacroBenchmarks {
+    public:
+        MacroBenchmarks(const std::vector<uint64_t>& sample_rates, const std::vector<uint8_t>& device_counts, double run_secs);
+        ~MacroBenchmarks() = default;
+
+        void run(Benchmark& benchmark);
+
+    private:
+        void runSampler(Benchmark& benchmark, uint64_t sample_rate_hz, uint8_t device_count);
+
+        // Pushes a fixed number of samples through an sdr::FftFanoutBlock as fast as it takes them, giving the highest
+        // sample rate a single device could sustain with this many FFT threads.
+        void runFftFanout(Benchmark& benchmark, uint32_t worker_count);
+
+        std::vector<uint64_t> sample_rates_;
+        std::vector<uint8_t> device_counts_;
+        double run_secs_;
+    };
+
+}
+
+#endif //WAVEGUIDE_BENCH_MACROBENCHMARKS_H
@@ -0,0 +1,349 @@
+#include "MicroBenchmarks.h"
+
+#include <vector>
+#include <random>
+#include <map>
+#include <chrono>
+#include <algorithm>
+#include <fstream>
+
+#include <thread>
+#include <complex>
+#include <cstdlib>
+
+#include <unistd.h>
+#include <dirent.h>
+
+#include "sdr/FrequencyBin.h"
+#include "sdr/SpectrumSamples.h"
+#include "sdr/VectorSinkBlock.h"
+#include "sdr/IqRecorder.h"
+#include "scenario/SimpleSpectrum.h"
+#include "scenario/SimpleSpectrumRange.h"
+
+// Spectrum used by the micro benchmarks, 20MHz at 3MS/s gives ~54000 bins.
+#define BENCH_START_FREQ_HZ 88000000
+#define BENCH_END_FREQ_HZ 108000000
+#define BENCH_SAMPLE_RATE_HZ 3000000
+#define BENCH_HISTORY_SIZE 6
+
+// Span used to compare lazy and eager bin allocation, 500MHz at 3MS/s gives ~1.4M bins.
+#define BENCH_WIDE_END_FREQ_HZ 588000000
+
+// IQ recording at the rate the recorder is meant to sustain, appended in chunks the size a source block delivers.
+#define BENCH_IQ_RECORD_RATE 20000000
+#define BENCH_IQ_RECORD_SECS 2.0
+#define BENCH_IQ_RECORD_CHUNK 8192
+
+// Pre-generated amplitudes are cycled through so that random number generation isn't timed.
+#define BENCH_AMPLITUDE_COUNT 65536
+
+// Gets the resident memory of this process from /proc (in MB).
+static double getResidentMemoryMb()
+{
+    uint64_t size_pages = 0, resident_pages = 0;
+
+    std::ifstream statm("/proc/self/statm");
+    statm >> size_pages >> resident_pages;
+
+    return (resident_pages * sysconf(_SC_PAGESIZE)) / (1024.0 * 1024.0);
+}
+
+static std::vector<float> generateAmplitudes(size_t count)
+{
+    std::mt19937 generator(1234);
+    std::normal_distribution<float> noise(-80.0f, 5.0f);
+
+    std::vector<float> amplitudes(count);
+    for (float& amplitude : amplitudes)
+    {
+        amplitude = noise(generator);
+    }
+
+    return amplitudes;
+}
+
+void bench::MicroBenchmarks::run(Benchmark& benchmark)
+{
+    // First, before other benchmarks have freed memory that the allocator could hand back without growing RSS
+    runBinAllocation(benchmark);
+    runFrequencyBin(benchmark);
+    runSpectrumSamples(benchmark);
+    runVectorSink(benchmark);
+    runCoalescing(benchmark);
+    runMarkLocalMaxima(benchmark);
+    runIqRecorder(benchmark, "iq_recorder_paced", BENCH_IQ_RECORD_RATE);
+    runIqRecorder(benchmark, "iq_recorder_saturated", 0);
+}
+
+void bench::MicroBenchmarks::runFrequencyBin(Benchmark& benchmark)
+{
+    std::vector<float> amplitudes = generateAmplitudes(BENCH_AMPLITUDE_COUNT);
+
+    std::map<std::string, sdr::FrequencyBin::StorageMode> storage_modes = {
+            {"", sdr::FrequencyBin::STORAGE_FLOAT},
+            {"_int16", sdr::FrequencyBin::STORAGE_INT16},
+            {"_ema", sdr::FrequencyBin::STORAGE_EMA}
+    };
+
+    for (auto& storage_mode : storage_modes)
+    {
+        sdr::FrequencyBin bin(BENCH_START_FREQ_HZ, BENCH_HISTORY_SIZE, storage_mode.second);
+
+        benchmark.run("frequency_bin_set_latest_amplitude" + storage_mode.first, amplitudes.size(), [&]() {
+            for (float amplitude : amplitudes)
+            {
+                bin.setLatestAmplitude(amplitude, true);
+            }
+        });
+    }
+
+    // Memory per bin for a typical averaging window and the deepest one in common use
+    for (uint16_t history_size : {BENCH_HISTORY_SIZE, 16})
+    {
+        benchmark.report("frequency_bin_bytes_history" + std::to_string(history_size), {
+                {"float", static_cast<double>(sdr::FrequencyBin::getBytesPerBin(history_size, sdr::FrequencyBin::STORAGE_FLOAT))},
+                {"int16", static_cast<double>(sdr::FrequencyBin::getBytesPerBin(history_size, sdr::FrequencyBin::STORAGE_INT16))},
+                {"ema", static_cast<double>(sdr::FrequencyBin::getBytesPerBin(history_size, sdr::FrequencyBin::STORAGE_EMA))}
+        });
+    }
+}
+
+void bench::MicroBenchmarks::runSpectrumSamples(Benchmark& benchmark)
+{
+    std::vector<float> amplitudes = generateAmplitudes(BENCH_AMPLITUDE_COUNT);
+    sdr::SpectrumSamples samples(BENCH_START_FREQ_HZ, BENCH_END_FREQ_HZ, BENCH_SAMPLE_RATE_HZ, BENCH_HISTORY_SIZE);
+    sdr::SpectrumSamples int16_samples(BENCH_START_FREQ_HZ, BENCH_END_FREQ_HZ, BENCH_SAMPLE_RATE_HZ, BENCH_HISTORY_SIZE, 1, sdr::FrequencyBin::STORAGE_INT16);
+    sdr::SpectrumSamples ema_samples(BENCH_START_FREQ_HZ, BENCH_END_FREQ_HZ, BENCH_SAMPLE_RATE_HZ, BENCH_HISTORY_SIZE, 1, sdr::FrequencyBin::STORAGE_EMA);
+
+    uint64_t bin_count = samples.getBinCount();
+    double bin_bw_hz = samples.getBinBandwidth();
+
+    std::vector<uint64_t> frequencies(bin_count);
+    for (uint64_t i = 0; i < bin_count; i++)
+    {
+        frequencies[i] = BENCH_START_FREQ_HZ + static_cast<uint64_t>(i * bin_bw_hz);
+    }
+
+    benchmark.run("spectrum_samples_set_latest_sample", bin_count, [&]() {
+        for (uint64_t i = 0; i < bin_count; i++)
+        {
+            samples.setLatestSample(frequencies[i], amplitudes[i % BENCH_AMPLITUDE_COUNT], 0);
+        }
+    });
+
+    benchmark.run("spectrum_samples_set_latest_sample_int16", bin_count, [&]() {
+        for (uint64_t i = 0; i < bin_count; i++)
+        {
+            int16_samples.setLatestSample(frequencies[i], amplitudes[i % BENCH_AMPLITUDE_COUNT], 0);
+        }
+    });
+
+    benchmark.run("spectrum_samples_set_latest_sample_ema", bin_count, [&]() {
+        for (uint64_t i = 0; i < bin_count; i++)
+        {
+            ema_samples.setLatestSample(frequencies[i], amplitudes[i % BENCH_AMPLITUDE_COUNT], 0);
+        }
+    });
+
+    volatile uint64_t sink = 0;
+    benchmark.run("spectrum_samples_get_bin_number", bin_count, [&]() {
+        for (uint64_t i = 0; i < bin_count; i++)
+        {
+            sink = samples.getBinNumber(frequencies[i]);
+        }
+    });
+}
+
+void bench::MicroBenchmarks::runBinAllocation(Benchmark& benchmark)
+{
+    // Eager goes first for the same reason, as it is the mode whose RSS growth matters
+    for (bool eager : {true, false})
+    {
+        double rss_before_mb = getResidentMemoryMb();
+        auto t_start = std::chrono::steady_clock::now();
+
+        sdr::SpectrumSamples* samples = new sdr::SpectrumSamples(BENCH_START_FREQ_HZ, BENCH_WIDE_END_FREQ_HZ, BENCH_SAMPLE_RATE_HZ, BENCH_HISTORY_SIZE);
+        if (eager)
+        {
+            samples->allocateAllBins();
+        }
+
+        double construct_ms = std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(std::chrono::steady_clock::now() - t_start).count();
+        double rss_constructed_mb = getResidentMemoryMb() - rss_before_mb;
+
+        // Then write every bin once, as the first sweep would
+        uint64_t bin_count = samples->getBinCount();
+        for (uint64_t i = 0; i < bin_count; i++)
+        {
+            samples->setLatestSampleForBin(i, -80.0f, 0);
+        }
+
+        double first_sweep_ms = std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(std::chrono::steady_clock::now() - t_start).count();
+        double rss_swept_mb = getResidentMemoryMb() - rss_before_mb;
+
+        delete samples;
+
+        benchmark.report(eager ? "spectrum_samples_allocation_eager" : "spectrum_samples_allocation_lazy", {
+                {"bin_count", static_cast<double>(bin_count)},
+                {"construct_ms", construct_ms},
+                {"first_sweep_ms", first_sweep_ms},
+                {"rss_constructed_mb", rss_constructed_mb},
+                {"rss_first_sweep_mb", rss_swept_mb}
+        });
+    }
+}
+
+void bench::MicroBenchmarks::runVectorSink(Benchmark& benchmark)
+{
+    sdr::SpectrumSamples samples(BENCH_START_FREQ_HZ, BENCH_END_FREQ_HZ, BENCH_SAMPLE_RATE_HZ, BENCH_HISTORY_SIZE);
+    size_t vector_length = samples.getFFTSize();
+
+    std::vector<float> amplitudes = generateAmplitudes(vector_length);
+    sdr::VectorSinkBlock::sptr vector_sink = sdr::VectorSinkBlock::make("bench_vector_sink", vector_length, samples.getBinBandwidth(), &samples);
+
+    // Same slice geometry as an intermediate slice in sdr::SampleThread (the outer sixths of the FFT are discarded)
+    uint64_t tune_freq_hz = BENCH_START_FREQ_HZ + BENCH_SAMPLE_RATE_HZ;
+    uint64_t start_fft_freq_hz = tune_freq_hz - (BENCH_SAMPLE_RATE_HZ / 2);
+    vector_sink->setCurrentFrequencyRange(start_fft_freq_hz, start_fft_freq_hz + (BENCH_SAMPLE_RATE_HZ / 6), tune_freq_hz + (BENCH_SAMPLE_RATE_HZ / 2) - (BENCH_SAMPLE_RATE_HZ / 6));
+
+    benchmark.run("vector_sink_update_samples", vector_length, [&]() {
+        vector_sink->updateSamples(amplitudes.data());
+    });
+}
+
+void bench::MicroBenchmarks::runCoalescing(Benchmark& benchmark)
+{
+    sdr::SpectrumSamples samples(BENCH_START_FREQ_HZ, BENCH_END_FREQ_HZ, BENCH_SAMPLE_RATE_HZ, BENCH_HISTORY_SIZE);
+    samples.allocateAllBins();
+
+    uint64_t bin_count = samples.getBinCount();
+
+    // The coalesce factors used by the scenarios by default
+    for (uint32_t coalesce_factor : {80, 600, 1000})
+    {
+        volatile float sink = 0.0f;
+        benchmark.run("coalesce_amplitude_x" + std::to_string(coalesce_factor), bin_count, [&]() {
+            for (uint64_t start_bin = 0; start_bin < bin_count; start_bin += coalesce_factor)
+            {
+                sink = SimpleSpectrumRange::coalesceAmplitude(&samples, start_bin, std::min<uint64_t>(coalesce_factor, bin_count - start_bin));
+            }
+        });
+    }
+
+    // As the scenarios update each frame, where only the tuned slice has been written to since the last frame and the
+    // ranges over the rest of the spectrum are skipped by their generation
+    std::vector<float> amplitudes = generateAmplitudes(samples.getFFTSize());
+    for (uint32_t coalesce_factor : {80, 600, 1000})
+    {
+        std::vector<uint64_t> generations((bin_count + coalesce_factor - 1) / coalesce_factor, 0);
+        uint64_t tuned_bin = 0;
+
+        volatile float sink = 0.0f;
+        benchmark.run("coalesce_amplitude_changed_x" + std::to_string(coalesce_factor), bin_count, [&]() {
+            for (uint32_t i = 0; i < amplitudes.size(); i++)
+            {
+                samples.setLatestSampleForBin((tuned_bin + i) % bin_count, amplitudes[i], 0);
+            }
+
+            // As the sink marks each vector it writes, in two parts if it wrapped around
+            uint64_t first_part = std::min<uint64_t>(amplitudes.size(), bin_count - tuned_bin);
+            samples.markBinsWritten(tuned_bin, first_part);
+            samples.markBinsWritten(0, amplitudes.size() - first_part);
+            tuned_bin = (tuned_bin + amplitudes.size()) % bin_count;
+
+            for (uint64_t start_bin = 0, range = 0; start_bin < bin_count; start_bin += coalesce_factor, range++)
+            {
+                uint64_t frequency_bin_count = std::min<uint64_t>(coalesce_factor, bin_count - start_bin);
+                uint64_t generation = samples.getGeneration(start_bin, frequency_bin_count);
+                if (generation != generations[range])
+                {
+                    generations[range] = generation;
+                    sink = SimpleSpectrumRange::coalesceAmplitude(&samples, start_bin, frequency_bin_count);
+                }
+            }
+        });
+    }
+}
+
+void bench::MicroBenchmarks::runMarkLocalMaxima(Benchmark& benchmark)
+{
+    // Coalesced amplitudes are offset so that -100dB == 0, see SimpleSpectrumRange::getAmplitude()
+    for (size_t range_count : {64, 1024, 16384})
+    {
+        std::vector<float> amplitudes = generateAmplitudes(range_count);
+        for (float& amplitude : amplitudes)
+        {
+            amplitude = (amplitude + 100.0f) / 2.0f;
+        }
+
+        benchmark.run("rank_local_maxima_" + std::to_string(range_count), range_count, [&]() {
+            std::map<float, uint64_t> ranking;
+            SimpleSpectrum::rankLocalMaxima(amplitudes, 10.0f, ranking);
+        });
+    }
+}
+
+void bench::MicroBenchmarks::runIqRecorder(Benchmark& benchmark, const std::string& name, uint64_t samples_per_sec)
+{
+    // Recorded under TMPDIR (which should be on the disk being measured, not tmpfs) and removed afterwards
+    const char* tmp_dir = getenv("TMPDIR");
+    std::string directory = std::string(tmp_dir ? tmp_dir : "/tmp") + "/waveguide_bench_XXXXXX";
+    if ( ! mkdtemp(&directory[0]))
+    {
+        throw "Could not create a directory to record IQ to";
+    }
+
+    std::vector<std::complex<float>> chunk(BENCH_IQ_RECORD_CHUNK, std::complex<float>(0.5f, -0.5f));
+
+    sdr::SamplerStats stats;
+    sdr::IqRecorder* recorder = new sdr::IqRecorder(directory, 0, BENCH_IQ_RECORD_RATE, &stats);
+    recorder->markRetune(BENCH_START_FREQ_HZ);
+
+    uint64_t samples_appended = 0;
+    auto t_start = std::chrono::steady_clock::now();
+    double elapsed_secs = 0.0;
+
+    while (elapsed_secs < BENCH_IQ_RECORD_SECS)
+    {
+        recorder->append(chunk.data(), chunk.size());
+        samples_appended += chunk.size();
+
+        if (samples_per_sec)
+        {
+            std::this_thread::sleep_until(t_start + std::chrono::nanoseconds((samples_appended * 1000000000) / samples_per_sec));
+        }
+
+        elapsed_secs = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now() - t_start).count();
+    }
+
+    // Includes writing out the buffers still queued
+    delete recorder;
+    double total_secs = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now() - t_start).count();
+
+    benchmark.report(name, {
+            {"secs", total_secs},
+            {"appended_msps", samples_appended / (elapsed_secs * 1e6)},
+            {"written_mb_per_sec", stats.getIqBytesWritten() / (total_secs * 1024 * 1024)},
+            {"write_p99_us", static_cast<double>(stats.getIqWriteLatency().getPercentile(0.99f))},
+            {"stalls", static_cast<double>(stats.getIqStalls())},
+            {"samples_dropped", static_cast<double>(stats.getIqSamplesDropped())}
+    });
+
+    DIR* dir = opendir(directory.c_str());
+    if (dir)
+    {
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != nullptr)
+        {
+            if (entry->d_name[0] != '.')
+            {
+                unlink((directory + "/" + entry->d_name).c_str());
+            }
+        }
+
+        closedir(dir);
+    }
+
+    rmdir(directory.c_str());
+}
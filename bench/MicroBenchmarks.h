@@ -0,0 +1,32 @@
+#ifndef WAVEGUIDE_BENCH_MICROBENCHMARKS_H
+#define WAVEGUIDE_BENCH_MICROBENCHMARKS_H
+
+#include <string>
+#include <cstdint>
+
+#include "Benchmark.h"
+
+namespace bench {
+
+    // Benchmarks the individual hot paths of sample ingest and scene updates in isolation. This is a friend of the
+    // sdr classes so that it can drive their private ingest methods directly.
+    class MicroBenchmarks {
+    public:
+        static void run(Benchmark& benchmark);
+
+    private:
+        static void runFrequencyBin(Benchmark& benchmark);
+        static void runSpectrumSamples(Benchmark& benchmark);
+        static void runBinAllocation(Benchmark& benchmark);
+        static void runVectorSink(Benchmark& benchmark);
+        static void runCoalescing(Benchmark& benchmark);
+        static void runMarkLocalMaxima(Benchmark& benchmark);
+
+        // Records IQ to a temporary directory at samples_per_sec (0 appends as fast as possible, which measures how
+        // fast the disk is written).
+        static void runIqRecorder(Benchmark& benchmark, const std::string& name, uint64_t samples_per_sec);
+    };
+
+}
+
+#endif //WAVEGUIDE_BENCH_MICROBENCHMARKS_H
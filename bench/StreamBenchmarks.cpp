@@ -0,0 +1,116 @@
+#include "StreamBenchmarks.h"
+
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <random>
+#include <iostream>
+
+#include "sdr/SpectrumStreamServer.h"
+#include "sdr/SpectrumStreamClient.h"
+
+// Same geometry as a 20MHz scan at 3MS/s, with each slice covering the middle two thirds of an 8192 bin FFT.
+#define BENCH_START_FREQ_HZ 88000000
+#define BENCH_END_FREQ_HZ 108000000
+#define BENCH_SAMPLE_RATE_HZ 3000000
+#define BENCH_BIN_BW_HZ 366.0
+#define BENCH_BIN_COUNT 54614
+#define BENCH_SLICE_BINS 5461
+
+// Roughly a 100ms dwell across 4 devices.
+#define BENCH_PACED_SLICES_PER_SEC 40
+
+bench::StreamBenchmarks::StreamBenchmarks(double run_secs) : run_secs_(run_secs)
+{
+}
+
+void bench::StreamBenchmarks::run(Benchmark& benchmark)
+{
+    runLoopback(benchmark, "stream_loopback_paced", BENCH_PACED_SLICES_PER_SEC);
+    runLoopback(benchmark, "stream_loopback_saturated", 0);
+}
+
+void bench::StreamBenchmarks::runLoopback(Benchmark& benchmark, const std::string& name, uint32_t slices_per_sec)
+{
+    sdr::SpectrumStreamServer server(0);
+    if ( ! server.isListening())
+    {
+        throw "Could not start stream server";
+    }
+
+    server.setRange(BENCH_START_FREQ_HZ, BENCH_END_FREQ_HZ, BENCH_SAMPLE_RATE_HZ, BENCH_BIN_BW_HZ, BENCH_BIN_COUNT);
+
+    sdr::SpectrumStreamClient client("127.0.0.1", server.getPort());
+    if ( ! client.isConnected())
+    {
+        throw "Could not connect to stream server";
+    }
+
+    uint64_t bins_received = 0;
+    client.start([&bins_received](uint64_t, uint32_t bin_count, uint64_t, const float*) {
+        bins_received += bin_count;
+    });
+
+    // The server only publishes to clients it has accepted
+    while (server.getClientCount() == 0)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    // Noise around -80dB that changes every sweep, so that deltas are realistic
+    std::mt19937 generator(1234);
+    std::normal_distribution<float> noise(-80.0f, 3.0f);
+    std::vector<std::vector<float>> sweeps(4, std::vector<float>(BENCH_BIN_COUNT));
+    for (auto& sweep : sweeps)
+    {
+        for (float& amplitude : sweep)
+        {
+            amplitude = noise(generator);
+        }
+    }
+
+    uint64_t slices_published = 0, sweep_count = 0, start_bin = 0;
+    auto t_start = std::chrono::steady_clock::now();
+    double elapsed_secs = 0.0;
+
+    while (elapsed_secs < run_secs_)
+    {
+        uint32_t bin_count = static_cast<uint32_t>(std::min(static_cast<uint64_t>(BENCH_SLICE_BINS), BENCH_BIN_COUNT - start_bin));
+        server.publishSlice(start_bin, bin_count, sweep_count, sweeps[sweep_count % sweeps.size()].data() + start_bin);
+        slices_published++;
+
+        start_bin += bin_count;
+        if (start_bin >= BENCH_BIN_COUNT)
+        {
+            start_bin = 0;
+            sweep_count++;
+        }
+
+        if (slices_per_sec)
+        {
+            std::this_thread::sleep_until(t_start + std::chrono::microseconds((slices_published * 1000000) / slices_per_sec));
+        }
+
+        elapsed_secs = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now() - t_start).count();
+    }
+
+    // Let the last frames drain
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    client.stop();
+
+    uint64_t frames_received = client.getFramesReceived();
+
+    benchmark.report(name, {
+            {"secs", elapsed_secs},
+            {"slices_published", static_cast<double>(slices_published)},
+            {"frames_sent", static_cast<double>(server.getFramesSent())},
+            {"frames_dropped", static_cast<double>(server.getFramesDropped())},
+            {"frames_received_per_sec", frames_received / elapsed_secs},
+            {"bins_received_per_sec", bins_received / elapsed_secs},
+            {"megabytes_per_sec", client.getBytesReceived() / elapsed_secs / 1000000.0},
+            {"bytes_per_bin", bins_received ? static_cast<double>(client.getBytesReceived()) / bins_received : 0.0},
+            {"latency_p50_us", static_cast<double>(client.getLatency().getPercentile(0.5f))},
+            {"latency_p99_us", static_cast<double>(client.getLatency().getPercentile(0.99f))},
+            {"latency_max_us", static_cast<double>(client.getLatency().getMaximum())}
+    });
+}
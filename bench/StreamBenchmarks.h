@@ -0,0 +1,27 @@
+#ifndef WAVEGUIDE_BENCH_STREAMBENCHMARKS_H
+#define WAVEGUIDE_BENCH_STREAMBENCHMARKS_H
+
+#include <cstdint>
+
+#include "Benchmark.h"
+
+namespace bench {
+
+    // Streams synthetic slices from a SpectrumStreamServer to a SpectrumStreamClient over 127.0.0.1, reporting
+    // throughput, end to end latency and how many stale frames the server dropped.
+    class StreamBenchmarks {
+    public:
+        StreamBenchmarks(double run_secs);
+
+        void run(Benchmark& benchmark);
+
+    private:
+        // Publishes slices_per_sec slices a second (0 publishes as fast as possible).
+        void runLoopback(Benchmark& benchmark, const std::string& name, uint32_t slices_per_sec);
+
+        double run_secs_;
+    };
+
+}
+
+#endif //WAVEGUIDE_BENCH_STREAMBENCHMARKS_H
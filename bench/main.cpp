@@ -0,0 +1,132 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+
+#include "Benchmark.h"
+#include "MicroBenchmarks.h"
+#include "MacroBenchmarks.h"
+#include "StreamBenchmarks.h"
+
+static void usage()
+{
+    std::cerr << "Usage: waveguide_bench [--micro] [--macro] [--stream] [--secs SECS] [--rates HZ,HZ,..] [--devices N,N,..] [--output FILE]" << std::endl;
+    std::cerr << "  Results are written as one JSON object per line (to stdout unless --output is given)." << std::endl;
+}
+
+template <typename T>
+static std::vector<T> parseList(const char* list)
+{
+    std::vector<T> values;
+    std::stringstream stream(list);
+    std::string value;
+
+    while (std::getline(stream, value, ','))
+    {
+        values.push_back(static_cast<T>(strtoull(value.c_str(), NULL, 10)));
+    }
+
+    return values;
+}
+
+int main(int argc, char** argv)
+{
+    bool run_micro = false, run_macro = false, run_stream = false;
+    double secs = 1.0;
+    double macro_secs = 10.0;
+    std::vector<uint64_t> sample_rates = {2400000, 3000000};
+    std::vector<uint8_t> device_counts = {1, 2};
+    std::string output_path;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool has_value = (i + 1) < argc;
+
+        if (strcmp(argv[i], "--micro") == 0)
+        {
+            run_micro = true;
+        }
+        else if (strcmp(argv[i], "--macro") == 0)
+        {
+            run_macro = true;
+        }
+        else if (strcmp(argv[i], "--stream") == 0)
+        {
+            run_stream = true;
+        }
+        else if (strcmp(argv[i], "--secs") == 0 && has_value)
+        {
+            secs = macro_secs = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--rates") == 0 && has_value)
+        {
+            sample_rates = parseList<uint64_t>(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--devices") == 0 && has_value)
+        {
+            device_counts = parseList<uint8_t>(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--output") == 0 && has_value)
+        {
+            output_path = argv[++i];
+        }
+        else
+        {
+            usage();
+            return -1;
+        }
+    }
+
+    if ( ! run_micro && ! run_macro && ! run_stream)
+    {
+        run_micro = true;
+    }
+
+    // The sampler logs progress to std::cout, keep that away from the results so they stay machine readable
+    std::ofstream output_file;
+    std::ostream results(std::cout.rdbuf());
+    std::cout.rdbuf(std::cerr.rdbuf());
+
+    if ( ! output_path.empty())
+    {
+        output_file.open(output_path, std::ios::out | std::ios::trunc);
+        if ( ! output_file.is_open())
+        {
+            std::cerr << "Could not open " << output_path << std::endl;
+            return -1;
+        }
+
+        results.rdbuf(output_file.rdbuf());
+    }
+
+    try
+    {
+        if (run_micro)
+        {
+            bench::Benchmark benchmark(results, secs);
+            bench::MicroBenchmarks::run(benchmark);
+        }
+
+        if (run_macro)
+        {
+            bench::Benchmark benchmark(results);
+            bench::MacroBenchmarks(sample_rates, device_counts, macro_secs).run(benchmark);
+        }
+
+        if (run_stream)
+        {
+            bench::Benchmark benchmark(results);
+            bench::StreamBenchmarks(macro_secs).run(benchmark);
+        }
+    }
+    catch (const char* error)
+    {
+        std::cerr << error << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
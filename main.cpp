@@ -15,6 +15,7 @@
 #include "scenario/circular/CircularSpectrum.h"
 #include "scenario/linear/LinearTimeSpectrum.h"
 #include "scenario/cylindrical/CylindricalSpectrum.h"
+#include "scenario/occupancy/OccupancySpectrum.h"
 #include "scenario/help/Help.h"
 
 #define WINDOW_FULLSCREEN false
@@ -86,6 +87,7 @@ int main(int argc, char** argv)
     }
 
     scenarios.initialise(window_manager);
+    scenarios.setSampler(sampler);
 
     scenarios.addScenario(new Help(display_manager, WINDOW_X_SIZE, WINDOW_Y_SIZE));
     scenarios.addScenario(new LinearSpectrum(window_manager, sampler, 1000));
@@ -94,6 +96,7 @@ int main(int argc, char** argv)
     scenarios.addScenario(new SphereSpectrum(window_manager, sampler, 600));
     scenarios.addScenario(new CylindricalSpectrum(window_manager, sampler, 600));
     scenarios.addScenario(new CircularSpectrum(window_manager, sampler, 80));
+    scenarios.addScenario(new OccupancySpectrum(window_manager, sampler, 1000));
 
     scenarios.nextScenario();
 
@@ -0,0 +1,211 @@
+#include "BinPickingIndex.h"
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+// Upper bound on the number of cells along any axis (keeps the grid small for very large scenes).
+#define MAX_CELLS_PER_AXIS 64
+
+// Aim for roughly this many ranges per occupied cell.
+#define RANGES_PER_CELL 4
+
+BinPickingIndex::BinPickingIndex()
+{
+    clear();
+}
+
+void BinPickingIndex::clear()
+{
+    ranges_.clear();
+    positions_.clear();
+    cells_.clear();
+
+    cell_size_ = 1.0f;
+    cell_counts_[0] = cell_counts_[1] = cell_counts_[2] = 0;
+    pick_radius_ = 0.0f;
+}
+
+size_t BinPickingIndex::size()
+{
+    return ranges_.size();
+}
+
+int64_t BinPickingIndex::getCellIndex(int64_t x, int64_t y, int64_t z)
+{
+    return (z * cell_counts_[1] + y) * cell_counts_[0] + x;
+}
+
+void BinPickingIndex::build(const std::vector<SimpleSpectrumRange*>& ranges, float pick_radius)
+{
+    clear();
+
+    if (ranges.empty())
+    {
+        return;
+    }
+
+    ranges_ = ranges;
+    pick_radius_ = pick_radius;
+
+    positions_.reserve(ranges_.size());
+    for (SimpleSpectrumRange* range : ranges_)
+    {
+        positions_.push_back(range->getPosition());
+    }
+
+    min_coords_ = max_coords_ = positions_[0];
+    for (const glm::vec3& position : positions_)
+    {
+        for (int axis = 0; axis < 3; axis++)
+        {
+            min_coords_[axis] = std::min(min_coords_[axis], position[axis] - pick_radius_);
+            max_coords_[axis] = std::max(max_coords_[axis], position[axis] + pick_radius_);
+        }
+    }
+
+    // Size cells from the longest axis so that flat or linear layouts don't end up with many empty cells
+    float longest_extent = std::max(max_coords_.x - min_coords_.x, std::max(max_coords_.y - min_coords_.y, max_coords_.z - min_coords_.z));
+    float resolution = std::min(static_cast<float>(MAX_CELLS_PER_AXIS), std::max(1.0f, ceilf(cbrtf(ranges_.size() / static_cast<float>(RANGES_PER_CELL)))));
+
+    cell_size_ = std::max(longest_extent / resolution, 2.0f * pick_radius_);
+
+    for (int axis = 0; axis < 3; axis++)
+    {
+        cell_counts_[axis] = std::max(static_cast<int64_t>(1), static_cast<int64_t>(ceilf((max_coords_[axis] - min_coords_[axis]) / cell_size_)));
+    }
+
+    cells_.resize(cell_counts_[0] * cell_counts_[1] * cell_counts_[2]);
+
+    // Each range goes into every cell its bounding sphere overlaps
+    for (uint32_t i = 0; i < positions_.size(); i++)
+    {
+        int64_t low[3], high[3];
+        for (int axis = 0; axis < 3; axis++)
+        {
+            low[axis] = static_cast<int64_t>(floorf((positions_[i][axis] - pick_radius_ - min_coords_[axis]) / cell_size_));
+            high[axis] = static_cast<int64_t>(floorf((positions_[i][axis] + pick_radius_ - min_coords_[axis]) / cell_size_));
+
+            low[axis] = std::max(static_cast<int64_t>(0), std::min(low[axis], cell_counts_[axis] - 1));
+            high[axis] = std::max(static_cast<int64_t>(0), std::min(high[axis], cell_counts_[axis] - 1));
+        }
+
+        for (int64_t z = low[2]; z <= high[2]; z++)
+        {
+            for (int64_t y = low[1]; y <= high[1]; y++)
+            {
+                for (int64_t x = low[0]; x <= high[0]; x++)
+                {
+                    cells_[getCellIndex(x, y, z)].push_back(i);
+                }
+            }
+        }
+    }
+}
+
+SimpleSpectrumRange* BinPickingIndex::pick(const glm::vec3& ray_origin, const glm::vec3& ray_direction)
+{
+    if (ranges_.empty() || glm::length(ray_direction) == 0.0f)
+    {
+        return nullptr;
+    }
+
+    const float infinity = std::numeric_limits<float>::infinity();
+    glm::vec3 direction = glm::normalize(ray_direction);
+
+    // Clip the ray against the bounds of the grid
+    float t_enter = 0.0f, t_exit = infinity;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        if (fabsf(direction[axis]) < 1e-9f)
+        {
+            if (ray_origin[axis] < min_coords_[axis] || ray_origin[axis] > max_coords_[axis])
+            {
+                return nullptr;
+            }
+
+            continue;
+        }
+
+        float t1 = (min_coords_[axis] - ray_origin[axis]) / direction[axis];
+        float t2 = (max_coords_[axis] - ray_origin[axis]) / direction[axis];
+
+        t_enter = std::max(t_enter, std::min(t1, t2));
+        t_exit = std::min(t_exit, std::max(t1, t2));
+    }
+
+    if (t_enter > t_exit)
+    {
+        return nullptr;
+    }
+
+    // Walk the cells along the ray (Amanatides & Woo) starting with the cell it enters the grid through
+    glm::vec3 entry = ray_origin + (direction * t_enter);
+    int64_t cell[3], step[3];
+    float t_max[3], t_delta[3];
+
+    for (int axis = 0; axis < 3; axis++)
+    {
+        cell[axis] = static_cast<int64_t>(floorf((entry[axis] - min_coords_[axis]) / cell_size_));
+        cell[axis] = std::max(static_cast<int64_t>(0), std::min(cell[axis], cell_counts_[axis] - 1));
+
+        if (fabsf(direction[axis]) < 1e-9f)
+        {
+            step[axis] = 0;
+            t_max[axis] = t_delta[axis] = infinity;
+            continue;
+        }
+
+        step[axis] = direction[axis] > 0 ? 1 : -1;
+
+        float boundary = min_coords_[axis] + ((cell[axis] + (step[axis] > 0 ? 1 : 0)) * cell_size_);
+        t_max[axis] = (boundary - ray_origin[axis]) / direction[axis];
+        t_delta[axis] = cell_size_ / fabsf(direction[axis]);
+    }
+
+    float radius_squared = pick_radius_ * pick_radius_;
+
+    SimpleSpectrumRange* nearest = nullptr;
+    float nearest_t = infinity;
+
+    while (cell[0] >= 0 && cell[0] < cell_counts_[0] && cell[1] >= 0 && cell[1] < cell_counts_[1] && cell[2] >= 0 && cell[2] < cell_counts_[2])
+    {
+        float cell_exit_t = std::min(t_max[0], std::min(t_max[1], t_max[2]));
+
+        for (uint32_t i : cells_[getCellIndex(cell[0], cell[1], cell[2])])
+        {
+            glm::vec3 to_center = positions_[i] - ray_origin;
+            float t_closest = glm::dot(to_center, direction);
+            float distance_squared = glm::dot(to_center, to_center) - (t_closest * t_closest);
+
+            if (t_closest < 0 || distance_squared > radius_squared)
+            {
+                continue;
+            }
+
+            float t_hit = t_closest - sqrtf(radius_squared - distance_squared);
+            if (t_hit < nearest_t)
+            {
+                nearest = ranges_[i];
+                nearest_t = t_hit;
+            }
+        }
+
+        // A hit beyond this cell could still be beaten by a range in a cell we haven't visited yet
+        if (nearest && nearest_t <= cell_exit_t)
+        {
+            return nearest;
+        }
+
+        int axis = (t_max[0] < t_max[1]) ? (t_max[0] < t_max[2] ? 0 : 2) : (t_max[1] < t_max[2] ? 1 : 2);
+        if (t_max[axis] == infinity)
+        {
+            break;
+        }
+
+        cell[axis] += step[axis];
+        t_max[axis] += t_delta[axis];
+    }
+
+    return nearest;
+}
@@ -0,0 +1,40 @@
+#ifndef WAVEGUIDE_SCENARIO_BINPICKINGINDEX_H
+#define WAVEGUIDE_SCENARIO_BINPICKINGINDEX_H
+
+#include <vector>
+#include <cstdint>
+
+#include "SimpleSpectrumRange.h"
+
+// Uniform grid over the positions of SimpleSpectrumRanges, used to ray cast (pick) the range under the mouse without
+// testing every range in the scene. Ranges are treated as spheres of pick_radius around their position.
+class BinPickingIndex {
+public:
+    BinPickingIndex();
+    ~BinPickingIndex() = default;
+
+    void build(const std::vector<SimpleSpectrumRange*>& ranges, float pick_radius);
+    void clear();
+
+    // Number of ranges that were indexed by the last build().
+    size_t size();
+
+    // Walks the grid cells along the ray and returns the nearest range it passes through (or nullptr).
+    SimpleSpectrumRange* pick(const glm::vec3& ray_origin, const glm::vec3& ray_direction);
+
+private:
+    int64_t getCellIndex(int64_t x, int64_t y, int64_t z);
+
+    std::vector<SimpleSpectrumRange*> ranges_;
+    std::vector<glm::vec3> positions_;
+    std::vector<std::vector<uint32_t>> cells_;     // indices into ranges_
+
+    glm::vec3 min_coords_;
+    glm::vec3 max_coords_;
+    float cell_size_;
+    int64_t cell_counts_[3];
+
+    float pick_radius_;
+};
+
+#endif //WAVEGUIDE_SCENARIO_BINPICKINGINDEX_H
@@ -3,8 +3,8 @@
 RotatedSpectrumRange::RotatedSpectrumRange(insight::DisplayManager* display_manager, insight::primitive::Primitive::Type type, uint16_t ring_id, uint64_t bin_id,
                                        const glm::vec3& world_coords, double theta_offset, double rad_per_ring, double radius,
                                        const glm::vec3& colour,
-                                       const std::vector<sdr::FrequencyBin const*>& frequency_bins) :
-        SimpleSpectrumRange(display_manager, type, ring_id, bin_id, world_coords, colour, frequency_bins),
+                                       sdr::SpectrumSamples* samples, uint64_t first_frequency_bin, uint64_t frequency_bin_count) :
+        SimpleSpectrumRange(display_manager, type, ring_id, bin_id, world_coords, colour, samples, first_frequency_bin, frequency_bin_count),
         ring_id_(ring_id),
         theta_offset_(theta_offset), rad_per_ring_(rad_per_ring), radius_(radius)
 {
@@ -18,7 +18,7 @@ void RotatedSpectrumRange::setEnableRotationAroundY(bool enabled)
 
 void RotatedSpectrumRange::draw(GLfloat secs_since_rendering_started, GLfloat secs_since_framequeue_started, GLfloat secs_since_last_renderloop, GLfloat secs_since_last_frame, bool use_colour)
 {
-    if ( ! const_cast<sdr::FrequencyBin*>(frequency_bins_[0])->getHasBeenSet(2))
+    if (hidden_ || ! samples_->getHasBeenSet(first_frequency_bin_, 2))
     {
         return;
     }
@@ -30,15 +30,15 @@ void RotatedSpectrumRange::update(GLfloat secs_since_rendering_started, GLfloat
 {
     uint16_t current_ring_id = *(static_cast<uint16_t*>(context));
 
-    // If this bin doesn't belong to the ring currently being rendered, exit early.
-    if (current_ring_id != ring_id_)
+    // If this bin doesn't belong to the ring currently being rendered, or nothing it shows has changed, exit early.
+    if (current_ring_id != ring_id_ || hidden_ || ! takeChanged())
     {
         return;
     }
 
     float amplitude = getAmplitude(true);
 
-//  std::cout << const_cast<sdr::FrequencyBin*>(frequency_bins_[0])->getFrequency() << "Hz: " << average_amplitude << "dB (" << adjusted_amplitude << " adjusted dB)" << std::endl;
+//  std::cout << samples_->getBinFrequency(first_frequency_bin_) << "Hz: " << average_amplitude << "dB (" << adjusted_amplitude << " adjusted dB)" << std::endl;
 
     float x_to = (radius_ + amplitude) * cos(theta_offset_);
     float y_to = (radius_ + amplitude) * sin(theta_offset_);
@@ -8,7 +8,7 @@ public:
     RotatedSpectrumRange(insight::DisplayManager* display_manager, insight::primitive::Primitive::Type type, uint16_t ring_id, uint64_t bin_id,
                        const glm::vec3& world_coords, double theta_offset, double phi_offset, double radius,
                        const glm::vec3& colour,
-                       const std::vector<sdr::FrequencyBin const*>& frequency_bins);
+                       sdr::SpectrumSamples* samples, uint64_t first_frequency_bin, uint64_t frequency_bin_count);
     ~RotatedSpectrumRange() = default;
 
     void setEnableRotationAroundY(bool enabled);
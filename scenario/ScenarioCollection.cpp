@@ -1,16 +1,33 @@
 #include "ScenarioCollection.h"
 
 #include "SimpleSpectrum.h"
+#include "Config.h"
+
+// Step sizes for capture settings changed from the keyboard.
+#define GAIN_STEP_DB 1.0f
+#define DWELL_TIME_STEP_US 100000
+
+void ScenarioCollection::setSampler(sdr::SpectrumSampler* sampler)
+{
+    sampler_ = sampler;
+}
 
 void ScenarioCollection::adjustCoalesceFactors(bool increase)
 {
     SimpleSpectrum* scenario = dynamic_cast<SimpleSpectrum*>(getCurrentScenario());
+    if (scenario == nullptr)
+    {
+        return;
+    }
 
-    uint32_t coalesce_factor = scenario->getCoalesceFactor();
-    scenario->setCoalesceFactor(increase ? coalesce_factor * 2 : coalesce_factor / 2);
+    // Picking a level by hand stops it being picked automatically
+    if (scenario->getAutoLod())
+    {
+        scenario->setAutoLod(false);
+    }
 
-    nextScenario();
-    previousScenario();
+    uint32_t coalesce_factor = scenario->getCoalesceFactor();
+    scenario->rebin(increase ? coalesce_factor * 2 : coalesce_factor / 2);
 }
 
 void ScenarioCollection::adjustMaxInterestMarkers(bool increase)
@@ -19,20 +36,73 @@ void ScenarioCollection::adjustMaxInterestMarkers(bool increase)
 
     uint64_t max_markers = scenario->getMaxInterestMarkers();
     scenario->setMaxInterestMarkers(increase ? ++max_markers : --max_markers);
-
-    nextScenario();
-    previousScenario();
 }
 
 void ScenarioCollection::adjustMinInterestMarkingAmplitude(bool increase)
 {
     SimpleSpectrum* scenario = dynamic_cast<SimpleSpectrum*>(getCurrentScenario());
 
-    float min_amplitude = scenario->getMinInterestMarkingAmplitude();
-    scenario->setMinInterestMarkingAmplitude(increase ? min_amplitude + 1.0f : min_amplitude - 1.0f);
+    if (scenario->getInterestMarkingUsesSnr())
+    {
+        float min_snr = scenario->getMinInterestMarkingSnr();
+        scenario->setMinInterestMarkingSnr(increase ? min_snr + 1.0f : min_snr - 1.0f);
+    }
+    else
+    {
+        float min_amplitude = scenario->getMinInterestMarkingAmplitude();
+        scenario->setMinInterestMarkingAmplitude(increase ? min_amplitude + 1.0f : min_amplitude - 1.0f);
+    }
+}
+
+void ScenarioCollection::toggleInterestMarkingMode()
+{
+    SimpleSpectrum* scenario = dynamic_cast<SimpleSpectrum*>(getCurrentScenario());
+
+    scenario->setInterestMarkingUsesSnr( ! scenario->getInterestMarkingUsesSnr());
+}
+
+void ScenarioCollection::toggleAutoLod()
+{
+    SimpleSpectrum* scenario = dynamic_cast<SimpleSpectrum*>(getCurrentScenario());
+    if (scenario == nullptr)
+    {
+        return;
+    }
+
+    scenario->setAutoLod( ! scenario->getAutoLod());
+}
+
+void ScenarioCollection::toggleSamplerStats()
+{
+    SimpleSpectrum* scenario = dynamic_cast<SimpleSpectrum*>(getCurrentScenario());
+    if (scenario == nullptr)
+    {
+        return;
+    }
+
+    scenario->setShowSamplerStats( ! scenario->getShowSamplerStats());
+}
+
+void ScenarioCollection::adjustGain(bool increase)
+{
+    float gain = sampler_->getConfig()->getGain();
+    sampler_->setGain(increase ? gain + GAIN_STEP_DB : gain - GAIN_STEP_DB);
+}
+
+void ScenarioCollection::toggleAgc()
+{
+    sampler_->setAgc( ! sampler_->getConfig()->getAgc());
+}
+
+void ScenarioCollection::toggleDcSpikeRemoval()
+{
+    sampler_->setDcSpikeRemoval( ! sampler_->getConfig()->getDcSpikeRemoval());
+}
 
-    nextScenario();
-    previousScenario();
+void ScenarioCollection::adjustDwellTime(bool increase)
+{
+    uint32_t dwell_time = sampler_->getConfig()->getDwellTime();
+    sampler_->setDwellTime(increase ? dwell_time + DWELL_TIME_STEP_US : dwell_time - DWELL_TIME_STEP_US);
 }
 
 void ScenarioCollection::handleKeystroke(insight::WindowManager* window_manager, SDL_Event keystroke_event, GLfloat secs_since_last_renderloop)
@@ -53,6 +123,9 @@ void ScenarioCollection::handleKeystroke(insight::WindowManager* window_manager,
             case SDLK_LEFTBRACKET:
                 adjustCoalesceFactors(true);
                 break;
+            case SDLK_l:
+                toggleAutoLod();
+                break;
 
             case SDLK_o:
                 adjustMaxInterestMarkers(false);
@@ -67,6 +140,32 @@ void ScenarioCollection::handleKeystroke(insight::WindowManager* window_manager,
             case SDLK_PERIOD:
                 adjustMinInterestMarkingAmplitude(true);
                 break;
+            case SDLK_m:
+                toggleInterestMarkingMode();
+                break;
+
+            case SDLK_i:
+                toggleSamplerStats();
+                break;
+
+            case SDLK_MINUS:
+                adjustGain(false);
+                break;
+            case SDLK_EQUALS:
+                adjustGain(true);
+                break;
+            case SDLK_v:
+                toggleAgc();
+                break;
+            case SDLK_x:
+                toggleDcSpikeRemoval();
+                break;
+            case SDLK_j:
+                adjustDwellTime(false);
+                break;
+            case SDLK_k:
+                adjustDwellTime(true);
+                break;
 
             case SDLK_u:
                 scenario->undoLastZoom();
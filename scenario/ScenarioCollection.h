@@ -3,8 +3,13 @@
 
 #include "Insight.h"
 
+#include "sdr/SpectrumSampler.h"
+
 class ScenarioCollection : public insight::scenario::ScenarioCollection {
 public:
+    // The sampler whose capture settings (gain, AGC etc.) are changed from the keyboard.
+    void setSampler(sdr::SpectrumSampler* sampler);
+
     // insight::InputHandler overrides
     void handleKeystroke(insight::WindowManager* window_manager, SDL_Event keystroke_event, GLfloat secs_since_last_renderloop) override;
     void handleMouse(insight::WindowManager* window_manager, SDL_Event mouse_event, GLfloat secs_since_last_renderloop) override;
@@ -13,6 +18,16 @@ private:
     void adjustCoalesceFactors(bool increase);
     void adjustMaxInterestMarkers(bool increase);
     void adjustMinInterestMarkingAmplitude(bool increase);
+    void toggleInterestMarkingMode();
+    void toggleAutoLod();
+    void toggleSamplerStats();
+
+    void adjustGain(bool increase);
+    void toggleAgc();
+    void toggleDcSpikeRemoval();
+    void adjustDwellTime(bool increase);
+
+    sdr::SpectrumSampler* sampler_ = nullptr;
 };
 
 
@@ -1,33 +1,83 @@
 #include "SimpleSpectrum.h"
 
 #include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 // Divide spectrum into this many regions, each of which can contain at most one interest marker.
 #define INTEREST_MARKER_REGIONS 8
 
+// Redraw the sampler telemetry overlay this often.
+#define SAMPLER_STATS_UPDATE_SECS 1.0f
+
+// Levels stay laid out (hidden) after they're switched away from so that switching back is cheap, but only this many.
+#define LOD_MAX_LEVELS 4
+
 SimpleSpectrum::SimpleSpectrum(insight::WindowManager *window_manager, sdr::SpectrumSampler *sampler, uint32_t bin_coalesce_factor)
         : insight::scenario::Scenario(window_manager->getDisplayManager()),
           window_manager_(window_manager), sampler_(sampler), bin_coalesce_factor_(bin_coalesce_factor)
 {
+    range_generation_ = sampler_->getRangeGeneration();
     samples_ = sampler_->getSamples();
 
+    notified_sweep_count_ = 0;
+    sweep_handler_generation_ = 0;
+
     bin_width_ = 0.5;
 
+    start_picking_bin_ = nullptr;
+    last_picked_bin_ = nullptr;
+    picking_radius_ = bin_width_ / 2.0f;
+    picking_mouse_button_ = SDL_BUTTON_LEFT;
+    picking_ranges_move_ = false;
+
     max_freq_markers_ = 4;
 
     min_interest_marking_amplitude_ = 14.0f;
+    interest_marking_uses_snr_ = false;
+    min_interest_marking_snr_ = 10.0f;
     max_interest_markers_ = INTEREST_MARKER_REGIONS;
     current_interest_markers_ = 0;
+
+    show_sampler_stats_ = false;
+    sampler_stats_updated_at_ = 0.0f;
+
+    auto_lod_ = false;
 }
 
 void SimpleSpectrum::resetState()
 {
     frame_ = nullptr;
 
+    range_generation_ = sampler_->getRangeGeneration();
     samples_ = sampler_->getSamples();
 
+    // Completed sweeps are delivered by the samples rather than polled for, new samples (ie. after a zoom) need the
+    // handler registering again
+    if (samples_ && sweep_handler_generation_ != range_generation_)
+    {
+        notified_sweep_count_.store(samples_->getCompletedSweepCount(), std::memory_order_relaxed);
+        samples_->enableSnapshots();
+        samples_->addSweepHandler([this](uint64_t completed_sweep_count) {
+            notified_sweep_count_.store(completed_sweep_count, std::memory_order_release);
+        });
+
+        sweep_handler_generation_ = range_generation_;
+    }
+
     coalesced_bins_.clear();
+    levels_.clear();
+    level_text_ids_.clear();
     clearInterestMarkers();
+
+    picking_index_.clear();
+    start_picking_bin_ = nullptr;
+    last_picked_bin_ = nullptr;
+
+    // The text belonged to the previous frame
+    sampler_stats_text_ids_.clear();
+    sampler_stats_updated_at_ = 0.0f;
 }
 
 uint32_t SimpleSpectrum::getCoalesceFactor()
@@ -48,6 +98,109 @@ void SimpleSpectrum::setCoalesceFactor(uint32_t coalesce_factor)
     std::cout << "Set bin coalesce factor to " << bin_coalesce_factor_ << std::endl;
 }
 
+void SimpleSpectrum::rebin(uint32_t coalesce_factor)
+{
+    if (coalesce_factor == 0 || coalesce_factor == bin_coalesce_factor_)
+    {
+        return;
+    }
+
+    if (frame_ == nullptr || levels_.empty())
+    {
+        setCoalesceFactor(coalesce_factor);
+
+        if (frame_ != nullptr)
+        {
+            run();
+        }
+
+        return;
+    }
+
+    showLevel(coalesce_factor);
+
+    std::cout << "Set bin coalesce factor to " << bin_coalesce_factor_ << std::endl;
+}
+
+void SimpleSpectrum::showLevel(uint32_t coalesce_factor)
+{
+    // Hidden levels are still updated with the frame and belong to it, so letting go of them means starting a new
+    // frame with just this level
+    if (levels_.size() >= LOD_MAX_LEVELS && levels_.find(coalesce_factor) == levels_.end())
+    {
+        std::cout << "Dropping " << levels_.size() << " laid out levels to show coalesce factor " << coalesce_factor << std::endl;
+
+        rebuildFrame(coalesce_factor);
+        return;
+    }
+
+    for (SimpleSpectrumRange* range : coalesced_bins_)
+    {
+        range->setHidden(true);
+    }
+
+    for (unsigned long i : level_text_ids_)
+    {
+        frame_->deleteText(i);
+    }
+
+    level_text_ids_.clear();
+
+    // Markers and picking refer to the ranges of the previous level
+    clearInterestMarkers();
+    picking_index_.clear();
+    start_picking_bin_ = nullptr;
+    last_picked_bin_ = nullptr;
+
+    std::vector<SimpleSpectrumRange*>& level = levels_[coalesce_factor];
+    if (level.empty())
+    {
+        uint64_t raw_bin_count = samples_->getBinCount();
+        std::cout << "Coalescing " << raw_bin_count << " frequency bins into " << ((raw_bin_count + coalesce_factor - 1) / coalesce_factor) << " visual bins" << std::endl;
+
+        addLevel(coalesce_factor, level);
+
+        if (level.empty())
+        {
+            // Not kept, so the next visit tries to lay it out again rather than counting it as laid out
+            levels_.erase(coalesce_factor);
+
+            coalesced_bins_.clear();
+            bin_coalesce_factor_ = coalesce_factor;
+            return;
+        }
+    }
+    else
+    {
+        for (SimpleSpectrumRange* range : level)
+        {
+            range->setHidden(false);
+        }
+    }
+
+    coalesced_bins_ = level;
+    bin_coalesce_factor_ = coalesce_factor;
+
+    addLevelLabels();
+}
+
+void SimpleSpectrum::rebuildFrame(uint32_t coalesce_factor)
+{
+    bin_coalesce_factor_ = coalesce_factor;
+    run();
+}
+
+void SimpleSpectrum::addLevel(uint32_t coalesce_factor, std::vector<SimpleSpectrumRange*>& ranges)
+{
+    // Scenarios that don't lay their ranges out by level are rebuilt with run() instead (see rebin())
+    std::cerr << "Scenario can't lay out ranges for coalesce factor " << coalesce_factor << ", it doesn't implement addLevel()" << std::endl;
+}
+
+void SimpleSpectrum::addLevelLabels()
+{
+    // Intentionally empty, most scenarios' labels don't depend on the level
+}
+
 uint64_t SimpleSpectrum::getMaxInterestMarkers()
 {
     return max_interest_markers_;
@@ -79,6 +232,135 @@ void SimpleSpectrum::setMinInterestMarkingAmplitude(float min_amplitude)
     std::cout << "Set min interest marker amplitude to " << min_interest_marking_amplitude_ << std::endl;
 }
 
+float SimpleSpectrum::getMinInterestMarkingSnr()
+{
+    return min_interest_marking_snr_;
+}
+
+void SimpleSpectrum::setMinInterestMarkingSnr(float min_snr)
+{
+    min_interest_marking_snr_ = min_snr;
+    clearInterestMarkers();
+
+    std::cout << "Set min interest marker SNR to " << min_interest_marking_snr_ << std::endl;
+}
+
+bool SimpleSpectrum::getInterestMarkingUsesSnr()
+{
+    return interest_marking_uses_snr_;
+}
+
+void SimpleSpectrum::setInterestMarkingUsesSnr(bool use_snr)
+{
+    interest_marking_uses_snr_ = use_snr;
+    clearInterestMarkers();
+
+    std::cout << "Interest markers now use " << (interest_marking_uses_snr_ ? "SNR" : "absolute amplitude") << std::endl;
+}
+
+bool SimpleSpectrum::getAutoLod()
+{
+    return auto_lod_;
+}
+
+void SimpleSpectrum::setAutoLod(bool auto_lod)
+{
+    auto_lod_ = auto_lod;
+
+    std::cout << "Automatic level of detail " << (auto_lod_ ? "on" : "off") << std::endl;
+}
+
+bool SimpleSpectrum::getShowSamplerStats()
+{
+    return show_sampler_stats_;
+}
+
+void SimpleSpectrum::setShowSamplerStats(bool show_stats)
+{
+    show_sampler_stats_ = show_stats;
+    sampler_stats_updated_at_ = 0.0f;
+
+    if ( ! show_sampler_stats_ && frame_ != nullptr)
+    {
+        for (unsigned long i : sampler_stats_text_ids_)
+        {
+            frame_->deleteText(i);
+        }
+    }
+
+    if ( ! show_sampler_stats_)
+    {
+        sampler_stats_text_ids_.clear();
+    }
+}
+
+uint64_t SimpleSpectrum::getNotifiedSweepCount()
+{
+    return notified_sweep_count_.load(std::memory_order_acquire);
+}
+
+bool SimpleSpectrum::followSamplerRange()
+{
+    if (sampler_->getRangeGeneration() == range_generation_)
+    {
+        return false;
+    }
+
+    // Zooms can't be undone across a range the scenario didn't choose
+    previous_zoom_ranges_ = std::stack<ZoomRange>();
+
+    run();
+
+    return true;
+}
+
+void SimpleSpectrum::updateSamplerStatsOverlay(GLfloat secs_since_rendering_started)
+{
+    if ( ! show_sampler_stats_ || frame_ == nullptr)
+    {
+        return;
+    }
+
+    if (sampler_stats_updated_at_ > 0.0f && (secs_since_rendering_started - sampler_stats_updated_at_) < SAMPLER_STATS_UPDATE_SECS)
+    {
+        return;
+    }
+
+    for (unsigned long i : sampler_stats_text_ids_)
+    {
+        frame_->deleteText(i);
+    }
+
+    sampler_stats_text_ids_.clear();
+
+    std::vector<std::string> summary = sampler_->getStatsSummary();
+    for (size_t i = 0; i < summary.size(); i++)
+    {
+        sampler_stats_text_ids_.push_back(frame_->addText(summary[i].c_str(), 10, 35 + (i * 20), 0, true, 0.6, glm::vec3(1.0, 1.0, 0.0)));
+    }
+
+    sampler_stats_updated_at_ = secs_since_rendering_started;
+}
+
+void SimpleSpectrum::showSweepHistory(uint16_t slice_id, uint64_t sweep_count, GLfloat secs_since_rendering_started, GLfloat secs_since_framequeue_started, GLfloat secs_since_last_renderloop, GLfloat secs_since_last_frame)
+{
+    if ( ! samples_->getHistory() || frame_ == nullptr)
+    {
+        return;
+    }
+
+    for (SimpleSpectrumRange* range : coalesced_bins_)
+    {
+        if (range->getSliceId() == slice_id)
+        {
+            range->setHistorySweep(sweep_count);
+        }
+    }
+
+    // Ranges only refresh while their slice is current, so refresh this one now
+    frame_->updateObjects(secs_since_rendering_started, secs_since_framequeue_started, secs_since_last_renderloop, secs_since_last_frame, static_cast<void*>(&slice_id));
+}
+
 void SimpleSpectrum::clearInterestMarkers()
 {
     bin_ids_with_interest_markers_.clear();
@@ -118,16 +400,26 @@ void SimpleSpectrum::markLocalMaxima()
     }
 
     // Mark up local maxima as we haven't marked all our bins yet
-    std::map<float, uint64_t> bin_amplitudes;
+    interest_marking_values_.assign(coalesced_bins_.size(), std::numeric_limits<float>::lowest());
+
+    // Amplitudes are compared in the latest snapshot, so that every range is ranked at the same sweep
+    std::shared_ptr<const sdr::SweepSnapshot> snapshot = interest_marking_uses_snr_ ? nullptr : samples_->getLatestSnapshot();
+
     for (SimpleSpectrumRange* bin : coalesced_bins_)
     {
-        float amplitude = bin->getAmplitude();
-        if (amplitude > min_interest_marking_amplitude_)
+        if (interest_marking_uses_snr_)
+        {
+            interest_marking_values_[bin->getBinId()] = bin->getSignalToNoiseRatio(true);
+        }
+        else
         {
-            bin_amplitudes[amplitude] = bin->getBinId();
+            interest_marking_values_[bin->getBinId()] = snapshot ? bin->getSnapshotAmplitude(*snapshot) : bin->getAmplitude();
         }
     }
 
+    std::map<float, uint64_t> bin_amplitudes;
+    rankLocalMaxima(interest_marking_values_, interest_marking_uses_snr_ ? min_interest_marking_snr_ : min_interest_marking_amplitude_, bin_amplitudes);
+
     for (std::map<float, uint64_t>::reverse_iterator i = bin_amplitudes.rbegin(); i != bin_amplitudes.rend(); i++)
     {
         if ( ! getBinHasInterestMarker(i->second))
@@ -139,6 +431,17 @@ void SimpleSpectrum::markLocalMaxima()
 
 }
 
+void SimpleSpectrum::rankLocalMaxima(const std::vector<float>& values, float minimum_value, std::map<float, uint64_t>& ranking)
+{
+    for (uint64_t bin_id = 0; bin_id < values.size(); bin_id++)
+    {
+        if (values[bin_id] > minimum_value)
+        {
+            ranking[values[bin_id]] = bin_id;
+        }
+    }
+}
+
 void SimpleSpectrum::addInterestMarkerToBin(SimpleSpectrumRange *bin)
 {
     setBinHasInterestMarker(bin->getBinId());
@@ -157,6 +460,12 @@ void SimpleSpectrum::undoLastZoom()
 
 void SimpleSpectrum::retune(uint64_t start_freq_hz, uint64_t end_freq_hz, bool zooming_in)
 {
+    if (sampler_->isViewer())
+    {
+        std::cout << "Cannot zoom while viewing another sampler, zoom the publishing sampler instead" << std::endl;
+        return;
+    }
+
     // Retune from the frequency of start_picking_bin_ to last_picked_bin_
     sampler_->stop();           // this is blocking and invalidates samples_
 
@@ -190,16 +499,144 @@ void SimpleSpectrum::highlightPickedBins(SimpleSpectrumRange *end_picking_bin)
         return;
     }
 
-    bool picking_right = end_picking_bin->getBinId() > start_picking_bin_->getBinId();
-    SimpleSpectrumRange* start = picking_right ? start_picking_bin_ : end_picking_bin;
-    SimpleSpectrumRange* end = picking_right ? end_picking_bin : start_picking_bin_;
+    last_picked_bin_ = end_picking_bin;
+
+    uint16_t slice_id = start_picking_bin_->getSliceId();
+    uint64_t first_bin_id = std::min(start_picking_bin_->getBinId(), end_picking_bin->getBinId());
+    uint64_t last_bin_id = std::max(start_picking_bin_->getBinId(), end_picking_bin->getBinId());
+
+    // Bin IDs only index coalesced_bins_ when there's a single ring (or slice) of ranges, otherwise the picked ring's
+    // ranges are looked for among all of them
+    bool indexed = last_bin_id < coalesced_bins_.size() &&
+                   coalesced_bins_[first_bin_id]->getBinId() == first_bin_id && coalesced_bins_[first_bin_id]->getSliceId() == slice_id &&
+                   coalesced_bins_[last_bin_id]->getBinId() == last_bin_id && coalesced_bins_[last_bin_id]->getSliceId() == slice_id;
+
+    if (indexed)
+    {
+        for (uint64_t bin_id = first_bin_id; bin_id <= last_bin_id; bin_id++)
+        {
+            coalesced_bins_[bin_id]->setPicked(true);
+        }
+
+        return;
+    }
+
+    for (SimpleSpectrumRange* range : coalesced_bins_)
+    {
+        if (range->getSliceId() == slice_id && range->getBinId() >= first_bin_id && range->getBinId() <= last_bin_id)
+        {
+            range->setPicked(true);
+        }
+    }
+}
+
+
+void SimpleSpectrum::handleMouse(insight::WindowManager* window_manager, SDL_Event mouse_event, GLfloat secs_since_last_renderloop)
+{
+    if (mouse_event.type == SDL_MOUSEBUTTONDOWN && mouse_event.button.button == picking_mouse_button_)
+    {
+        start_picking_bin_ = findFirstIntersectedBin(mouse_event.motion.x, mouse_event.motion.y);
+        last_picked_bin_ = nullptr;
+
+        if (start_picking_bin_)
+        {
+            highlightPickedBins(start_picking_bin_);
+            return;
+        }
+    }
+    else if (start_picking_bin_ && mouse_event.type == SDL_MOUSEMOTION)
+    {
+        SimpleSpectrumRange* end_picking_bin = findFirstIntersectedBin(mouse_event.motion.x, mouse_event.motion.y);
+
+        if (end_picking_bin)
+        {
+            highlightPickedBins(end_picking_bin);
+            return;
+        }
+    }
+    else if (start_picking_bin_ && mouse_event.type == SDL_MOUSEBUTTONUP && mouse_event.button.button == picking_mouse_button_)
+    {
+        if (last_picked_bin_ && last_picked_bin_ != start_picking_bin_ && sampler_->isViewer())
+        {
+            std::cout << "Cannot zoom while viewing another sampler, zoom the publishing sampler instead" << std::endl;
+        }
+        else if (last_picked_bin_ && last_picked_bin_ != start_picking_bin_)
+        {
+            // Save the current range so we can return to it
+            ZoomRange current_range = {
+                    sampler_->getStartFrequency(),
+                    sampler_->getEndFrequency()
+            };
+            previous_zoom_ranges_.push(current_range);
+
+            uint64_t start_freq_hz = start_picking_bin_->getBinId() < last_picked_bin_->getBinId() ? start_picking_bin_->getFrequency() : last_picked_bin_->getFrequency();
+            uint64_t end_freq_hz = start_picking_bin_->getBinId() < last_picked_bin_->getBinId() ? last_picked_bin_->getFrequency() : start_picking_bin_->getFrequency();
+
+            max_freq_markers_ = 2;
+
+            retune(start_freq_hz, end_freq_hz, true);
+        }
+
+        start_picking_bin_ = nullptr;
+        last_picked_bin_ = nullptr;
+    }
+}
+
+SimpleSpectrumRange* SimpleSpectrum::findFirstIntersectedBin(GLuint mouse_x, GLuint mouse_y)
+{
+    glm::vec3 ray_start_coords = display_manager_->getCameraCoords();
+    glm::vec3 ray_direction = display_manager_->getRayFromCamera(mouse_x, mouse_y);
 
-    for (uint64_t bin_id = start->getBinId(); picking_right ? bin_id <= end->getBinId() && bin_id < coalesced_bins_.size() : bin_id >= start->getBinId() && bin_id > 0; picking_right ? bin_id++ : bin_id--)
+    if (picking_ranges_move_)
     {
-        last_picked_bin_ = coalesced_bins_[bin_id];
-        last_picked_bin_->setPicked(true);
+        return findIntersectedBinByScan(ray_start_coords, ray_direction);
     }
 
-    end->setPicked(true);
+    if (picking_index_.size() != coalesced_bins_.size())
+    {
+        picking_index_.build(coalesced_bins_, picking_radius_);
+    }
+
+    return picking_index_.pick(ray_start_coords, ray_direction);
 }
 
+SimpleSpectrumRange* SimpleSpectrum::findIntersectedBinByScan(const glm::vec3& ray_origin, const glm::vec3& ray_direction)
+{
+    if (glm::length(ray_direction) == 0.0f)
+    {
+        return nullptr;
+    }
+
+    // The same sphere test as BinPickingIndex::pick(), against where each range is now
+    glm::vec3 direction = glm::normalize(ray_direction);
+    float radius_squared = picking_radius_ * picking_radius_;
+
+    SimpleSpectrumRange* nearest = nullptr;
+    float nearest_t = std::numeric_limits<float>::infinity();
+
+    for (SimpleSpectrumRange* range : coalesced_bins_)
+    {
+        if (range->getHidden())
+        {
+            continue;
+        }
+
+        glm::vec3 to_center = range->getPosition() - ray_origin;
+        float t_closest = glm::dot(to_center, direction);
+        float distance_squared = glm::dot(to_center, to_center) - (t_closest * t_closest);
+
+        if (t_closest < 0 || distance_squared > radius_squared)
+        {
+            continue;
+        }
+
+        float t_hit = t_closest - sqrtf(radius_squared - distance_squared);
+        if (t_hit < nearest_t)
+        {
+            nearest = range;
+            nearest_t = t_hit;
+        }
+    }
+
+    return nearest;
+}
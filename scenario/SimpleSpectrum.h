@@ -2,10 +2,13 @@
 #define WAVEGUIDE_SCENARIO_SIMPLESPECTRUM_H
 
 #include <vector>
+#include <map>
 #include <unordered_set>
 #include <stack>
+#include <atomic>
 
 #include <scenario/SimpleSpectrumRange.h>
+#include <scenario/BinPickingIndex.h>
 
 #include "Insight.h"
 #include "sdr/SpectrumSampler.h"
@@ -29,15 +32,43 @@ public:
     float getMinInterestMarkingAmplitude();
     void setMinInterestMarkingAmplitude(float min_amplitude);
 
+    // Get and set the minimum SNR a SimpleSpectrumRange must have before it's considered "of interest".
+    float getMinInterestMarkingSnr();
+    void setMinInterestMarkingSnr(float min_snr);
+
+    // Get and set whether interest marking compares SNR (rather than absolute amplitude) against its threshold.
+    bool getInterestMarkingUsesSnr();
+    void setInterestMarkingUsesSnr(bool use_snr);
+
+    // Re-bins the running scenario at coalesce_factor. Scenarios that lay their ranges out with addLevel() switch to
+    // the new level in place, others are rebuilt with run().
+    virtual void rebin(uint32_t coalesce_factor);
+
+    // Get and set whether the coalesce factor is picked automatically, so that bars are no narrower than a pixel on
+    // screen. Only scenarios that lay their bars out along a line (see LinearSpectrum) act on it.
+    bool getAutoLod();
+    void setAutoLod(bool auto_lod);
+
+    // Get and set whether the sampler telemetry overlay is drawn.
+    bool getShowSamplerStats();
+    void setShowSamplerStats(bool show_stats);
+
     // Remove interest markers from any marked bins.
     virtual void clearInterestMarkers();
 
     // Undo the previous zoom-in by popping a ZoomRange off the stack.
     virtual void undoLastZoom();
 
+    // Ranks the values (amplitude or SNR) of SimpleSpectrumRanges, indexed by bin ID, that exceed minimum_value. The
+    // ranking maps each value to its bin ID so that iterating it in reverse visits the highest values first.
+    static void rankLocalMaxima(const std::vector<float>& values, float minimum_value, std::map<float, uint64_t>& ranking);
+
     // Adjust the frequency range being scanned, used when zooming in and out.
     void retune(uint64_t start_freq_hz, uint64_t end_freq_hz, bool zooming_in);
 
+    // insight::InputHandler overrides, dragging picking_mouse_button_ across SimpleSpectrumRanges zooms into them.
+    void handleMouse(insight::WindowManager* window_manager, SDL_Event mouse_event, GLfloat secs_since_last_renderloop) override;
+
 protected:
     // The specific range the sampler_ covers is modelled by a ZoomRange.
     typedef struct
@@ -50,8 +81,8 @@ protected:
     virtual void updateSceneCallback(GLfloat secs_since_rendering_started, GLfloat secs_since_framequeue_started, GLfloat secs_since_last_renderloop, GLfloat secs_since_last_frame) = 0;
 
     // Called when updating the scene and fewer than max_interest_markers_ frequencies of interest have been marked.
-    // Finds all SimpleSpectrumRange instances whose amplitude is greater than min_interest_marking_amplitude_ and
-    // marks those with the highest amplitude by using addInterestMarkerToBin().
+    // Finds all SimpleSpectrumRange instances whose amplitude is greater than min_interest_marking_amplitude_ (or whose
+    // SNR is greater than min_interest_marking_snr_) and marks the highest of those by using addInterestMarkerToBin().
     void markLocalMaxima();
 
     // Mark a coalesced frequency bin (using whatever technique is best for the scenario, could be simple text, could
@@ -65,15 +96,63 @@ protected:
     // Highlight the SimpleSpectrumRanges that are "picked" when ray casting for a zoom.
     virtual void highlightPickedBins(SimpleSpectrumRange *end_picking_bin);
 
+    // Ray casts from the mouse to find the SimpleSpectrumRange under it. By default this walks picking_index_, which
+    // is (re)built whenever coalesced_bins_ changes, or tests every range if picking_ranges_move_. Scenarios whose
+    // layout allows it intersect analytically instead.
+    virtual SimpleSpectrumRange* findFirstIntersectedBin(GLuint mouse_x, GLuint mouse_y);
+
+    // Finds the nearest shown range within picking_radius_ of the ray by testing every range in coalesced_bins_.
+    SimpleSpectrumRange* findIntersectedBinByScan(const glm::vec3& ray_origin, const glm::vec3& ray_direction);
+
+    // Called by time-sliced sub-classes when a sweep completes, so that the ranges of slice_id show sweep_count from the
+    // sampler's history (if kept) rather than whatever the live bins hold by the time they're next looked at.
+    void showSweepHistory(uint16_t slice_id, uint64_t sweep_count, GLfloat secs_since_rendering_started, GLfloat secs_since_framequeue_started, GLfloat secs_since_last_renderloop, GLfloat secs_since_last_frame);
+
     // Called by sub-classes when the Scenario is run() by ScenarioCollection.
     void resetState();
 
+    // Shows the ranges for coalesce_factor in place of the current ones, laying them out with addLevel() the first
+    // time the factor is shown since run(). Interest markers and picking are reset as they refer to the old ranges.
+    // Once LOD_MAX_LEVELS are laid out a new factor is shown with rebuildFrame() instead.
+    virtual void showLevel(uint32_t coalesce_factor);
+
+    // Starts a new frame holding only the ranges for coalesce_factor, dropping every other laid out level. By default
+    // the scenario is run() again at coalesce_factor.
+    virtual void rebuildFrame(uint32_t coalesce_factor);
+
+    // Lays out the ranges that each coalesce coalesce_factor bins and adds them to frame_. Scenarios that build their
+    // ranges through showLevel() must implement it, the default logs an error and leaves ranges empty (which showLevel()
+    // then shows nothing for, without keeping the level).
+    virtual void addLevel(uint32_t coalesce_factor, std::vector<SimpleSpectrumRange*>& ranges);
+
+    // Adds the labels (ie. frequency markers) that go with the ranges being shown, putting their IDs in
+    // level_text_ids_ so that they are removed when the level changes. Does nothing by default, for scenarios whose
+    // labels are the same at every level.
+    virtual void addLevelLabels();
+
+    // Called by sub-classes at the start of each scene update. If the sampler has moved onto a new range without being
+    // retuned from here (ie. a viewer following its publisher) the scenario is run() again for it and true is returned,
+    // in which case the update must be abandoned.
+    bool followSamplerRange();
+
+    // Gets the count of the latest sweep that the sampler has notified the scenario of completing (see resetState()),
+    // by which time its snapshot has been published.
+    uint64_t getNotifiedSweepCount();
+
+    // Called by sub-classes when updating the scene, redraws the sampler telemetry (if shown) once a second.
+    void updateSamplerStatsOverlay(GLfloat secs_since_rendering_started);
+
     insight::WindowManager* window_manager_;
     std::shared_ptr<insight::Frame> frame_;
 
     // Interface to SDR hardware.
     sdr::SpectrumSampler* sampler_;
     sdr::SpectrumSamples* samples_;
+    uint64_t range_generation_;     // the sampler's range generation when samples_ was fetched
+
+    // Set by the sweep handler registered with samples_, which is registered once per range generation.
+    std::atomic<uint64_t> notified_sweep_count_;
+    uint64_t sweep_handler_generation_;
 
     // The current range being scanned (from start_freq_hz to end_freq_hz) is split into n slices, where each slice is
     // the bandwidth of the capture device. sdr::SampleThread dwells on each slice for a period of time over which it
@@ -90,9 +169,17 @@ protected:
     // is different to zooming, which focuses the scanning range on a smaller portion of the spectrum).
     uint32_t bin_coalesce_factor_;
 
+    // Whether scenarios that support it adjust bin_coalesce_factor_ to the camera (see setAutoLod()).
+    bool auto_lod_;
+
     // Collection of SceneObjects, each of which represents a group of coalesced sdr::FrequencyBins.
     std::vector<SimpleSpectrumRange*> coalesced_bins_;
 
+    // Ranges of every level laid out since run(), indexed by coalesce factor. The frame owns them all, only the
+    // level in coalesced_bins_ is shown and the rest are hidden until they are switched back to.
+    std::map<uint32_t, std::vector<SimpleSpectrumRange*>> levels_;
+    std::vector<unsigned long> level_text_ids_;
+
     // The width of the scene object that represents a coalesced frequency bin. Smaller means more bins can be fit
     // on the screen but individual amplitude spikes may be harder to see. Intepretation of the value really depends
     // on what type of object (cube, rectangle, line) the scenario subclass uses.
@@ -104,16 +191,40 @@ protected:
     // Only SimpleSpectrumRanges with a combined amplitude greater than this are considered by markLocalMaxima().
     float min_interest_marking_amplitude_;
 
+    // When set, markLocalMaxima() ranks SimpleSpectrumRanges by SNR and only considers those above this threshold. This
+    // adapts to the noise floor of each frequency rather than relying on a single absolute amplitude.
+    bool interest_marking_uses_snr_;
+    float min_interest_marking_snr_;
+
     // Max and current number of SimpleSpectrumRanges to place "interest markers" on.
     uint64_t max_interest_markers_;
     uint64_t current_interest_markers_;
 
+    // Scratch space for markLocalMaxima() so that it doesn't reallocate on every update.
+    std::vector<float> interest_marking_values_;
+
     // IDs of the SimpleSpectrumRanges that currently have interest markers.
     std::unordered_set<uint64_t> bin_ids_with_interest_markers_;
 
     SimpleSpectrumRange* start_picking_bin_;
     SimpleSpectrumRange* last_picked_bin_;
 
+    // Spatial index over coalesced_bins_ used for picking, each range is treated as a sphere of picking_radius_.
+    BinPickingIndex picking_index_;
+    float picking_radius_;
+
+    // Set by scenarios whose ranges move as they're updated (ie. RotatedSpectrumRanges), which would leave
+    // picking_index_ stale, so they pick by testing every range where it is now instead.
+    bool picking_ranges_move_;
+
+    // Scenarios that use the left mouse button to steer the camera pick with a different button.
+    uint8_t picking_mouse_button_;
+
+    // Sampler telemetry overlay, drawn as screen text above the scenario title.
+    bool show_sampler_stats_;
+    std::vector<unsigned long> sampler_stats_text_ids_;
+    GLfloat sampler_stats_updated_at_;
+
     // Zooming into a new range pushes the current ZoomRange onto the stack.
     std::stack<ZoomRange> previous_zoom_ranges_;
 };
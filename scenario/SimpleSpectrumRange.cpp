@@ -4,11 +4,20 @@
 
 SimpleSpectrumRange::SimpleSpectrumRange(insight::DisplayManager* display_manager, insight::primitive::Primitive::Type type, uint16_t slice_id, uint64_t bin_id,
                                          const glm::vec3& world_coords, const glm::vec3& colour,
-                                         const std::vector<sdr::FrequencyBin const*>& frequency_bins) :
-        insight::SceneObject(display_manager, type, world_coords, colour), slice_id_(slice_id), bin_id_(bin_id), frequency_bins_(frequency_bins)
+                                         sdr::SpectrumSamples* samples, uint64_t first_frequency_bin, uint64_t frequency_bin_count) :
+        insight::SceneObject(display_manager, type, world_coords, colour), slice_id_(slice_id), bin_id_(bin_id),
+        samples_(samples), first_frequency_bin_(first_frequency_bin), frequency_bin_count_(frequency_bin_count)
 {
     amplitude_ = 0.0f;
+    snr_ = 0.0f;
     picked_ = false;
+    hidden_ = false;
+
+    history_sweep_ = 0;
+
+    generation_ = 0;
+    snr_generation_ = 0;
+    changed_ = true;
 }
 
 float SimpleSpectrumRange::getAmplitude(bool refresh)
@@ -18,27 +27,80 @@ float SimpleSpectrumRange::getAmplitude(bool refresh)
         return amplitude_;
     }
 
-    float average_amplitude = 0.0f;
-    for (sdr::FrequencyBin const* bin : frequency_bins_)
+    float average_amplitude;
+    if (history_sweep_)
+    {
+        // Keep the last amplitude if the sweep has already dropped out of the history
+        sdr::SweepHistory* history = samples_->getHistory();
+        if ( ! history || ! history->getAmplitude(history_sweep_, first_frequency_bin_, frequency_bin_count_, average_amplitude))
+        {
+            return amplitude_;
+        }
+    }
+    else
     {
-        average_amplitude += const_cast<sdr::FrequencyBin*>(bin)->getLatestAmplitude(true);
+        average_amplitude = coalesceAmplitude(samples_, first_frequency_bin_, frequency_bin_count_);
     }
 
-    average_amplitude /= frequency_bins_.size();    // in dB
     amplitude_ = average_amplitude + 100;           // offset so -100dB == 0 (ie. 30)
     amplitude_ /= 2.0;                              // todo: remove me
 
     return amplitude_;
 }
 
-uint64_t SimpleSpectrumRange::getFrequency()
+float SimpleSpectrumRange::getSnapshotAmplitude(const sdr::SweepSnapshot& snapshot)
+{
+    float average_amplitude = 0.0f;
+    for (uint64_t bin = first_frequency_bin_; bin < first_frequency_bin_ + frequency_bin_count_ && bin < snapshot.amplitudes_.size(); bin++)
+    {
+        average_amplitude += snapshot.amplitudes_[bin];
+    }
+
+    average_amplitude /= frequency_bin_count_;
+
+    return (average_amplitude + 100) / 2.0f;
+}
+
+float SimpleSpectrumRange::coalesceAmplitude(sdr::SpectrumSamples* samples, uint64_t first_frequency_bin, uint64_t frequency_bin_count)
 {
-    if (frequency_bins_.size() / 2)
+    float average_amplitude = 0.0f;
+    for (uint64_t bin = first_frequency_bin; bin < first_frequency_bin + frequency_bin_count; bin++)
+    {
+        average_amplitude += samples->getBinAmplitude(bin, true);
+    }
+
+    return average_amplitude / frequency_bin_count;     // in dB
+}
+
+float SimpleSpectrumRange::getSignalToNoiseRatio(bool refresh)
+{
+    if ( ! refresh)
+    {
+        return snr_;
+    }
+
+    uint64_t generation = samples_->getGeneration(first_frequency_bin_, frequency_bin_count_);
+    if (generation == snr_generation_)
+    {
+        return snr_;
+    }
+
+    snr_generation_ = generation;
+
+    float average_snr = 0.0f;
+    for (uint64_t bin = first_frequency_bin_; bin < first_frequency_bin_ + frequency_bin_count_; bin++)
     {
-        return const_cast<sdr::FrequencyBin*>(frequency_bins_[frequency_bins_.size() / 2])->getFrequency();
+        average_snr += samples_->getBinSignalToNoiseRatio(bin, true);
     }
 
-    return const_cast<sdr::FrequencyBin*>(frequency_bins_[0])->getFrequency();
+    snr_ = average_snr / frequency_bin_count_;      // in dB above the noise floor
+
+    return snr_;
+}
+
+uint64_t SimpleSpectrumRange::getFrequency()
+{
+    return samples_->getBinFrequency(first_frequency_bin_ + (frequency_bin_count_ / 2));
 }
 
 uint64_t SimpleSpectrumRange::getBinId()
@@ -46,9 +108,54 @@ uint64_t SimpleSpectrumRange::getBinId()
     return bin_id_;
 }
 
+uint16_t SimpleSpectrumRange::getSliceId()
+{
+    return slice_id_;
+}
+
+void SimpleSpectrumRange::setHistorySweep(uint64_t sweep_count)
+{
+    history_sweep_ = sweep_count;
+    changed_ = true;
+}
+
+void SimpleSpectrumRange::setHidden(bool hidden)
+{
+    hidden_ = hidden;
+
+    // Its bins may well have changed while it was hidden
+    changed_ = true;
+}
+
+bool SimpleSpectrumRange::getHidden()
+{
+    return hidden_;
+}
+
+bool SimpleSpectrumRange::takeChanged()
+{
+    bool changed = changed_;
+    changed_ = false;
+
+    // A range showing a sweep from the history only changes when it's given another sweep
+    if (history_sweep_)
+    {
+        return changed;
+    }
+
+    uint64_t generation = samples_->getGeneration(first_frequency_bin_, frequency_bin_count_);
+    if (generation != generation_)
+    {
+        generation_ = generation;
+        changed = true;
+    }
+
+    return changed;
+}
+
 void SimpleSpectrumRange::draw(GLfloat secs_since_rendering_started, GLfloat secs_since_framequeue_started, GLfloat secs_since_last_renderloop, GLfloat secs_since_last_frame, bool use_colour)
 {
-    if ( ! const_cast<sdr::FrequencyBin*>(frequency_bins_[0])->getHasBeenSet(2))
+    if (hidden_ || ! samples_->getHasBeenSet(first_frequency_bin_, 2))
     {
         return;
     }
@@ -60,8 +167,8 @@ void SimpleSpectrumRange::update(GLfloat secs_since_rendering_started, GLfloat s
 {
     uint16_t current_slice_id = *(static_cast<uint16_t*>(context));
 
-    // If this bin doesn't belong to the ring currently being rendered, exit early.
-    if (current_slice_id != slice_id_)
+    // If this bin doesn't belong to the ring currently being rendered, or nothing it shows has changed, exit early.
+    if (current_slice_id != slice_id_ || hidden_ || ! takeChanged())
     {
         return;
     }
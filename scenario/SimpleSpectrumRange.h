@@ -2,13 +2,11 @@
 #define WAVEGUIDE_SCENARIO_SIMPLESPECTRUMRANGE_H
 
 #include "core/SceneObject.h"
-#include "sdr/FrequencyBin.h"
-
-#include <vector>
+#include "sdr/SpectrumSamples.h"
 
 class SimpleSpectrumRange : public insight::SceneObject {
 public:
-    SimpleSpectrumRange(insight::DisplayManager* display_manager, insight::primitive::Primitive::Type type, uint16_t slice_id, uint64_t bin_id, const glm::vec3& world_coords, const glm::vec3& colour, const std::vector<sdr::FrequencyBin const*>& frequency_bins);
+    SimpleSpectrumRange(insight::DisplayManager* display_manager, insight::primitive::Primitive::Type type, uint16_t slice_id, uint64_t bin_id, const glm::vec3& world_coords, const glm::vec3& colour, sdr::SpectrumSamples* samples, uint64_t first_frequency_bin, uint64_t frequency_bin_count);
     virtual ~SimpleSpectrumRange() = default;
 
     virtual void draw(GLfloat secs_since_rendering_started, GLfloat secs_since_framequeue_started, GLfloat secs_since_last_renderloop, GLfloat secs_since_last_frame, bool use_colour = true);
@@ -16,20 +14,53 @@ public:
 
     float getAmplitude(bool refresh = false);
 
+    // Gets the amplitude (scaled as getAmplitude() scales it) that the range's bins had in snapshot.
+    float getSnapshotAmplitude(const sdr::SweepSnapshot& snapshot);
+
+    // Averages the latest (moving average) amplitude of a group of frequency bins (in dB).
+    static float coalesceAmplitude(sdr::SpectrumSamples* samples, uint64_t first_frequency_bin, uint64_t frequency_bin_count);
+    float getSignalToNoiseRatio(bool refresh = false);
+
     uint64_t getFrequency();
     uint64_t getBinId();
+    uint16_t getSliceId();
+
+    // Once a range's sweep has completed it shows that sweep from the sampler's history rather than the live bins (0
+    // shows the live bins again).
+    void setHistorySweep(uint64_t sweep_count);
 
-    void setPicked(bool p) { picked_ = p; }
+    void setPicked(bool p) { picked_ = p; changed_ = true; }
+
+    // Hidden ranges are neither updated nor drawn, so scenarios can keep ranges for several layouts in one frame and
+    // only show one of them.
+    void setHidden(bool hidden);
+    bool getHidden();
 
 protected:
-    std::vector<sdr::FrequencyBin const*> frequency_bins_;
+    // Whether anything the range shows has changed since it was last updated (its bins, history sweep or picking),
+    // so update() can skip re-reading and re-locking bins that nobody has written to.
+    bool takeChanged();
+
+    // The range covers frequency_bin_count_ bins from first_frequency_bin_, which are looked up from samples_ on each
+    // update as they aren't allocated until first written to.
+    sdr::SpectrumSamples* samples_;
+    uint64_t first_frequency_bin_;
+    uint64_t frequency_bin_count_;
+
+    uint64_t history_sweep_;
+
+    uint64_t generation_;           // samples_->getGeneration() of the bins when last updated
+    uint64_t snr_generation_;       // and when snr_ was last refreshed
+    bool changed_;
 
     uint16_t slice_id_;
     uint64_t bin_id_;
 
     float amplitude_;
+    float snr_;
 
     bool picked_;
+    bool hidden_;
 };
 
 #endif //WAVEGUIDE_SCENARIO_SIMPLESPECTRUMRANGE_H
@@ -2,6 +2,7 @@
 
 #include <cmath>
 #include <iostream>
+#include <algorithm>
 
 #include <glm/gtc/matrix_transform.hpp>
 
@@ -13,6 +14,9 @@ CircularSpectrum::CircularSpectrum(insight::WindowManager* window_manager, sdr::
     radius_ = 8;
     max_interest_markers_ = 12;
     max_freq_markers_ = 4;
+
+    // Ranges are moved out from the circle by their amplitude on every update
+    picking_ranges_move_ = true;
 }
 
 void CircularSpectrum::run()
@@ -27,29 +31,41 @@ void CircularSpectrum::run()
 
     frame_ = frame_queue->newFrame();
 
-    uint64_t raw_bin_count = samples_->getBinCount();
-    uint64_t coalesced_bin_count = (raw_bin_count + bin_coalesce_factor_ - 1) / bin_coalesce_factor_; // integer ceiling
+    showLevel(bin_coalesce_factor_);
 
-    std::cout << "Coalescing " << raw_bin_count << " frequency bins into " << coalesced_bin_count << " visual bins" << std::endl;
+    char msg[128];
+    snprintf(msg, sizeof(msg), "Circular Perspective (%.3fMhz - %.3fMhz)", sampler_->getStartFrequency() / 1000000.0f, sampler_->getEndFrequency() / 1000000.0f);
+    frame_->addText(msg, 10, 10, 0, true, 1.0, glm::vec3(1.0, 1.0, 1.0));
 
-    double rad_per_bin = (2*M_PI) / coalesced_bin_count;            // each full spectrum band wraps once around the sphere
+    frame_queue->enqueueFrame(frame_);
 
-    uint64_t marker_spacing = coalesced_bin_count / max_freq_markers_;
+    display_manager_->setUpdateSceneCallback(std::bind(&CircularSpectrum::updateSceneCallback, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4));
+
+    frame_queue->setReady();
+    frame_queue->setActive();    // transfer ownership to DisplayManager
+}
+
+void CircularSpectrum::showLevel(uint32_t coalesce_factor)
+{
+    SimpleSpectrum::showLevel(coalesce_factor);
+
+    double rad_per_bin = (2*M_PI) / coalesced_bins_.size();
+    picking_radius_ = (radius_ * rad_per_bin) / 2.0;                // half the distance between neighbouring bins
+}
+
+void CircularSpectrum::addLevel(uint32_t coalesce_factor, std::vector<SimpleSpectrumRange*>& ranges)
+{
+    uint64_t raw_bin_count = samples_->getBinCount();
+    uint64_t coalesced_bin_count = (raw_bin_count + coalesce_factor - 1) / coalesce_factor; // integer ceiling
+
+    double rad_per_bin = (2*M_PI) / coalesced_bin_count;            // each full spectrum band wraps once around the sphere
     glm::vec3 start_coords = glm::vec3(0, 0, 0);                    // initial co-ordinates of the sphere's center
-    if (marker_spacing == 0)
-    {
-        marker_spacing = 2;
-    }
 
     for (uint64_t bin_id = 0; bin_id < coalesced_bin_count; bin_id++)
     {
         // Coalesce the frequency bins into a spectrum range
-        std::vector<sdr::FrequencyBin const*> frequency_bins;
-        uint64_t start_frequency_bin = bin_id * bin_coalesce_factor_;
-        for (uint64_t j = start_frequency_bin; j < (start_frequency_bin + bin_coalesce_factor_) && j < raw_bin_count; j++)
-        {
-            frequency_bins.push_back(samples_->getFrequencyBin(j));
-        }
+        uint64_t start_frequency_bin = bin_id * coalesce_factor;
+        uint64_t frequency_bin_count = std::min<uint64_t>(coalesce_factor, raw_bin_count - start_frequency_bin);
 
         double theta = (rad_per_bin * bin_id);
 
@@ -57,41 +73,55 @@ void CircularSpectrum::run()
         world_coords.x += radius_ * cos(theta);
         world_coords.y += radius_ * sin(theta);
 
-        RotatedSpectrumRange* bin = new RotatedSpectrumRange(display_manager_, insight::primitive::Primitive::Type::LINE, 0, bin_id, world_coords, theta, 0, radius_, glm::vec3(1, 1, 1), frequency_bins);
+        RotatedSpectrumRange* bin = new RotatedSpectrumRange(display_manager_, insight::primitive::Primitive::Type::LINE, 0, bin_id, world_coords, theta, 0, radius_, glm::vec3(1, 1, 1), samples_, start_frequency_bin, frequency_bin_count);
 
-        coalesced_bins_.push_back(bin);
+        ranges.push_back(bin);
         frame_->addObject(bin);
-
-        if ((bin_id % marker_spacing) == 0 && bin_id < coalesced_bin_count - 2)
-        {
-            char msg[64];
-            snprintf(msg, sizeof(msg), "%.3fMHz", const_cast<sdr::FrequencyBin*>(frequency_bins[0])->getFrequency() / 1000000.0f);
-            float text_y = world_coords.y > 0 ? world_coords.y - 2.0f : world_coords.y + 2.0f;
-            frame_->addText(msg, world_coords.x > 0 ? world_coords.x - 2.0f : world_coords.x + 2.0f, world_coords.y == 0 ? world_coords.y : text_y, world_coords.z, false, 0.02, glm::vec3(1.0, 1.0, 1.0));
-        }
     }
+}
 
-    char msg[128];
-    snprintf(msg, sizeof(msg), "Circular Perspective (%.3fMhz - %.3fMhz)", sampler_->getStartFrequency() / 1000000.0f, sampler_->getEndFrequency() / 1000000.0f);
-    frame_->addText(msg, 10, 10, 0, true, 1.0, glm::vec3(1.0, 1.0, 1.0));
+void CircularSpectrum::addLevelLabels()
+{
+    uint64_t coalesced_bin_count = coalesced_bins_.size();
 
-    frame_queue->enqueueFrame(frame_);
+    uint64_t marker_spacing = coalesced_bin_count / max_freq_markers_;
+    if (marker_spacing == 0)
+    {
+        marker_spacing = 2;
+    }
 
-    display_manager_->setUpdateSceneCallback(std::bind(&CircularSpectrum::updateSceneCallback, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4));
+    for (uint64_t bin_id = 0; bin_id < coalesced_bin_count; bin_id += marker_spacing)
+    {
+        if (bin_id >= coalesced_bin_count - 2)
+        {
+            break;
+        }
 
-    frame_queue->setReady();
-    frame_queue->setActive();    // transfer ownership to DisplayManager
+        glm::vec3 world_coords = coalesced_bins_[bin_id]->getPosition();
+
+        char msg[64];
+        snprintf(msg, sizeof(msg), "%.3fMHz", samples_->getBinFrequency(bin_id * bin_coalesce_factor_) / 1000000.0f);
+        float text_y = world_coords.y > 0 ? world_coords.y - 2.0f : world_coords.y + 2.0f;
+        level_text_ids_.push_back(frame_->addText(msg, world_coords.x > 0 ? world_coords.x - 2.0f : world_coords.x + 2.0f, world_coords.y == 0 ? world_coords.y : text_y, world_coords.z, false, 0.02, glm::vec3(1.0, 1.0, 1.0)));
+    }
 }
 
 void CircularSpectrum::updateSceneCallback(GLfloat secs_since_rendering_started, GLfloat secs_since_framequeue_started, GLfloat secs_since_last_renderloop, GLfloat secs_since_last_frame)
 {
+    if (followSamplerRange())
+    {
+        return;
+    }
+
     uint16_t current_ring = 0;
 
-    if (samples_->getSweepCount() && current_interest_markers_ < max_interest_markers_)
+    if (getNotifiedSweepCount() && current_interest_markers_ < max_interest_markers_)
     {
         markLocalMaxima();
     }
 
+    updateSamplerStatsOverlay(secs_since_rendering_started);
+
     frame_->updateObjects(secs_since_rendering_started, secs_since_framequeue_started, secs_since_last_renderloop, secs_since_last_frame, static_cast<void*>(&current_ring));
 }
 
@@ -15,6 +15,10 @@ private:
     void updateSceneCallback(GLfloat secs_since_rendering_started, GLfloat secs_since_framequeue_started, GLfloat secs_since_last_renderloop, GLfloat secs_since_last_frame);
     void addInterestMarkerToBin(SimpleSpectrumRange *bin);
 
+    void showLevel(uint32_t coalesce_factor) override;
+    void addLevel(uint32_t coalesce_factor, std::vector<SimpleSpectrumRange*>& ranges) override;
+    void addLevelLabels() override;
+
     uint16_t radius_;
     std::vector<unsigned long> marked_bin_text_ids_;
 };
@@ -2,6 +2,7 @@
 
 #include <cmath>
 #include <iostream>
+#include <algorithm>
 
 #include "scenario/RotatedSpectrumRange.h"
 
@@ -15,6 +16,12 @@ CylindricalSpectrum::CylindricalSpectrum(insight::WindowManager* window_manager,
     current_sweep_ = 0;
 
     tracking_mouse_ = false;
+
+    // The left mouse button steers the camera
+    picking_mouse_button_ = SDL_BUTTON_RIGHT;
+
+    // Ranges are moved out from the cylinder by their amplitude on every update
+    picking_ranges_move_ = true;
 }
 
 void CylindricalSpectrum::run()
@@ -34,7 +41,7 @@ void CylindricalSpectrum::run()
 
     frame_ = frame_queue->newFrame();
 
-    current_sweep_ = samples_->getSweepCount();
+    current_sweep_ = getNotifiedSweepCount();
     addSpectrumRanges(0, 0);
 
     char msg[128];
@@ -54,15 +61,23 @@ void CylindricalSpectrum::run()
 
 void CylindricalSpectrum::updateSceneCallback(GLfloat secs_since_rendering_started, GLfloat secs_since_framequeue_started, GLfloat secs_since_last_renderloop, GLfloat secs_since_last_frame)
 {
+    if (followSamplerRange())
+    {
+        return;
+    }
+
     // If the samplers have completed a new full sweep of the spectrum, move onto the next time slice
-    if (samples_->getSweepCount() != current_sweep_)
+    if (getNotifiedSweepCount() != current_sweep_)
     {
-        current_sweep_ = samples_->getSweepCount();
+        current_sweep_ = getNotifiedSweepCount();
+        showSweepHistory(current_ring_, current_sweep_, secs_since_rendering_started, secs_since_framequeue_started, secs_since_last_renderloop, secs_since_last_frame);
         current_ring_++;
 
         addSpectrumRanges(current_ring_, secs_since_framequeue_started);
     }
 
+    updateSamplerStatsOverlay(secs_since_rendering_started);
+
     frame_->updateObjects(secs_since_rendering_started, secs_since_framequeue_started, secs_since_last_renderloop, secs_since_last_frame, static_cast<void*>(&current_ring_));
 }
 
@@ -74,18 +89,15 @@ void CylindricalSpectrum::addSpectrumRanges(uint16_t ring_id, GLfloat secs_since
     std::cout << "Coalescing " << raw_bin_count << " frequency bins into " << coalesced_bin_count << " visual bins" << std::endl;
 
     double rad_per_bin = (2*M_PI) / (coalesced_bin_count * bin_width_);     // each full spectrum band wraps once around the sphere
+    picking_radius_ = (radius_ * rad_per_bin * bin_width_) / 2.0;           // half the distance between neighbouring bins
 
     glm::vec3 start_coords = glm::vec3(0, 0, -1.0 * ring_id);               // initial co-ordinates of the sphere's center
 
     for (uint64_t bin_id = 0; bin_id < coalesced_bin_count; bin_id++)
     {
         // Coalesce the frequency bins
-        std::vector<sdr::FrequencyBin const*> frequency_bins;
         uint64_t start_frequency_bin = bin_id * bin_coalesce_factor_;
-        for (uint64_t j = start_frequency_bin; j < (start_frequency_bin + bin_coalesce_factor_) && j < raw_bin_count; j++)
-        {
-            frequency_bins.push_back(samples_->getFrequencyBin(j));
-        }
+        uint64_t frequency_bin_count = std::min<uint64_t>(bin_coalesce_factor_, raw_bin_count - start_frequency_bin);
 
         double theta = (rad_per_bin * bin_id * bin_width_);
         glm::vec3 world_coords = start_coords;
@@ -93,7 +105,7 @@ void CylindricalSpectrum::addSpectrumRanges(uint16_t ring_id, GLfloat secs_since
         world_coords.x += radius_ * cos(theta);
         world_coords.y += radius_ * sin(theta);
 
-        RotatedSpectrumRange* bin = new RotatedSpectrumRange(display_manager_, insight::primitive::Primitive::Type::TRANSFORMING_RECTANGLE, ring_id, bin_id, world_coords, theta, 0, radius_, glm::vec3(1, 1, 1), frequency_bins);
+        RotatedSpectrumRange* bin = new RotatedSpectrumRange(display_manager_, insight::primitive::Primitive::Type::TRANSFORMING_RECTANGLE, ring_id, bin_id, world_coords, theta, 0, radius_, glm::vec3(1, 1, 1), samples_, start_frequency_bin, frequency_bin_count);
         bin->setEnableRotationAroundY(false);
         bin->setScale(bin_width_, 1, 1);
 
@@ -151,6 +163,8 @@ void CylindricalSpectrum::handleMouse(insight::WindowManager* window_manager, SD
 {
     GLfloat mouse_sensitivity = 0.001f;
 
+    SimpleSpectrum::handleMouse(window_manager, mouse_event, secs_since_last_renderloop);
+
     if (mouse_event.type == SDL_MOUSEBUTTONDOWN && mouse_event.button.button == SDL_BUTTON_LEFT)
     {
         tracking_mouse_ = true;
@@ -158,7 +172,7 @@ void CylindricalSpectrum::handleMouse(insight::WindowManager* window_manager, SD
         mouse_start_x_ = mouse_event.motion.x;
         mouse_start_y_ = mouse_event.motion.y;
     }
-    else if (mouse_event.type == SDL_MOUSEBUTTONUP)
+    else if (mouse_event.type == SDL_MOUSEBUTTONUP && mouse_event.button.button == SDL_BUTTON_LEFT)
     {
         tracking_mouse_ = false;
     }
@@ -1,10 +1,15 @@
 #include "GridSpectrum.h"
 
 #include <iostream>
+#include <algorithm>
+
+// Number of ranges in each row of the grid.
+#define GRID_WIDTH 80
 
 GridSpectrum::GridSpectrum(insight::WindowManager* window_manager, sdr::SpectrumSampler* sampler, uint32_t bin_coalesce_factor)
         : SimpleSpectrum(window_manager, sampler, bin_coalesce_factor)
 {
+    picking_radius_ = 0.5f;     // grid cells are 1.0 apart
 }
 
 void GridSpectrum::run()
@@ -21,66 +26,80 @@ void GridSpectrum::run()
 
     frame_ = frame_queue->newFrame();
 
-    uint64_t raw_bin_count = samples_->getBinCount();
-    uint64_t coalesced_bin_count = (raw_bin_count + bin_coalesce_factor_ - 1) / bin_coalesce_factor_; // integer ceiling
+    showLevel(bin_coalesce_factor_);
 
-    std::cout << "Coalescing " << raw_bin_count << " frequency bins into " << coalesced_bin_count << " visual bins" << std::endl;
+    char msg[128];
+    snprintf(msg, sizeof(msg), "Grid Perspective (%.3fMhz - %.3fMhz)", sampler_->getStartFrequency() / 1000000.0f, sampler_->getEndFrequency() / 1000000.0f);
+    frame_->addText(msg, 10, 10, 0, true, 1.0, glm::vec3(1.0, 1.0, 1.0));
 
-    uint32_t grid_width = 80;
-    glm::vec3 start_coords = glm::vec3(-1.0f * (grid_width / 2.0f), 0, 0);
+    frame_queue->enqueueFrame(frame_);
+
+    display_manager_->setUpdateSceneCallback(std::bind(&GridSpectrum::updateSceneCallback, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4));
+
+    frame_queue->setReady();
+    if (frame_queue->setActive())
+    {
+        display_manager_->setFrameQueue(std::move(frame_queue));
+    }
+}
+
+void GridSpectrum::addLevel(uint32_t coalesce_factor, std::vector<SimpleSpectrumRange*>& ranges)
+{
+    uint64_t raw_bin_count = samples_->getBinCount();
+    uint64_t coalesced_bin_count = (raw_bin_count + coalesce_factor - 1) / coalesce_factor; // integer ceiling
+
+    glm::vec3 start_coords = glm::vec3(-1.0f * (GRID_WIDTH / 2.0f), 0, 0);
 
     for (uint64_t bin_id = 0; bin_id < coalesced_bin_count; bin_id++)
     {
         // Coalesce the frequency bins
-        std::vector<sdr::FrequencyBin const*> frequency_bins;
-        uint64_t start_frequency_bin = bin_id * bin_coalesce_factor_;
-        for (uint64_t j = start_frequency_bin; j < (start_frequency_bin + bin_coalesce_factor_) && j < raw_bin_count; j++)
-        {
-            frequency_bins.push_back(samples_->getFrequencyBin(j));
-        }
+        uint64_t start_frequency_bin = bin_id * coalesce_factor;
+        uint64_t frequency_bin_count = std::min<uint64_t>(coalesce_factor, raw_bin_count - start_frequency_bin);
 
         glm::vec3 world_coords = start_coords;
-        world_coords.x += (bin_id % grid_width);
+        world_coords.x += (bin_id % GRID_WIDTH);
 
-        SimpleSpectrumRange* bin = new SimpleSpectrumRange(display_manager_, insight::primitive::Primitive::Type::RECTANGLE, 0, bin_id, world_coords, glm::vec3(1, 1, 1), frequency_bins);
+        SimpleSpectrumRange* bin = new SimpleSpectrumRange(display_manager_, insight::primitive::Primitive::Type::RECTANGLE, 0, bin_id, world_coords, glm::vec3(1, 1, 1), samples_, start_frequency_bin, frequency_bin_count);
 
-        coalesced_bins_.push_back(bin);
+        ranges.push_back(bin);
         frame_->addObject(bin);
 
-        if (bin_id != 0 && (bin_id % grid_width) == 0)
+        if (bin_id != 0 && (bin_id % GRID_WIDTH) == 0)
         {
-            char msg[64];
-            snprintf(msg, sizeof(msg), "%.2fMHz", const_cast<sdr::FrequencyBin*>(frequency_bins[0])->getFrequency() / 1000000.0f);
-            frame_->addText(msg, world_coords.x - 5.0f, 0.0f, world_coords.z, false, 0.02, glm::vec3(1.0, 1.0, 1.0));
-
             start_coords.z -= 1.0f;
         }
     }
+}
 
-    char msg[128];
-    snprintf(msg, sizeof(msg), "Grid Perspective (%.3fMhz - %.3fMhz)", sampler_->getStartFrequency() / 1000000.0f, sampler_->getEndFrequency() / 1000000.0f);
-    frame_->addText(msg, 10, 10, 0, true, 1.0, glm::vec3(1.0, 1.0, 1.0));
-
-    frame_queue->enqueueFrame(frame_);
-
-    display_manager_->setUpdateSceneCallback(std::bind(&GridSpectrum::updateSceneCallback, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4));
-
-    frame_queue->setReady();
-    if (frame_queue->setActive())
+void GridSpectrum::addLevelLabels()
+{
+    // Every row after the first is labelled with the frequency of the range it starts with
+    for (uint64_t bin_id = GRID_WIDTH; bin_id < coalesced_bins_.size(); bin_id += GRID_WIDTH)
     {
-        display_manager_->setFrameQueue(std::move(frame_queue));
+        char msg[64];
+        snprintf(msg, sizeof(msg), "%.2fMHz", samples_->getBinFrequency(bin_id * bin_coalesce_factor_) / 1000000.0f);
+
+        GLfloat row_z = -1.0f * ((bin_id / GRID_WIDTH) - 1);
+        level_text_ids_.push_back(frame_->addText(msg, (-1.0f * (GRID_WIDTH / 2.0f)) - 5.0f, 0.0f, row_z, false, 0.02, glm::vec3(1.0, 1.0, 1.0)));
     }
 }
 
 void GridSpectrum::updateSceneCallback(GLfloat secs_since_rendering_started, GLfloat secs_since_framequeue_started, GLfloat secs_since_last_renderloop, GLfloat secs_since_last_frame)
 {
+    if (followSamplerRange())
+    {
+        return;
+    }
+
     uint16_t current_slice = 0;
 
-    if (samples_->getSweepCount() && current_interest_markers_ < max_interest_markers_)
+    if (getNotifiedSweepCount() && current_interest_markers_ < max_interest_markers_)
     {
         markLocalMaxima();
     }
 
+    updateSamplerStatsOverlay(secs_since_rendering_started);
+
     frame_->updateObjects(secs_since_rendering_started, secs_since_framequeue_started, secs_since_last_renderloop, secs_since_last_frame, static_cast<void*>(&current_slice));
 }
 
@@ -54,11 +54,18 @@ std::vector<std::string> Help::options_ = {
         "h: This help screen",
         "n: Cycle to next perspective",
         "[ ]: Reduce / increase FFT resolution",
+        "l: Pick FFT resolution automatically from the camera distance (linear perspective)",
         "c: Clear max amplitude markers",
         "o p: Reduce / increase number of max amplitude markers allowed",
-        ", .: Reduce / increase minimum amplitude to consider for max amplitude markers",
-        "mouse: Select frequency range for zooming (in linear view only)",
+        ", .: Reduce / increase minimum amplitude (or SNR) to consider for max amplitude markers",
+        "m: Toggle max amplitude markers between absolute amplitude and SNR",
+        "mouse: Select frequency range for zooming (right button in time sliced views)",
         "u: Undo last zoom",
+        "i: Show / hide sampler statistics",
+        "- =: Reduce / increase gain",
+        "v: Toggle AGC",
+        "x: Toggle DC spike removal",
+        "j k: Reduce / increase dwell time",
         "w s a f: Move camera forward / backward / left / right",
         "arrows: Point camera in different direction (can also use mouse)",
         "q: Quit"
@@ -1,16 +1,30 @@
 #include "LinearSpectrum.h"
 
 #include <iostream>
+#include <algorithm>
+#include <cmath>
 
 #include <scenario/SimpleSpectrum.h>
 
+// World width of each bar at the coalesce factor the scenario is run with.
+#define BAR_WIDTH 0.5f
+
+// How often the automatic level of detail is re-evaluated against the camera.
+#define LOD_CHECK_SECS 0.25f
+
+// A finer level is only switched to once its bars would be at least this many pixels wide.
+#define LOD_REFINE_PIXELS 2.0
+
+// Never lay out more bars than this, however close the camera gets.
+#define LOD_MAX_RANGES 65536
+
 LinearSpectrum::LinearSpectrum(insight::WindowManager* window_manager, sdr::SpectrumSampler* sampler, uint32_t bin_coalesce_factor)
         : SimpleSpectrum(window_manager, sampler, bin_coalesce_factor)
 {
-    start_picking_bin_ = nullptr;
-    last_picked_bin_ = nullptr;
-
     max_freq_markers_ = 4;
+    bins_start_x_ = 0.0f;
+    spectrum_width_ = 0.0f;
+    lod_checked_at_ = 0.0f;
 }
 
 void LinearSpectrum::run()
@@ -27,48 +41,37 @@ void LinearSpectrum::run()
     display_manager_->resetCamera(glm::vec3(0, 5, 31));
     display_manager_->setPerspective(0.1f, 100.0f, 45.0f);
 
+    // The spectrum keeps the width it has at this coalesce factor, other levels narrow or widen its bars
+    lod_checked_at_ = 0.0f;
+    spectrum_width_ = getRangeCount(bin_coalesce_factor_) * BAR_WIDTH;
+    bins_start_x_ = -1.0f * (spectrum_width_ / 2.0f);
+
+    buildFrame();
+}
+
+void LinearSpectrum::buildFrame()
+{
     std::unique_ptr<insight::FrameQueue> frame_queue = std::make_unique<insight::FrameQueue>(display_manager_, true);
     frame_queue->setFrameRate(1);
 
     frame_ = frame_queue->newFrame(false);
 
-    uint64_t raw_bin_count = samples_->getBinCount();
-    uint64_t coalesced_bin_count = (raw_bin_count + bin_coalesce_factor_ - 1) / bin_coalesce_factor_; // integer ceiling
+    uint64_t coalesced_bin_count = getRangeCount(bin_coalesce_factor_);
+    GLfloat bar_width = spectrum_width_ / coalesced_bin_count;
 
-    std::cout << "Coalescing " << raw_bin_count << " frequency bins into " << coalesced_bin_count << " visual bins" << std::endl;
+    showLevel(bin_coalesce_factor_);
 
     uint64_t marker_spacing = coalesced_bin_count / max_freq_markers_;
-    glm::vec3 start_coords = glm::vec3(-1.0f * ((coalesced_bin_count * bin_width_) / 2.0f), 0, 0);
     if (marker_spacing == 0)
     {
         marker_spacing = 2;
     }
 
-    for (uint64_t bin_id = 0; bin_id < coalesced_bin_count; bin_id++)
+    for (uint64_t bin_id = 0; bin_id < coalesced_bin_count; bin_id += marker_spacing)
     {
-        // Coalesce the frequency bins
-        std::vector<sdr::FrequencyBin const*> frequency_bins;
-        uint64_t start_frequency_bin = bin_id * bin_coalesce_factor_;
-        for (uint64_t j = start_frequency_bin; j < (start_frequency_bin + bin_coalesce_factor_) && j < raw_bin_count; j++)
-        {
-            frequency_bins.push_back(samples_->getFrequencyBin(j));
-        }
-
-        glm::vec3 world_coords = start_coords;
-        world_coords.x += (bin_id * bin_width_);
-
-        SimpleSpectrumRange* bin = new SimpleSpectrumRange(display_manager_, insight::primitive::Primitive::Type::RECTANGLE, 0, bin_id, world_coords, glm::vec3(1, 1, 1), frequency_bins);
-        bin->setScale(bin_width_, 1.0, 1.0);
-
-        coalesced_bins_.push_back(bin);
-        frame_->addObject(bin);
-
-        if (bin_id % marker_spacing == 0)
-        {
-            char msg[64];
-            snprintf(msg, sizeof(msg), "%.3fMHz", const_cast<sdr::FrequencyBin*>(frequency_bins[0])->getFrequency() / 1000000.0f);
-            frame_->addText(msg, world_coords.x, -2.0f, world_coords.z, false, 0.02, glm::vec3(1.0, 1.0, 1.0));
-        }
+        char msg[64];
+        snprintf(msg, sizeof(msg), "%.3fMHz", samples_->getBinFrequency(bin_id * bin_coalesce_factor_) / 1000000.0f);
+        frame_->addText(msg, bins_start_x_ + (bin_id * bar_width), -2.0f, 0, false, 0.02, glm::vec3(1.0, 1.0, 1.0));
     }
 
     char msg[128];
@@ -88,16 +91,122 @@ void LinearSpectrum::run()
 
 void LinearSpectrum::updateSceneCallback(GLfloat secs_since_rendering_started, GLfloat secs_since_framequeue_started, GLfloat secs_since_last_renderloop, GLfloat secs_since_last_frame)
 {
+    if (followSamplerRange())
+    {
+        return;
+    }
+
     uint16_t current_slice = 0;
 
-    if (samples_->getSweepCount() && current_interest_markers_ < max_interest_markers_)
+    if (getNotifiedSweepCount() && current_interest_markers_ < max_interest_markers_)
     {
         markLocalMaxima();
     }
 
+    updateSamplerStatsOverlay(secs_since_rendering_started);
+    updateLevelOfDetail(secs_since_rendering_started);
+
     frame_->updateObjects(secs_since_rendering_started, secs_since_framequeue_started, secs_since_last_renderloop, secs_since_last_frame, static_cast<void*>(&current_slice));
 }
 
+uint64_t LinearSpectrum::getRangeCount(uint32_t coalesce_factor)
+{
+    return (samples_->getBinCount() + coalesce_factor - 1) / coalesce_factor;
+}
+
+void LinearSpectrum::rebuildFrame(uint32_t coalesce_factor)
+{
+    // Unlike run() this keeps the camera and the spectrum's width
+    resetState();
+    bin_coalesce_factor_ = coalesce_factor;
+    buildFrame();
+}
+
+void LinearSpectrum::showLevel(uint32_t coalesce_factor)
+{
+    SimpleSpectrum::showLevel(coalesce_factor);
+
+    // Every level spans spectrum_width_, so finer levels have narrower bars
+    bin_width_ = spectrum_width_ / coalesced_bins_.size();
+    picking_radius_ = bin_width_ / 2.0f;
+}
+
+void LinearSpectrum::addLevel(uint32_t coalesce_factor, std::vector<SimpleSpectrumRange*>& ranges)
+{
+    uint64_t raw_bin_count = samples_->getBinCount();
+    uint64_t coalesced_bin_count = getRangeCount(coalesce_factor);
+    GLfloat bar_width = spectrum_width_ / coalesced_bin_count;
+
+    for (uint64_t bin_id = 0; bin_id < coalesced_bin_count; bin_id++)
+    {
+        // Coalesce the frequency bins
+        uint64_t start_frequency_bin = bin_id * coalesce_factor;
+        uint64_t frequency_bin_count = std::min<uint64_t>(coalesce_factor, raw_bin_count - start_frequency_bin);
+
+        glm::vec3 world_coords = glm::vec3(bins_start_x_ + (bin_id * bar_width), 0, 0);
+
+        SimpleSpectrumRange* bin = new SimpleSpectrumRange(display_manager_, insight::primitive::Primitive::Type::RECTANGLE, 0, bin_id, world_coords, glm::vec3(1, 1, 1), samples_, start_frequency_bin, frequency_bin_count);
+        bin->setScale(bar_width, 1.0, 1.0);
+
+        ranges.push_back(bin);
+        frame_->addObject(bin);
+    }
+}
+
+void LinearSpectrum::updateLevelOfDetail(GLfloat secs_since_rendering_started)
+{
+    if ( ! auto_lod_ || (secs_since_rendering_started - lod_checked_at_) < LOD_CHECK_SECS)
+    {
+        return;
+    }
+
+    lod_checked_at_ = secs_since_rendering_started;
+
+    // Angle between the rays through neighbouring pixels (approximately, it shrinks slightly towards the edges of the
+    // screen)
+    glm::vec3 ray = glm::normalize(display_manager_->getRayFromCamera(0, 0));
+    glm::vec3 next_ray = glm::normalize(display_manager_->getRayFromCamera(1, 0));
+    GLfloat pixel_angle = acos(std::min(1.0f, glm::dot(ray, next_ray)));
+    if (pixel_angle <= 0.0f)
+    {
+        return;
+    }
+
+    // Bars are widest on screen where the spectrum is nearest the camera, so that's where they must not get any
+    // narrower than a pixel
+    glm::vec3 camera_coords = display_manager_->getCameraCoords();
+    glm::vec3 nearest_coords = glm::vec3(std::max(bins_start_x_, std::min(bins_start_x_ + spectrum_width_, camera_coords.x)), 0, 0);
+    GLfloat distance = std::max(glm::length(camera_coords - nearest_coords), 0.001f);
+
+    double spectrum_pixels = spectrum_width_ / (distance * pixel_angle);
+
+    // Levels step through powers of two (whatever the factor was set to by hand) so that each is exactly half or
+    // double its neighbours and the camera only ever visits a few of them
+    uint32_t coalesce_factor = 1;
+    while (coalesce_factor < bin_coalesce_factor_)
+    {
+        coalesce_factor *= 2;
+    }
+
+    // Coarsen until there are no more bars than pixels, and only refine once the finer level fits comfortably so that
+    // small camera movements don't flip between levels
+    while (getRangeCount(coalesce_factor) > spectrum_pixels && getRangeCount(coalesce_factor) > 1)
+    {
+        coalesce_factor *= 2;
+    }
+
+    while (coalesce_factor > 1 && getRangeCount(coalesce_factor / 2) * LOD_REFINE_PIXELS <= spectrum_pixels &&
+           getRangeCount(coalesce_factor / 2) <= LOD_MAX_RANGES)
+    {
+        coalesce_factor /= 2;
+    }
+
+    if (coalesce_factor != bin_coalesce_factor_)
+    {
+        showLevel(coalesce_factor);
+    }
+}
+
 void LinearSpectrum::clearInterestMarkers()
 {
     if (frame_ == nullptr)
@@ -167,81 +276,41 @@ void LinearSpectrum::handleKeystroke(insight::WindowManager* window_manager, SDL
     }
 }
 
-void LinearSpectrum::handleMouse(insight::WindowManager* window_manager, SDL_Event mouse_event, GLfloat secs_since_last_renderloop)
+SimpleSpectrumRange* LinearSpectrum::findFirstIntersectedBin(GLuint mouse_x, GLuint mouse_y)
 {
-    if (mouse_event.type == SDL_MOUSEBUTTONDOWN && mouse_event.button.button == SDL_BUTTON_LEFT)
-    {
-        start_picking_bin_ = findFirstIntersectedBin(mouse_event.motion.x, mouse_event.motion.y);
-        last_picked_bin_ = nullptr;
+    glm::vec3 ray_start_coords = display_manager_->getCameraCoords();
+    glm::vec3 ray = display_manager_->getRayFromCamera(mouse_x, mouse_y);
 
-        if (start_picking_bin_)
-        {
-            highlightPickedBins(start_picking_bin_);
-            return;
-        }
-    }
-    else if (start_picking_bin_ && mouse_event.type == SDL_MOUSEMOTION)
+    // Where does the ray cross the plane the bars are drawn in?
+    if (fabs(ray.z) < 1e-6f || coalesced_bins_.empty())
     {
-        SimpleSpectrumRange* end_picking_bin = findFirstIntersectedBin(mouse_event.motion.x, mouse_event.motion.y);
-
-        if (end_picking_bin)
-        {
-            highlightPickedBins(end_picking_bin);
-            return;
-        }
+        return nullptr;
     }
-    else if (start_picking_bin_ && mouse_event.type == SDL_MOUSEBUTTONUP)
-    {
-        if (last_picked_bin_ && last_picked_bin_ != start_picking_bin_)
-        {
-            // Save the current range so we can return to it
-            ZoomRange current_range = {
-                    sampler_->getStartFrequency(),
-                    sampler_->getEndFrequency()
-            };
-            previous_zoom_ranges_.push(current_range);
 
-            uint64_t start_freq_hz = start_picking_bin_->getBinId() < last_picked_bin_->getBinId() ? start_picking_bin_->getFrequency() : last_picked_bin_->getFrequency();
-            uint64_t end_freq_hz = start_picking_bin_->getBinId() < last_picked_bin_->getBinId() ? last_picked_bin_->getFrequency() : start_picking_bin_->getFrequency();
-
-            max_freq_markers_ = 2;
-
-            retune(start_freq_hz, end_freq_hz, true);
-        }
-
-        start_picking_bin_ = nullptr;
-        last_picked_bin_ = nullptr;
+    GLfloat len = (coalesced_bins_[0]->getPosition().z - ray_start_coords.z) / ray.z;
+    if (len < 0)
+    {
+        return nullptr;     // the bars are behind the camera
     }
-}
 
-SimpleSpectrumRange* LinearSpectrum::findFirstIntersectedBin(GLuint mouse_x, GLuint mouse_y)
-{
-    glm::vec3 ray_start_coords = window_manager_->getDisplayManager()->getCameraCoords();
+    glm::vec3 ray_end_coords = ray_start_coords + (ray * len);
 
-    /**
-     * NOTE: This is a terrible and naive intersection test, please improve it.
-     */
-    for (SimpleSpectrumRange* bin : coalesced_bins_)
+    // Bars are positioned by their center, each bin_width_ apart
+    double bin_offset = floor(((ray_end_coords.x - bins_start_x_) / bin_width_) + 0.5);
+    if (bin_offset < 0 || bin_offset >= coalesced_bins_.size())
     {
-        glm::vec3 pos = bin->getPosition();
-        glm::vec3 scale = bin->getScale();
-
-        glm::vec3 top = pos, bottom = pos, left = pos, right = pos;
-        top.y += scale.y / 2.0f;
-        bottom.y -= scale.y / 2.0f;
-        left -= scale.x / 2.0f;
-        right += scale.x / 2.0f;
+        return nullptr;
+    }
 
-        // What is the length of the ray from the camera to the object's center?
-        GLfloat len = glm::length(pos - display_manager_->getCameraCoords());
+    SimpleSpectrumRange* bin = coalesced_bins_[static_cast<uint64_t>(bin_offset)];
 
-        glm::vec3 ray_end_coords = ray_start_coords + (window_manager_->getDisplayManager()->getRayFromCamera(mouse_x, mouse_y) * len);
+    glm::vec3 pos = bin->getPosition();
+    glm::vec3 scale = bin->getScale();
 
-        if (ray_end_coords.x >= left.x && ray_end_coords.x <= right.x && ray_end_coords.y <= top.y && ray_end_coords.y >= bottom.y)
-        {
-            return bin;
-        }
+    if (ray_end_coords.y > pos.y + (scale.y / 2.0f) || ray_end_coords.y < pos.y - (scale.y / 2.0f))
+    {
+        return nullptr;
     }
 
-    return nullptr;
+    return bin;
 }
@@ -13,15 +13,38 @@ public:
 
     // insight::InputHandler overrides
     void handleKeystroke(insight::WindowManager* window_manager, SDL_Event keystroke_event, GLfloat secs_since_last_renderloop) override;
-    void handleMouse(insight::WindowManager* window_manager, SDL_Event mouse_event, GLfloat secs_since_last_renderloop) override;
 
 private:
     void updateSceneCallback(GLfloat secs_since_rendering_started, GLfloat secs_since_framequeue_started, GLfloat secs_since_last_renderloop, GLfloat secs_since_last_frame);
 
     void addInterestMarkerToBin(SimpleSpectrumRange *bin);
 
-    // Ray casts through spectrum bins on a mouse click to find zoom start / end points.
-    SimpleSpectrumRange* findFirstIntersectedBin(GLuint mouse_x, GLuint mouse_y);
+    // Starts a new frame showing bin_coalesce_factor_ across spectrum_width_, with its frequency markers.
+    void buildFrame();
+
+    // Number of bars the spectrum is drawn with when coalesce_factor bins are averaged into each.
+    uint64_t getRangeCount(uint32_t coalesce_factor);
+
+    // Rebuilds with buildFrame() rather than run(), so that the view isn't reset when the level of detail changes.
+    void rebuildFrame(uint32_t coalesce_factor) override;
+
+    // Sizes bin_width_ and picking to the level's bars, which always span spectrum_width_.
+    void showLevel(uint32_t coalesce_factor) override;
+    void addLevel(uint32_t coalesce_factor, std::vector<SimpleSpectrumRange*>& ranges) override;
+
+    // When auto_lod_ is set, switches to the finest level whose bars are still at least a pixel wide where the
+    // spectrum is nearest the camera.
+    void updateLevelOfDetail(GLfloat secs_since_rendering_started);
+
+    // All bars sit side by side in the z = 0 plane, so the ray only needs intersecting with that plane once and the
+    // x co-ordinate of the intersection maps directly to a bin.
+    SimpleSpectrumRange* findFirstIntersectedBin(GLuint mouse_x, GLuint mouse_y) override;
+
+    // World x co-ordinate of the center of the first (lowest frequency) bar, and the width of all of them together.
+    GLfloat bins_start_x_;
+    GLfloat spectrum_width_;
+
+    GLfloat lod_checked_at_;
 
     // IDs of the text objects used on SimpleSpectrumRanges that have interest markers.
     std::vector<unsigned long> marked_bin_text_ids_;
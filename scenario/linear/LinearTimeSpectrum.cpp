@@ -1,6 +1,7 @@
 #include "LinearTimeSpectrum.h"
 
 #include <iostream>
+#include <algorithm>
 
 LinearTimeSpectrum::LinearTimeSpectrum(insight::WindowManager* window_manager, sdr::SpectrumSampler* sampler, uint32_t bin_coalesce_factor)
         : SimpleSpectrum(window_manager, sampler, bin_coalesce_factor)
@@ -8,8 +9,12 @@ LinearTimeSpectrum::LinearTimeSpectrum(insight::WindowManager* window_manager, s
     slices_ = 0;
     current_slice_ = 0;
     current_sweep_ = 0;
+    first_capture_ns_ = -1;
 
     tracking_mouse_ = false;
+
+    // The left mouse button steers the camera
+    picking_mouse_button_ = SDL_BUTTON_RIGHT;
 }
 
 void LinearTimeSpectrum::run()
@@ -29,7 +34,8 @@ void LinearTimeSpectrum::run()
 
     frame_ = frame_queue->newFrame();
 
-    current_sweep_ = samples_->getSweepCount();
+    current_sweep_ = getNotifiedSweepCount();
+    first_capture_ns_ = -1;
     addSpectrumRanges(0, 0);
 
     char msg[128];
@@ -49,20 +55,29 @@ void LinearTimeSpectrum::run()
 
 void LinearTimeSpectrum::updateSceneCallback(GLfloat secs_since_rendering_started, GLfloat secs_since_framequeue_started, GLfloat secs_since_last_renderloop, GLfloat secs_since_last_frame)
 {
+    if (followSamplerRange())
+    {
+        return;
+    }
+
     // If the samplers have completed a new full sweep of the spectrum, move onto the next time slice
-    if (samples_->getSweepCount() != current_sweep_)
+    if (getNotifiedSweepCount() != current_sweep_)
     {
-        current_sweep_ = samples_->getSweepCount();
+        current_sweep_ = getNotifiedSweepCount();
+        showSweepHistory(current_slice_, current_sweep_, secs_since_rendering_started, secs_since_framequeue_started, secs_since_last_renderloop, secs_since_last_frame);
+        addTimeLabel(current_slice_, secs_since_framequeue_started);
         current_slice_++;
 
         addSpectrumRanges(current_slice_, secs_since_framequeue_started);
     }
 
-//    if (samples_->getSweepCount() && current_interest_markers_ < max_interest_markers_)
+//    if (getNotifiedSweepCount() && current_interest_markers_ < max_interest_markers_)
 //    {
 //        markLocalMaxima();
 //    }
 
+    updateSamplerStatsOverlay(secs_since_rendering_started);
+
     frame_->updateObjects(secs_since_rendering_started, secs_since_framequeue_started, secs_since_last_renderloop, secs_since_last_frame, static_cast<void*>(&current_slice_));
 }
 
@@ -83,17 +98,13 @@ void LinearTimeSpectrum::addSpectrumRanges(uint16_t slice_id, GLfloat secs_since
     for (uint64_t bin_id = 0; bin_id < coalesced_bin_count; bin_id++)
     {
         // Coalesce the frequency bins
-        std::vector<sdr::FrequencyBin const*> frequency_bins;
         uint64_t start_frequency_bin = bin_id * bin_coalesce_factor_;
-        for (uint64_t j = start_frequency_bin; j < (start_frequency_bin + bin_coalesce_factor_) && j < raw_bin_count; j++)
-        {
-            frequency_bins.push_back(samples_->getFrequencyBin(j));
-        }
+        uint64_t frequency_bin_count = std::min<uint64_t>(bin_coalesce_factor_, raw_bin_count - start_frequency_bin);
 
         glm::vec3 world_coords = start_coords;
         world_coords.x += (bin_id * bin_width_);
 
-        SimpleSpectrumRange* bin = new SimpleSpectrumRange(display_manager_, insight::primitive::Primitive::Type::RECTANGLE, slice_id, bin_id, world_coords, glm::vec3(1, 1, 1), frequency_bins);
+        SimpleSpectrumRange* bin = new SimpleSpectrumRange(display_manager_, insight::primitive::Primitive::Type::RECTANGLE, slice_id, bin_id, world_coords, glm::vec3(1, 1, 1), samples_, start_frequency_bin, frequency_bin_count);
         bin->setScale(bin_width_, 1.0, 1.0);
 
         coalesced_bins_.push_back(bin);
@@ -105,17 +116,36 @@ void LinearTimeSpectrum::addSpectrumRanges(uint16_t slice_id, GLfloat secs_since
 
             if (slice_id == 0)
             {
-                snprintf(msg, sizeof(msg), "%.3fMHz", const_cast<sdr::FrequencyBin*>(frequency_bins[0])->getFrequency() / 1000000.0f);
+                snprintf(msg, sizeof(msg), "%.3fMHz", samples_->getBinFrequency(start_frequency_bin) / 1000000.0f);
                 frame_->addText(msg, world_coords.x, -2.0f, world_coords.z, false, 0.02, glm::vec3(1.0, 1.0, 1.0));
             }
+        }
+    }
+}
 
-            if (bin_id == 0)
-            {
-                snprintf(msg, sizeof(msg), "t = %.2f sec", secs_since_framequeue_started);
-                frame_->addText(msg, world_coords.x - 5.0f, -2.0f, world_coords.z, false, 0.02, glm::vec3(1.0, 1.0, 1.0));
-            }
+void LinearTimeSpectrum::addTimeLabel(uint16_t slice_id, GLfloat secs_since_framequeue_started)
+{
+    // Sweeps are labelled with when they were captured, viewers (which don't know) fall back to when they were rendered
+    double secs = secs_since_framequeue_started;
+
+    std::shared_ptr<const sdr::SweepSnapshot> snapshot = samples_->getLatestSnapshot();
+    int64_t capture_ns = snapshot ? snapshot->capture_ns_ : -1;
+    if (capture_ns >= 0)
+    {
+        if (first_capture_ns_ < 0)
+        {
+            first_capture_ns_ = capture_ns;
         }
+
+        secs = (capture_ns - first_capture_ns_) / 1000000000.0;
     }
+
+    uint64_t coalesced_bin_count = (samples_->getBinCount() + bin_coalesce_factor_ - 1) / bin_coalesce_factor_;
+    float x = -1.0f * ((coalesced_bin_count * bin_width_) / 2.0f);
+
+    char msg[64];
+    snprintf(msg, sizeof(msg), "t = %.3f sec", secs);
+    frame_->addText(msg, x - 5.0f, -2.0f, -1.0 * slice_id, false, 0.02, glm::vec3(1.0, 1.0, 1.0));
 }
 
 void LinearTimeSpectrum::addInterestMarkerToBin(SimpleSpectrumRange *bin)
@@ -176,6 +206,8 @@ void LinearTimeSpectrum::handleMouse(insight::WindowManager* window_manager, SDL
 {
     GLfloat mouse_sensitivity = 0.001f;
 
+    SimpleSpectrum::handleMouse(window_manager, mouse_event, secs_since_last_renderloop);
+
     if (mouse_event.type == SDL_MOUSEBUTTONDOWN && mouse_event.button.button == SDL_BUTTON_LEFT)
     {
         tracking_mouse_ = true;
@@ -183,7 +215,7 @@ void LinearTimeSpectrum::handleMouse(insight::WindowManager* window_manager, SDL
         mouse_start_x_ = mouse_event.motion.x;
         mouse_start_y_ = mouse_event.motion.y;
     }
-    else if (mouse_event.type == SDL_MOUSEBUTTONUP)
+    else if (mouse_event.type == SDL_MOUSEBUTTONUP && mouse_event.button.button == SDL_BUTTON_LEFT)
     {
         tracking_mouse_ = false;
     }
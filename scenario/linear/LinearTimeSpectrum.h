@@ -20,9 +20,13 @@ private:
 
     void addSpectrumRanges(uint16_t slice_id, GLfloat secs_since_framequeue_started);
 
+    // Labels slice_id with when its (just completed) sweep was captured, relative to the first sweep labelled.
+    void addTimeLabel(uint16_t slice_id, GLfloat secs_since_framequeue_started);
+
     uint16_t slices_;
     uint16_t current_slice_;
     uint64_t current_sweep_;
+    int64_t first_capture_ns_;
 
     // The mouse can be used to adjust the camera pointing vector in this scenario.
     bool tracking_mouse_;
@@ -0,0 +1,49 @@
+#include "OccupancyRange.h"
+
+#include <ctime>
+
+// Occupancy changes slowly, so cells only re-query the store this often.
+#define OCCUPANCY_REFRESH_SECS 2.0f
+
+OccupancyRange::OccupancyRange(insight::DisplayManager* display_manager, const glm::vec3& world_coords, sdr::OccupancyStore* occupancy,
+                               uint64_t start_bin, uint64_t end_bin, uint32_t hours_ago) :
+        insight::SceneObject(display_manager, insight::primitive::Primitive::Type::RECTANGLE, world_coords, glm::vec3(0.2, 0.2, 0.2)),
+        occupancy_(occupancy), start_bin_(start_bin), end_bin_(end_bin), hours_ago_(hours_ago)
+{
+    duty_cycle_ = -1.0f;
+    last_refreshed_at_ = 0.0f;
+    refreshed_ = false;
+}
+
+float OccupancyRange::getDutyCycle()
+{
+    return duty_cycle_;
+}
+
+void OccupancyRange::update(GLfloat secs_since_rendering_started, GLfloat secs_since_framequeue_started, GLfloat secs_since_last_renderloop, GLfloat secs_since_last_frame, void* context)
+{
+    if (refreshed_ && (secs_since_rendering_started - last_refreshed_at_) < OCCUPANCY_REFRESH_SECS)
+    {
+        return;
+    }
+
+    refreshed_ = true;
+    last_refreshed_at_ = secs_since_rendering_started;
+
+    // Each cell covers a whole hourly bucket
+    time_t now = time(nullptr);
+    time_t hour_start = ((now / sdr::OccupancyStore::BUCKET_SECONDS) - hours_ago_) * sdr::OccupancyStore::BUCKET_SECONDS;
+
+    duty_cycle_ = occupancy_->getDutyCycleForBins(start_bin_, end_bin_, hour_start, hour_start + sdr::OccupancyStore::BUCKET_SECONDS - 1);
+
+    if (duty_cycle_ < 0)
+    {
+        this->setScale(this->scale_x_, 0.1f, this->scale_z_);
+        this->setColour(glm::vec3(0.2f, 0.2f, 0.2f));
+        return;
+    }
+
+    // Quiet channels are blue, busy ones are red
+    this->setScale(this->scale_x_, 0.1f + (duty_cycle_ * 10.0f), this->scale_z_);
+    this->setColour(glm::vec3(duty_cycle_, 0.2f, 1.0f - duty_cycle_));
+}
@@ -0,0 +1,30 @@
+#ifndef WAVEGUIDE_SCENARIO_OCCUPANCY_OCCUPANCYRANGE_H
+#define WAVEGUIDE_SCENARIO_OCCUPANCY_OCCUPANCYRANGE_H
+
+#include "core/SceneObject.h"
+#include "sdr/OccupancyStore.h"
+
+// A single heatmap cell showing the duty cycle of a range of frequency bins during one hour.
+class OccupancyRange : public insight::SceneObject {
+public:
+    OccupancyRange(insight::DisplayManager* display_manager, const glm::vec3& world_coords, sdr::OccupancyStore* occupancy, uint64_t start_bin, uint64_t end_bin, uint32_t hours_ago);
+    virtual ~OccupancyRange() = default;
+
+    virtual void update(GLfloat secs_since_rendering_started, GLfloat secs_since_framequeue_started, GLfloat secs_since_last_renderloop, GLfloat secs_since_last_frame, void* context);
+
+    // Gets the most recently queried duty cycle (0.0 - 1.0, negative if nothing has been recorded).
+    float getDutyCycle();
+
+private:
+    sdr::OccupancyStore* occupancy_;
+
+    uint64_t start_bin_;
+    uint64_t end_bin_;
+    uint32_t hours_ago_;
+
+    float duty_cycle_;
+    GLfloat last_refreshed_at_;
+    bool refreshed_;
+};
+
+#endif //WAVEGUIDE_SCENARIO_OCCUPANCY_OCCUPANCYRANGE_H
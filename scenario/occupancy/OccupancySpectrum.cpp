@@ -0,0 +1,145 @@
+#include "OccupancySpectrum.h"
+
+#include <iostream>
+
+#include "OccupancyRange.h"
+
+OccupancySpectrum::OccupancySpectrum(insight::WindowManager* window_manager, sdr::SpectrumSampler* sampler, uint32_t bin_coalesce_factor)
+        : SimpleSpectrum(window_manager, sampler, bin_coalesce_factor)
+{
+    hours_ = 24;
+}
+
+void OccupancySpectrum::run()
+{
+    resetState();
+
+    display_manager_->resetCamera();
+    display_manager_->setCameraCoords(glm::vec3(-50, 15, 35));
+    display_manager_->setCameraPointingVector(glm::vec3(1, -0.3, -1.0));
+    display_manager_->setPerspective(0.1f, 150.0f, 45.0f);
+
+    std::unique_ptr<insight::FrameQueue> frame_queue = std::make_unique<insight::FrameQueue>(display_manager_, true);
+    frame_queue->setFrameRate(1);
+
+    frame_ = frame_queue->newFrame();
+
+    char msg[128];
+    sdr::OccupancyStore* occupancy = samples_->getOccupancy();
+
+    if (occupancy)
+    {
+        uint64_t raw_bin_count = samples_->getBinCount();
+        uint64_t coalesced_bin_count = (raw_bin_count + bin_coalesce_factor_ - 1) / bin_coalesce_factor_; // integer ceiling
+
+        std::cout << "Coalescing " << raw_bin_count << " frequency bins into " << coalesced_bin_count << " occupancy cells per hour" << std::endl;
+
+        uint64_t marker_spacing = coalesced_bin_count / max_freq_markers_;
+        if (marker_spacing == 0)
+        {
+            marker_spacing = 2;
+        }
+
+        for (uint32_t hours_ago = 0; hours_ago < hours_; hours_ago++)
+        {
+            glm::vec3 start_coords = glm::vec3(-1.0f * ((coalesced_bin_count * bin_width_) / 2.0f), 0, -1.0f * hours_ago);
+
+            for (uint64_t bin_id = 0; bin_id < coalesced_bin_count; bin_id++)
+            {
+                uint64_t start_frequency_bin = bin_id * bin_coalesce_factor_;
+                uint64_t end_frequency_bin = start_frequency_bin + bin_coalesce_factor_ - 1;
+
+                glm::vec3 world_coords = start_coords;
+                world_coords.x += (bin_id * bin_width_);
+
+                OccupancyRange* cell = new OccupancyRange(display_manager_, world_coords, occupancy, start_frequency_bin, end_frequency_bin, hours_ago);
+                cell->setScale(bin_width_, 0.1f, 1.0f);
+
+                frame_->addObject(cell);
+
+                if (hours_ago == 0 && bin_id % marker_spacing == 0)
+                {
+                    snprintf(msg, sizeof(msg), "%.3fMHz", samples_->getBinFrequency(start_frequency_bin) / 1000000.0f);
+                    frame_->addText(msg, world_coords.x, -2.0f, world_coords.z, false, 0.02, glm::vec3(1.0, 1.0, 1.0));
+                }
+
+                if (bin_id == 0 && hours_ago % 6 == 0)
+                {
+                    snprintf(msg, sizeof(msg), "-%uh", hours_ago);
+                    frame_->addText(msg, world_coords.x - 3.0f, -2.0f, world_coords.z, false, 0.02, glm::vec3(1.0, 1.0, 1.0));
+                }
+            }
+        }
+    }
+    else
+    {
+        frame_->addText("Occupancy is not being recorded (see --occupancy_dir)", 10, 40, 0, true, 1.0, glm::vec3(1.0, 1.0, 1.0));
+    }
+
+    snprintf(msg, sizeof(msg), "Hourly Occupancy (%.3fMhz - %.3fMhz)", sampler_->getStartFrequency() / 1000000.0f, sampler_->getEndFrequency() / 1000000.0f);
+    frame_->addText(msg, 10, 10, 0, true, 1.0, glm::vec3(1.0, 1.0, 1.0));
+
+    frame_queue->enqueueFrame(frame_);
+
+    display_manager_->setUpdateSceneCallback(std::bind(&OccupancySpectrum::updateSceneCallback, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4));
+
+    frame_queue->setReady();
+    if (frame_queue->setActive())
+    {
+        display_manager_->setFrameQueue(std::move(frame_queue));
+    }
+}
+
+void OccupancySpectrum::updateSceneCallback(GLfloat secs_since_rendering_started, GLfloat secs_since_framequeue_started, GLfloat secs_since_last_renderloop, GLfloat secs_since_last_frame)
+{
+    if (followSamplerRange())
+    {
+        return;
+    }
+
+    updateSamplerStatsOverlay(secs_since_rendering_started);
+
+    frame_->updateObjects(secs_since_rendering_started, secs_since_framequeue_started, secs_since_last_renderloop, secs_since_last_frame, nullptr);
+}
+
+void OccupancySpectrum::handleKeystroke(insight::WindowManager* window_manager, SDL_Event keystroke_event, GLfloat secs_since_last_renderloop)
+{
+    bool update_camera_coords = false;
+    GLfloat camera_speed = 10.0f;
+
+    GLfloat camera_speed_increment = camera_speed * secs_since_last_renderloop;
+    glm::vec3 camera_coords = display_manager_->getCameraCoords();
+
+    // The keyboard always moves along the same axes, regardless of where the camera is pointing.
+    glm::vec3 camera_up_vector = glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::vec3 camera_pointing_vector = glm::vec3(0, 0, -1 /* pointing into screen */);
+
+    if (keystroke_event.type == SDL_KEYDOWN)
+    {
+        if (keystroke_event.key.keysym.sym == SDLK_w)
+        {
+            camera_coords += camera_speed_increment * camera_pointing_vector;
+            update_camera_coords = true;
+        }
+        else if (keystroke_event.key.keysym.sym == SDLK_s)
+        {
+            camera_coords -= camera_speed_increment * camera_pointing_vector;
+            update_camera_coords = true;
+        }
+        else if (keystroke_event.key.keysym.sym == SDLK_a)
+        {
+            camera_coords -= glm::normalize(glm::cross(camera_pointing_vector, camera_up_vector)) * camera_speed_increment;
+            update_camera_coords = true;
+        }
+        else if (keystroke_event.key.keysym.sym == SDLK_d)
+        {
+            camera_coords += glm::normalize(glm::cross(camera_pointing_vector, camera_up_vector)) * camera_speed_increment;
+            update_camera_coords = true;
+        }
+    }
+
+    if (update_camera_coords)
+    {
+        window_manager->getDisplayManager()->setCameraCoords(camera_coords);
+    }
+}
@@ -0,0 +1,25 @@
+#ifndef WAVEGUIDE_SCENARIO_OCCUPANCY_OCCUPANCYSPECTRUM_H
+#define WAVEGUIDE_SCENARIO_OCCUPANCY_OCCUPANCYSPECTRUM_H
+
+#include "scenario/SimpleSpectrum.h"
+
+// Heatmap of how busy each (coalesced) frequency range has been over each of the last n hours.
+class OccupancySpectrum : public SimpleSpectrum {
+public:
+    OccupancySpectrum(insight::WindowManager* window_manager, sdr::SpectrumSampler* sampler, uint32_t bin_coalesce_factor = 1);
+    ~OccupancySpectrum() = default;
+
+    void run();
+
+    // insight::InputHandler overrides
+    void handleKeystroke(insight::WindowManager* window_manager, SDL_Event keystroke_event, GLfloat secs_since_last_renderloop) override;
+
+private:
+    void updateSceneCallback(GLfloat secs_since_rendering_started, GLfloat secs_since_framequeue_started, GLfloat secs_since_last_renderloop, GLfloat secs_since_last_frame);
+
+    // Number of hours (rows) shown, the current hour is closest to the camera.
+    uint32_t hours_;
+};
+
+
+#endif //WAVEGUIDE_SCENARIO_OCCUPANCY_OCCUPANCYSPECTRUM_H
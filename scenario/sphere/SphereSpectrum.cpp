@@ -1,6 +1,7 @@
 #include "SphereSpectrum.h"
 
 #include <iostream>
+#include <algorithm>
 #include <cmath>
 
 #include "scenario/RotatedSpectrumRange.h"
@@ -11,6 +12,9 @@ SphereSpectrum::SphereSpectrum(insight::WindowManager* window_manager, sdr::Spec
     radius_ = 8;
     rings_ = 10;
     current_ring_ = 0;
+
+    // Ranges are moved out from the sphere by their amplitude on every update
+    picking_ranges_move_ = true;
 }
 
 void SphereSpectrum::run()
@@ -25,7 +29,7 @@ void SphereSpectrum::run()
 
     frame_ = frame_queue->newFrame();
 
-    current_sweep_ = samples_->getSweepCount();
+    current_sweep_ = getNotifiedSweepCount();
     uint64_t raw_bin_count = samples_->getBinCount();
     uint64_t coalesced_bin_count = (raw_bin_count + bin_coalesce_factor_ - 1) / bin_coalesce_factor_; // integer ceiling
 
@@ -36,17 +40,15 @@ void SphereSpectrum::run()
 
     glm::vec3 start_coords = glm::vec3(0, 0, 0);                    // initial co-ordinates of the sphere's center
 
+    picking_radius_ = (radius_ * M_PI) / coalesced_bin_count;       // half the distance between neighbouring bins
+
     for (uint16_t ring_id = 0; ring_id < rings_; ring_id++)
     {
         for (uint64_t bin_id = 0; bin_id < coalesced_bin_count; bin_id++)
         {
             // Coalesce the frequency bins
-            std::vector<sdr::FrequencyBin const*> frequency_bins;
             uint64_t start_frequency_bin = bin_id * bin_coalesce_factor_;
-            for (uint64_t j = start_frequency_bin; j < (start_frequency_bin + bin_coalesce_factor_) && j < raw_bin_count; j++)
-            {
-                frequency_bins.push_back(samples_->getFrequencyBin(j));
-            }
+            uint64_t frequency_bin_count = std::min<uint64_t>(bin_coalesce_factor_, raw_bin_count - start_frequency_bin);
 
             double theta = (rad_per_bin * bin_id * bin_width_);
             glm::vec3 world_coords = start_coords;
@@ -66,8 +68,8 @@ void SphereSpectrum::run()
             world_coords.y += y;
             world_coords.z += z;
 
-//          bin = new RotatedSpectrumRange(display_manager_, insight::primitive::Primitive::Type::CUBE, ring_id, bin_id, world_coords, theta, rad_per_ring, radius_, glm::vec3(1, 1, 1), frequency_bins);
-            RotatedSpectrumRange* bin = new RotatedSpectrumRange(display_manager_, insight::primitive::Primitive::Type::TRANSFORMING_RECTANGLE, ring_id, bin_id, world_coords, theta, rad_per_ring, radius_, glm::vec3(1, 1, 1), frequency_bins);
+//          bin = new RotatedSpectrumRange(display_manager_, insight::primitive::Primitive::Type::CUBE, ring_id, bin_id, world_coords, theta, rad_per_ring, radius_, glm::vec3(1, 1, 1), samples_, start_frequency_bin, frequency_bin_count);
+            RotatedSpectrumRange* bin = new RotatedSpectrumRange(display_manager_, insight::primitive::Primitive::Type::TRANSFORMING_RECTANGLE, ring_id, bin_id, world_coords, theta, rad_per_ring, radius_, glm::vec3(1, 1, 1), samples_, start_frequency_bin, frequency_bin_count);
             bin->setScale(bin_width_, 1, 1);
 
             coalesced_bins_.push_back(bin);
@@ -92,17 +94,28 @@ void SphereSpectrum::run()
 
 void SphereSpectrum::updateSceneCallback(GLfloat secs_since_rendering_started, GLfloat secs_since_framequeue_started, GLfloat secs_since_last_renderloop, GLfloat secs_since_last_frame)
 {
+    if (followSamplerRange())
+    {
+        return;
+    }
+
+    updateSamplerStatsOverlay(secs_since_rendering_started);
+
     frame_->updateObjects(secs_since_rendering_started, secs_since_framequeue_started, secs_since_last_renderloop, secs_since_last_frame, static_cast<void*>(&current_ring_));
 
     // If the samplers have completed a new full sweep of the spectrum, move onto the next ring
-    if (samples_->getSweepCount() != current_sweep_)
+    if (getNotifiedSweepCount() != current_sweep_)
     {
-        current_sweep_ = samples_->getSweepCount();
+        current_sweep_ = getNotifiedSweepCount();
+        showSweepHistory(current_ring_, current_sweep_, secs_since_rendering_started, secs_since_framequeue_started, secs_since_last_renderloop, secs_since_last_frame);
 
         if (++current_ring_ >= rings_)
         {
             current_ring_ = 0;
         }
+
+        // The ring being reused goes back to showing the live bins
+        showSweepHistory(current_ring_, 0, secs_since_rendering_started, secs_since_framequeue_started, secs_since_last_renderloop, secs_since_last_frame);
     }
 
     float camera_z = 80.0 * cos(secs_since_rendering_started * 0.1 * M_PI);
@@ -0,0 +1,214 @@
+#include "ControlSocket.h"
+
+#include <iostream>
+#include <sstream>
+#include <cstring>
+#include <cerrno>
+#include <cstdlib>
+
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "SpectrumSampler.h"
+#include "Config.h"
+
+// How often the control thread wakes up to check for shutdown.
+#define CONTROL_POLL_INTERVAL_MS 250
+
+// Commands longer than this are rejected.
+#define MAX_COMMAND_LENGTH 256
+
+sdr::ControlSocket::ControlSocket(const std::string& path, SpectrumSampler* sampler) : path_(path), sampler_(sampler)
+{
+    thread_ = nullptr;
+    stop_ = false;
+
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+
+    if (path_.size() >= sizeof(address.sun_path))
+    {
+        std::cerr << "Control socket path " << path_ << " is too long" << std::endl;
+        listen_fd_ = -1;
+        return;
+    }
+
+    strncpy(address.sun_path, path_.c_str(), sizeof(address.sun_path) - 1);
+
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd_ < 0)
+    {
+        std::cerr << "Could not create control socket: " << strerror(errno) << std::endl;
+        return;
+    }
+
+    // A previous run may have left its socket behind
+    unlink(path_.c_str());
+
+    if (bind(listen_fd_, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0 || listen(listen_fd_, 4) != 0)
+    {
+        std::cerr << "Could not listen on control socket " << path_ << ": " << strerror(errno) << std::endl;
+        close(listen_fd_);
+        listen_fd_ = -1;
+        return;
+    }
+
+    thread_ = new std::thread(&ControlSocket::acceptConnections, this);
+
+    std::cout << "Accepting capture setting changes on " << path_ << std::endl;
+}
+
+sdr::ControlSocket::~ControlSocket()
+{
+    stop_ = true;
+
+    if (thread_)
+    {
+        thread_->join();
+        delete thread_;
+    }
+
+    if (listen_fd_ >= 0)
+    {
+        close(listen_fd_);
+        unlink(path_.c_str());
+    }
+}
+
+bool sdr::ControlSocket::isListening()
+{
+    return listen_fd_ >= 0;
+}
+
+void sdr::ControlSocket::acceptConnections()
+{
+    while ( ! stop_)
+    {
+        struct pollfd listen_poll = {listen_fd_, POLLIN, 0};
+        if (poll(&listen_poll, 1, CONTROL_POLL_INTERVAL_MS) <= 0)
+        {
+            continue;
+        }
+
+        int fd = accept(listen_fd_, nullptr, nullptr);
+        if (fd < 0)
+        {
+            continue;
+        }
+
+        // Connections are handled one at a time, commands are tiny and infrequent
+        handleConnection(fd);
+        close(fd);
+    }
+}
+
+void sdr::ControlSocket::handleConnection(int fd)
+{
+    std::string buffer;
+    char data[128];
+
+    while ( ! stop_)
+    {
+        struct pollfd connection_poll = {fd, POLLIN, 0};
+        int ready = poll(&connection_poll, 1, CONTROL_POLL_INTERVAL_MS);
+        if (ready == 0)
+        {
+            continue;
+        }
+
+        ssize_t received = (ready > 0) ? recv(fd, data, sizeof(data), 0) : -1;
+        if (received <= 0)
+        {
+            return;
+        }
+
+        buffer.append(data, received);
+
+        size_t end_of_line;
+        while ((end_of_line = buffer.find('\n')) != std::string::npos)
+        {
+            std::string response = handleCommand(buffer.substr(0, end_of_line)) + "\n";
+            buffer.erase(0, end_of_line + 1);
+
+            if (send(fd, response.c_str(), response.size(), MSG_NOSIGNAL) < 0)
+            {
+                return;
+            }
+        }
+
+        if (buffer.size() > MAX_COMMAND_LENGTH)
+        {
+            return;
+        }
+    }
+}
+
+std::string sdr::ControlSocket::handleCommand(const std::string& command)
+{
+    std::istringstream stream(command);
+    std::string setting, value;
+    stream >> setting >> value;
+
+    Config* config = sampler_->getConfig();
+    bool ok = false;
+
+    if (setting == "get")
+    {
+        ok = true;
+    }
+    else if (setting == "trigger")
+    {
+        if ( ! sampler_->triggerIqCapture())
+        {
+            return "error IQ capture is not enabled";
+        }
+
+        return "ok triggered IQ capture";
+    }
+    else if (value.empty())
+    {
+        return "error missing value for " + setting;
+    }
+    else if (setting == "gain")
+    {
+        ok = sampler_->setGain(atof(value.c_str()));
+    }
+    else if (setting == "agc")
+    {
+        ok = sampler_->setAgc(strtoul(value.c_str(), NULL, 10));
+    }
+    else if (setting == "despike")
+    {
+        ok = sampler_->setDcSpikeRemoval(strtoul(value.c_str(), NULL, 10));
+    }
+    else if (setting == "dwell")
+    {
+        ok = sampler_->setDwellTime(strtoul(value.c_str(), NULL, 10));
+    }
+    else if (setting == "history")
+    {
+        if ( ! sampler_->exportHistory(value))
+        {
+            return "error could not export history to " + value;
+        }
+
+        return "ok exported history to " + value;
+    }
+    else
+    {
+        return "error unknown setting " + setting;
+    }
+
+    if ( ! ok)
+    {
+        return "error invalid value " + value + " for " + setting;
+    }
+
+    std::ostringstream response;
+    response << "ok gain " << config->getGain() << " agc " << config->getAgc() << " despike " << config->getDcSpikeRemoval() << " dwell " << config->getDwellTime();
+
+    return response.str();
+}
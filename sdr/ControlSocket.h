@@ -0,0 +1,43 @@
+#ifndef WAVEGUIDE_SDR_CONTROLSOCKET_H
+#define WAVEGUIDE_SDR_CONTROLSOCKET_H
+
+#include <atomic>
+#include <thread>
+#include <string>
+
+namespace sdr {
+
+    class SpectrumSampler;
+
+    // Unix domain socket that accepts one command per line to change capture settings while sampling, ie.
+    //
+    //   echo "gain 20.5" | socat - UNIX-CONNECT:/tmp/waveguide.sock
+    //
+    // Commands are "gain DB", "agc 0|1", "despike 0|1", "dwell USEC" and "get", plus "history PATH" which exports the
+    // sweep history as CSV and "trigger" which captures raw IQ from every device (if --iq_dir is set). Each is answered
+    // with a line starting "ok" or "error".
+    class ControlSocket {
+    public:
+        ControlSocket(const std::string& path, SpectrumSampler* sampler);
+        ~ControlSocket();
+
+        bool isListening();
+
+    private:
+        void acceptConnections();
+        void handleConnection(int fd);
+
+        // Runs a single command and returns the response line (without the trailing newline).
+        std::string handleCommand(const std::string& command);
+
+        std::string path_;
+        SpectrumSampler* sampler_;
+
+        int listen_fd_;
+        std::thread* thread_;
+        std::atomic<bool> stop_;
+    };
+
+}
+
+#endif //WAVEGUIDE_SDR_CONTROLSOCKET_H
@@ -0,0 +1,67 @@
+#include "FftFanoutBlock.h"
+
+#include <cmath>
+#include <algorithm>
+
+#include <gnuradio/io_signature.h>
+#include <gnuradio/fft/fft_vcc.h>
+#include <gnuradio/blocks/complex_to_mag_squared.h>
+#include <gnuradio/blocks/nlog10_ff.h>
+#include <gnuradio/blocks/deinterleave.h>
+#include <gnuradio/blocks/interleave.h>
+#include <gnuradio/filter/single_pole_iir_filter_ff.h>
+
+sdr::FftFanoutBlock::FftFanoutBlock(size_t vector_length, const std::vector<float>& window, uint32_t worker_count) :
+        gr::hier_block2("fft_fanout", gr::io_signature::make(1, 1, sizeof(gr_complex) * vector_length),
+                        gr::io_signature::make(1, 1, sizeof(float) * vector_length))
+{
+    worker_count = std::max<uint32_t>(worker_count, 1);
+
+    float window_power = 0.0f;
+    for (float tap : window)
+    {
+        window_power += tap*tap;
+    }
+
+    // A single worker is connected straight through, without the cost of dealing out and collecting vectors
+    gr::blocks::deinterleave::sptr deinterleave;
+    gr::blocks::interleave::sptr interleave;
+    if (worker_count > 1)
+    {
+        deinterleave = gr::blocks::deinterleave::make(sizeof(gr_complex) * vector_length);
+        interleave = gr::blocks::interleave::make(sizeof(float) * vector_length);
+
+        connect(self(), 0, deinterleave, 0);
+        connect(interleave, 0, self(), 0);
+    }
+
+    for (uint32_t i = 0; i < worker_count; i++)
+    {
+        gr::fft::fft_vcc::sptr fft = gr::fft::fft_vcc::make(vector_length, true, window, true);
+        gr::blocks::complex_to_mag_squared::sptr complex_to_mag2 = gr::blocks::complex_to_mag_squared::make(vector_length);
+        gr::filter::single_pole_iir_filter_ff::sptr iir = gr::filter::single_pole_iir_filter_ff::make(1.0, vector_length);
+        gr::blocks::nlog10_ff::sptr vector_log = gr::blocks::nlog10_ff::make(10, vector_length, -20 * log10(vector_length) - 10 * log10(window_power / vector_length));
+
+        connect(fft, 0, complex_to_mag2, 0);
+        connect(complex_to_mag2, 0, iir, 0);
+        connect(iir, 0, vector_log, 0);
+
+        if (deinterleave)
+        {
+            connect(deinterleave, i, fft, 0);
+            connect(vector_log, 0, interleave, i);
+        }
+        else
+        {
+            connect(self(), 0, fft, 0);
+            connect(vector_log, 0, self(), 0);
+        }
+    }
+}
+
+sdr::FftFanoutBlock::sptr sdr::FftFanoutBlock::make(size_t vector_length, const std::vector<float>& window, uint32_t worker_count)
+{
+    // Hierarchical blocks need the pointer GNU Radio stashed during construction (rather than a fresh shared_ptr), as
+    // self() was used before the constructor returned
+    return gnuradio::get_initial_sptr(new FftFanoutBlock(vector_length, window, worker_count));
+}
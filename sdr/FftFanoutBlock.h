@@ -0,0 +1,28 @@
+#ifndef WAVEGUIDE_SDR_FFTFANOUTBLOCK_H
+#define WAVEGUIDE_SDR_FFTFANOUTBLOCK_H
+
+#include <vector>
+#include <cstdint>
+
+#include <gnuradio/hier_block2.h>
+
+namespace sdr {
+
+    // Turns vectors of IQ samples into vectors of power (in dB, scaled for the window), ie. FFT, magnitude squared and
+    // log. With more than one worker the vectors are dealt round-robin to a copy of that chain per worker and the
+    // results interleaved back in the same order, so each copy runs on its own GNU Radio thread with its own FFTW plan
+    // and a single device can be transformed faster than one core can manage. Downstream blocks see exactly the same
+    // stream either way.
+    class FftFanoutBlock : public gr::hier_block2 {
+    public:
+        FftFanoutBlock(size_t vector_length, const std::vector<float>& window, uint32_t worker_count);
+        virtual ~FftFanoutBlock() = default;
+
+        typedef boost::shared_ptr<FftFanoutBlock> sptr;
+
+        static sptr make(size_t vector_length, const std::vector<float>& window, uint32_t worker_count);
+    };
+
+}
+
+#endif //WAVEGUIDE_SDR_FFTFANOUTBLOCK_H
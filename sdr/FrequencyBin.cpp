@@ -3,22 +3,73 @@
 #include <iostream>
 #include <cstring>
 #include <cassert>
+#include <chrono>
+#include <cmath>
+#include <climits>
 
-sdr::FrequencyBin::FrequencyBin(uint64_t freq_hz, uint16_t history_size) : freq_hz_(freq_hz), history_size_(history_size)
+// The noise floor is estimated as this quantile of all samples seen by the bin.
+#define NOISE_FLOOR_QUANTILE 0.2f
+
+// Each sample moves the noise floor estimate by at most this many dB.
+#define NOISE_FLOOR_STEP_DB 0.5f
+
+// STORAGE_INT16 keeps samples in steps of 0.01dB.
+#define QUANTIZED_STEPS_PER_DB 100.0f
+
+sdr::FrequencyBin::FrequencyBin(uint64_t freq_hz, uint16_t history_size, StorageMode storage_mode) :
+        freq_hz_(freq_hz), history_size_(history_size), storage_mode_(storage_mode)
 {
+    latest_amplitude_ = 0.0f;
     max_amplitude_ = 0.0f;
     moving_average_amplitude_ = 0.0f;
+    noise_floor_amplitude_ = 0.0f;
 
     next_sample_ = 0;
     has_rolled_over_ = false;
 
-    samples_ = new float[history_size_];
-    memset(samples_, 0, sizeof(float) * history_size_);
+    samples_ = nullptr;
+    quantized_samples_ = nullptr;
+
+    if (storage_mode_ == STORAGE_FLOAT)
+    {
+        samples_ = new float[history_size_];
+        memset(samples_, 0, sizeof(float) * history_size_);
+    }
+    else if (storage_mode_ == STORAGE_INT16)
+    {
+        quantized_samples_ = new int16_t[history_size_];
+        memset(quantized_samples_, 0, sizeof(int16_t) * history_size_);
+    }
 }
 
 sdr::FrequencyBin::~FrequencyBin()
 {
-    delete[] samples_;
+    if (samples_)
+    {
+        delete[] samples_;
+    }
+
+    if (quantized_samples_)
+    {
+        delete[] quantized_samples_;
+    }
+}
+
+size_t sdr::FrequencyBin::getBytesPerBin(uint16_t history_size, StorageMode storage_mode)
+{
+    // Bins are allocated individually and referenced from SpectrumSamples
+    size_t bytes = sizeof(FrequencyBin) + sizeof(FrequencyBin*);
+
+    if (storage_mode == STORAGE_FLOAT)
+    {
+        bytes += sizeof(float) * history_size;
+    }
+    else if (storage_mode == STORAGE_INT16)
+    {
+        bytes += sizeof(int16_t) * history_size;
+    }
+
+    return bytes;
 }
 
 uint64_t sdr::FrequencyBin::getFrequency()
@@ -36,22 +87,9 @@ bool sdr::FrequencyBin::getHasBeenSet(uint32_t minimum_samples)
 
 float sdr::FrequencyBin::getLatestAmplitude(bool moving_average)
 {
-    // Lock the sample metadata so that the current_sample_ doesn't change under our feet
     std::lock_guard<std::mutex> guard(lock_);
 
-    uint16_t current_sample = 0;
-    if (has_rolled_over_)
-    {
-        current_sample = (next_sample_ == 0) ? history_size_ - 1 : next_sample_ - 1;
-    }
-    else
-    {
-        current_sample = (next_sample_ == 0) ? 0 : next_sample_ - 1;
-    }
-
-    assert(current_sample < history_size_);
-
-    return moving_average ? moving_average_amplitude_ : samples_[current_sample];
+    return moving_average ? moving_average_amplitude_ : latest_amplitude_;
 }
 
 float sdr::FrequencyBin::getMaximumAmplitude()
@@ -61,15 +99,64 @@ float sdr::FrequencyBin::getMaximumAmplitude()
     return max_amplitude_;
 }
 
-void sdr::FrequencyBin::setLatestAmplitude(float amplitude, bool keep_maximum)
+float sdr::FrequencyBin::getNoiseFloorAmplitude()
 {
-    // Lock the sample data so that others don't read it from under us
     std::lock_guard<std::mutex> guard(lock_);
 
+    return noise_floor_amplitude_;
+}
+
+float sdr::FrequencyBin::getSignalToNoiseRatio(bool moving_average)
+{
+    float amplitude = getLatestAmplitude(moving_average);
+
+    return amplitude - getNoiseFloorAmplitude();
+}
+
+float sdr::FrequencyBin::stepNoiseFloor(float noise_floor_amplitude, float amplitude)
+{
+    if (amplitude > noise_floor_amplitude)
+    {
+        return noise_floor_amplitude + (NOISE_FLOOR_STEP_DB * NOISE_FLOOR_QUANTILE);
+    }
+
+    return noise_floor_amplitude - (NOISE_FLOOR_STEP_DB * (1.0f - NOISE_FLOOR_QUANTILE));
+}
+
+float sdr::FrequencyBin::setLatestAmplitude(float amplitude, bool keep_maximum, SamplerStats* stats)
+{
+    // Lock the sample data so that others don't read it from under us, only timing the wait if the lock is contended
+    std::unique_lock<std::mutex> guard(lock_, std::try_to_lock);
+    if ( ! guard.owns_lock())
+    {
+        auto t_start = std::chrono::steady_clock::now();
+        guard.lock();
+
+        if (stats)
+        {
+            stats->recordLockWait(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t_start).count());
+        }
+    }
+
     uint32_t current_sample = next_sample_;
 
     assert(current_sample < history_size_);
-    samples_[current_sample] = amplitude;
+
+    if (storage_mode_ == STORAGE_FLOAT)
+    {
+        samples_[current_sample] = amplitude;
+    }
+    else if (storage_mode_ == STORAGE_INT16)
+    {
+        // Work with the quantized value from here on so that the moving average agrees with the history it's updated from
+        long quantized = lrintf(amplitude * QUANTIZED_STEPS_PER_DB);
+        quantized = quantized > SHRT_MAX ? SHRT_MAX : (quantized < SHRT_MIN ? SHRT_MIN : quantized);
+
+        quantized_samples_[current_sample] = static_cast<int16_t>(quantized);
+        amplitude = quantized / QUANTIZED_STEPS_PER_DB;
+    }
+
+    latest_amplitude_ = amplitude;
 
     // Keep the maximum amplitude seen for this frequency
     if (keep_maximum && ((current_sample == 0 && ! has_rolled_over_) || (amplitude > max_amplitude_)))
@@ -77,26 +164,68 @@ void sdr::FrequencyBin::setLatestAmplitude(float amplitude, bool keep_maximum)
         max_amplitude_ = amplitude;
     }
 
-    // Calculate the moving average
-    float divisor = 1.0f;
-    float previous_amplitude = 0.0f;
-
-    if (has_rolled_over_)
+    // Track the noise floor with a frugal streaming quantile estimator: rather than keeping a sketch of the sample
+    // distribution it nudges a single value towards each new sample, weighted so it settles at NOISE_FLOOR_QUANTILE.
+    if (current_sample == 0 && ! has_rolled_over_)
     {
-        divisor = history_size_;
-        previous_amplitude = (current_sample == 0) ? (samples_[history_size_ - 1]) : (samples_[current_sample - 1]);
+        noise_floor_amplitude_ = amplitude;
     }
     else
     {
-        divisor = current_sample + 1.0f;
-        previous_amplitude = (current_sample == 0) ? 0.0f : samples_[current_sample - 1];
+        noise_floor_amplitude_ = stepNoiseFloor(noise_floor_amplitude_, amplitude);
     }
 
-    moving_average_amplitude_ += ((1.0f / divisor) * (amplitude - previous_amplitude));
+    // Calculate the moving average
+    if (storage_mode_ == STORAGE_EMA)
+    {
+        // Weighted so that the average has a similar time constant to a window of history_size_ samples
+        float alpha = 2.0f / (history_size_ + 1.0f);
+
+        if (current_sample == 0 && ! has_rolled_over_)
+        {
+            moving_average_amplitude_ = amplitude;
+        }
+        else
+        {
+            moving_average_amplitude_ += alpha * (amplitude - moving_average_amplitude_);
+        }
+    }
+    else
+    {
+        float divisor = 1.0f;
+        float previous_amplitude = 0.0f;
+
+        if (has_rolled_over_)
+        {
+            divisor = history_size_;
+            previous_amplitude = (current_sample == 0) ? getSample(history_size_ - 1) : getSample(current_sample - 1);
+        }
+        else
+        {
+            divisor = current_sample + 1.0f;
+            previous_amplitude = (current_sample == 0) ? 0.0f : getSample(current_sample - 1);
+        }
+
+        moving_average_amplitude_ += ((1.0f / divisor) * (amplitude - previous_amplitude));
+    }
 
     if (++next_sample_ >= history_size_)
     {
         next_sample_ = 0;
         has_rolled_over_ = true;
     }
-}
\ No newline at end of file
+
+    return noise_floor_amplitude_;
+}
+
+float sdr::FrequencyBin::getSample(uint32_t sample)
+{
+    assert(storage_mode_ != STORAGE_EMA && sample < history_size_);
+
+    if (storage_mode_ == STORAGE_INT16)
+    {
+        return quantized_samples_[sample] / QUANTIZED_STEPS_PER_DB;
+    }
+
+    return samples_[sample];
+}
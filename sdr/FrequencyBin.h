@@ -4,37 +4,68 @@
 #include <mutex>
 #include <cstdint>
 
+#include "SamplerStats.h"
+
 class SpectrumSamples;
 
 namespace sdr {
 
     class FrequencyBin {
     public:
-        FrequencyBin(uint64_t freq_hz, uint16_t history_size);
+        // How the history used for the moving average is kept, trading accuracy for memory on very wide sweeps.
+        enum StorageMode : uint8_t {
+            STORAGE_FLOAT,                  // history_size float samples
+            STORAGE_INT16,                  // history_size samples quantized to int16 centi-dB (0.01dB steps)
+            STORAGE_EMA                     // no history, the moving average is exponential over ~history_size samples
+        };
+
+        FrequencyBin(uint64_t freq_hz, uint16_t history_size, StorageMode storage_mode = STORAGE_FLOAT);
         ~FrequencyBin();
 
+        // Gets the memory used by each bin (including its sample history) in the given mode.
+        static size_t getBytesPerBin(uint16_t history_size, StorageMode storage_mode);
+
         uint64_t getFrequency();
 
         bool getHasBeenSet(uint32_t minimum_samples = 1);
         float getLatestAmplitude(bool moving_average = true);
         float getMaximumAmplitude();
 
+        // Gets the streaming estimate of the noise floor (in dB) for this frequency, see noise_floor_amplitude_ below.
+        float getNoiseFloorAmplitude();
+
+        // Gets the latest (or moving average) amplitude relative to the estimated noise floor (in dB).
+        float getSignalToNoiseRatio(bool moving_average = true);
+
+        // Moves a noise floor estimate towards amplitude, for keeping estimates the same way outside of a bin.
+        static float stepNoiseFloor(float noise_floor_amplitude, float amplitude);
+
+        // Samples are normally written through SpectrumSamples, this is public so that a lone bin can be benchmarked.
+        // If the bin is locked by a reader, the time spent waiting for it is recorded into stats (when given). Returns
+        // the noise floor estimate including this sample, read while the bin is still locked.
+        float setLatestAmplitude(float amplitude, bool keep_maximum, SamplerStats* stats = nullptr);
+
     private:
         friend class SpectrumSamples;
 
-        void setLatestAmplitude(float amplitude, bool keep_maximum);
+        // Gets the sample in the given history slot (not valid in STORAGE_EMA).
+        float getSample(uint32_t sample);
 
         std::mutex lock_;
 
         uint64_t freq_hz_;                  // frequency the sample represents
+        float latest_amplitude_;
         float max_amplitude_;               // maximum amplitude seen for this frequency (ever)
         float moving_average_amplitude_;
+        float noise_floor_amplitude_;       // low quantile of every sample seen, tracked without keeping any history
 
         uint16_t history_size_;             // number of samples to retain (and calculate moving average over)
         uint32_t next_sample_;              // index of next free sample slot
         bool has_rolled_over_;
+        StorageMode storage_mode_;
 
-        float* samples_;
+        float* samples_;                    // STORAGE_FLOAT history
+        int16_t* quantized_samples_;        // STORAGE_INT16 history
     };
 
 }
@@ -0,0 +1,166 @@
+#include "IqCaptureWriter.h"
+
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <ctime>
+
+// Captures are dropped (rather than queued without limit) if the disk can't keep up.
+#define MAX_QUEUED_CAPTURES 4
+
+sdr::IqCaptureWriter::IqCaptureWriter(const std::string& directory) : directory_(directory)
+{
+    stop_ = false;
+    captures_written_ = 0;
+
+    thread_ = new std::thread(&IqCaptureWriter::run, this);
+
+    std::cout << "Writing triggered IQ captures to " << directory_ << std::endl;
+}
+
+sdr::IqCaptureWriter::~IqCaptureWriter()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        stop_ = true;
+        queue_changed_.notify_one();
+    }
+
+    // Anything already queued is still written
+    thread_->join();
+    delete thread_;
+}
+
+void sdr::IqCaptureWriter::write(IqCapture* capture)
+{
+    std::lock_guard<std::mutex> guard(lock_);
+
+    if (queue_.size() >= MAX_QUEUED_CAPTURES)
+    {
+        std::cerr << "Dropping IQ capture from device " << static_cast<int>(capture->device_id_) << ", " << queue_.size() << " captures are still being written" << std::endl;
+        delete capture;
+        return;
+    }
+
+    queue_.push_back(capture);
+    queue_changed_.notify_one();
+}
+
+uint64_t sdr::IqCaptureWriter::getCapturesWritten()
+{
+    std::lock_guard<std::mutex> guard(lock_);
+
+    return captures_written_;
+}
+
+void sdr::IqCaptureWriter::run()
+{
+    while (true)
+    {
+        IqCapture* capture;
+
+        {
+            std::unique_lock<std::mutex> guard(lock_);
+            queue_changed_.wait(guard, [this]() {
+                return stop_ || ! queue_.empty();
+            });
+
+            if (queue_.empty())
+            {
+                break;
+            }
+
+            capture = queue_.front();
+            queue_.pop_front();
+        }
+
+        bool written = writeRecording(capture);
+        delete capture;
+
+        if (written)
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            captures_written_++;
+        }
+    }
+}
+
+bool sdr::IqCaptureWriter::writeRecording(IqCapture* capture)
+{
+    // The recording starts pre_trigger_samples_ before the trigger
+    int64_t start_ns = capture->trigger_time_ns_ - static_cast<int64_t>((capture->pre_trigger_samples_ * 1000000000.0) / capture->sample_rate_hz_);
+    time_t start_secs = static_cast<time_t>(start_ns / 1000000000);
+    uint32_t start_ms = static_cast<uint32_t>((start_ns % 1000000000) / 1000000);
+
+    struct tm start_tm;
+    gmtime_r(&start_secs, &start_tm);
+
+    char timestamp[32], datetime[48];
+    strftime(timestamp, sizeof(timestamp), "%Y%m%dT%H%M%S", &start_tm);
+    strftime(datetime, sizeof(datetime), "%Y-%m-%dT%H:%M:%S", &start_tm);
+
+    char base_name[128];
+    snprintf(base_name, sizeof(base_name), "waveguide_%u_%lu_%s%03u", capture->device_id_, capture->center_freq_hz_, timestamp, start_ms);
+    std::string base_path = directory_ + "/" + base_name;
+
+    std::ofstream data(base_path + ".sigmf-data", std::ios::out | std::ios::trunc | std::ios::binary);
+    if ( ! data.is_open())
+    {
+        std::cerr << "Could not write IQ capture " << base_path << ".sigmf-data" << std::endl;
+        return false;
+    }
+
+    // std::complex<float> is laid out as interleaved I and Q floats, which is cf32_le on little-endian hosts
+    data.write(reinterpret_cast<const char*>(capture->samples_.data()), capture->samples_.size() * sizeof(std::complex<float>));
+    data.close();
+
+    std::ofstream meta(base_path + ".sigmf-meta", std::ios::out | std::ios::trunc);
+    if ( ! meta.is_open() || ! data)
+    {
+        std::cerr << "Could not write IQ capture " << base_path << std::endl;
+        return false;
+    }
+
+    uint64_t post_trigger_samples = capture->samples_.size() - capture->pre_trigger_samples_;
+
+    char start_datetime[64];
+    snprintf(start_datetime, sizeof(start_datetime), "%s.%03uZ", datetime, start_ms);
+
+    meta << "{\n";
+    meta << "    \"global\": {\n";
+    meta << "        \"core:datatype\": \"cf32_le\",\n";
+    meta << "        \"core:sample_rate\": " << capture->sample_rate_hz_ << ",\n";
+    meta << "        \"core:version\": \"1.0.0\",\n";
+    meta << "        \"core:recorder\": \"waveguide\",\n";
+    meta << "        \"core:description\": \"Triggered capture from device " << static_cast<int>(capture->device_id_) << "\"\n";
+    meta << "    },\n";
+    meta << "    \"captures\": [\n";
+    meta << "        {\n";
+    meta << "            \"core:sample_start\": 0,\n";
+    meta << "            \"core:frequency\": " << capture->center_freq_hz_ << ",\n";
+    meta << "            \"core:datetime\": \"" << start_datetime << "\"\n";
+    meta << "        }\n";
+    meta << "    ],\n";
+    meta << "    \"annotations\": [\n";
+    meta << "        {\n";
+    meta << "            \"core:sample_start\": " << capture->pre_trigger_samples_ << ",\n";
+    meta << "            \"core:sample_count\": " << post_trigger_samples << ",\n";
+
+    if (capture->trigger_freq_hz_)
+    {
+        meta << "            \"core:freq_lower_edge\": " << capture->trigger_freq_hz_ << ",\n";
+        meta << "            \"core:freq_upper_edge\": " << capture->trigger_freq_hz_ << ",\n";
+        meta << "            \"core:comment\": \"" << capture->trigger_snr_db_ << " dB above the noise floor\",\n";
+    }
+
+    meta << "            \"core:label\": \"trigger\"\n";
+    meta << "        }\n";
+    meta << "    ]\n";
+    meta << "}\n";
+
+    meta.close();
+
+    std::cout << "Wrote IQ capture " << base_path << " (" << capture->samples_.size() << " samples)" << std::endl;
+
+    return meta.good();
+}
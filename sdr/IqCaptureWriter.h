@@ -0,0 +1,57 @@
+#ifndef WAVEGUIDE_SDR_IQCAPTUREWRITER_H
+#define WAVEGUIDE_SDR_IQCAPTUREWRITER_H
+
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <string>
+#include <vector>
+#include <complex>
+#include <condition_variable>
+#include <cstdint>
+
+namespace sdr {
+
+    // Raw IQ around a trigger, filled in by an IqTapBlock.
+    typedef struct
+    {
+        uint8_t device_id_;
+        uint64_t center_freq_hz_;           // the device was tuned to this frequency
+        uint64_t sample_rate_hz_;
+        uint64_t trigger_freq_hz_;          // bin that fired the trigger (0 if it was triggered by hand)
+        float trigger_snr_db_;
+        int64_t trigger_time_ns_;           // CLOCK_REALTIME when the trigger reached the tap
+        uint64_t pre_trigger_samples_;      // samples_ from before the trigger, the rest are from after it
+        std::vector<std::complex<float>> samples_;
+    } IqCapture;
+
+    // Writes IqCaptures to a directory as SigMF recordings (a .sigmf-data file of cf32_le samples and a .sigmf-meta
+    // file describing them) on its own thread, so that the sample threads never wait on the disk.
+    class IqCaptureWriter {
+    public:
+        IqCaptureWriter(const std::string& directory);
+        ~IqCaptureWriter();
+
+        // Takes ownership of capture, which is dropped if too many captures are already waiting to be written.
+        void write(IqCapture* capture);
+
+        uint64_t getCapturesWritten();
+
+    private:
+        void run();
+
+        bool writeRecording(IqCapture* capture);
+
+        std::string directory_;
+
+        std::thread* thread_;
+        std::mutex lock_;                   // guards everything below
+        std::condition_variable queue_changed_;
+        std::deque<IqCapture*> queue_;
+        bool stop_;
+        uint64_t captures_written_;
+    };
+
+}
+
+#endif //WAVEGUIDE_SDR_IQCAPTUREWRITER_H
@@ -0,0 +1,371 @@
+#include "IqRecorder.h"
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <cerrno>
+#include <ctime>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+// Each buffer holds ~26ms at 20MS/s, large enough that every write is a handful of big sequential requests to the
+// device. Together the buffers ride out ~400ms of the disk falling behind at that rate.
+#define IQ_RECORD_BUFFER_BYTES (4 * 1024 * 1024)
+#define IQ_RECORD_BUFFER_COUNT 16
+
+// O_DIRECT needs the buffers, lengths and file offsets aligned to the logical block size, a page covers every device.
+#define IQ_RECORD_ALIGNMENT 4096
+
+static int64_t getRealtimeNs()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    return (static_cast<int64_t>(now.tv_sec) * 1000000000) + now.tv_nsec;
+}
+
+// Formats time_ns as an ISO 8601 UTC time (SigMF's core:datetime), or as a compact timestamp for file names.
+static std::string formatTime(int64_t time_ns, bool compact)
+{
+    time_t secs = static_cast<time_t>(time_ns / 1000000000);
+    uint32_t ms = static_cast<uint32_t>((time_ns % 1000000000) / 1000000);
+
+    struct tm time_tm;
+    gmtime_r(&secs, &time_tm);
+
+    char datetime[48], formatted[64];
+    strftime(datetime, sizeof(datetime), compact ? "%Y%m%dT%H%M%S" : "%Y-%m-%dT%H:%M:%S", &time_tm);
+    snprintf(formatted, sizeof(formatted), compact ? "%s%03u" : "%s.%03uZ", datetime, ms);
+
+    return std::string(formatted);
+}
+
+sdr::IqRecorder::IqRecorder(const std::string& directory, uint8_t device_id, uint64_t sample_rate_hz, SamplerStats* stats) :
+        device_id_(device_id), sample_rate_hz_(sample_rate_hz), stats_(stats)
+{
+    char base_name[128];
+    snprintf(base_name, sizeof(base_name), "waveguide_%u_%s", device_id_, formatTime(getRealtimeNs(), true).c_str());
+    base_path_ = directory + "/" + base_name;
+
+    std::string data_path = base_path_ + ".sigmf-data";
+
+    direct_io_ = true;
+    fd_ = open(data_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+    if (fd_ < 0 && errno == EINVAL)
+    {
+        // ie. tmpfs, recording still works but goes through the page cache
+        direct_io_ = false;
+        fd_ = open(data_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    }
+
+    file_offset_ = 0;
+    write_failed_ = false;
+
+    buffer_ = nullptr;
+    buffer_bytes_ = 0;
+    new_segment_ = true;
+    samples_dropped_ = 0;
+    freq_hz_ = 0;
+
+    retune_freq_hz_ = 0;
+    samples_recorded_ = 0;
+
+    thread_ = nullptr;
+    stop_ = false;
+
+    if (fd_ < 0)
+    {
+        std::cerr << "Could not open " << data_path << " to record IQ: " << strerror(errno) << std::endl;
+        return;
+    }
+
+    for (uint32_t i = 0; i < IQ_RECORD_BUFFER_COUNT; i++)
+    {
+        void* buffer = nullptr;
+        if (posix_memalign(&buffer, IQ_RECORD_ALIGNMENT, IQ_RECORD_BUFFER_BYTES) != 0)
+        {
+            // Left closed (see isOpen()), the buffers allocated so far are freed with the recorder
+            std::cerr << "Could not allocate IQ recording buffers for " << data_path << std::endl;
+
+            close(fd_);
+            unlink(data_path.c_str());
+            fd_ = -1;
+
+            return;
+        }
+
+        allocated_buffers_.push_back(static_cast<char*>(buffer));
+    }
+
+    empty_buffers_ = allocated_buffers_;
+    buffer_ = empty_buffers_.back();
+    empty_buffers_.pop_back();
+
+    thread_ = new std::thread(&IqRecorder::run, this);
+
+    std::cout << "Recording IQ from device " << static_cast<int>(device_id_) << " to " << data_path << (direct_io_ ? "" : " (without O_DIRECT)") << std::endl;
+}
+
+sdr::IqRecorder::~IqRecorder()
+{
+    if (thread_)
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            stop_ = true;
+            buffers_changed_.notify_one();
+        }
+
+        // Every full buffer is written before the thread exits
+        thread_->join();
+        delete thread_;
+    }
+
+    if (fd_ >= 0)
+    {
+        // The last buffer is only partly filled, which O_DIRECT can't write without padding the recording
+        if (buffer_ && buffer_bytes_ && ! write_failed_)
+        {
+            if (direct_io_)
+            {
+                fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL) & ~O_DIRECT);
+            }
+
+            if ( ! writeBuffer(buffer_, buffer_bytes_))
+            {
+                std::cerr << "Could not write the end of the IQ recording " << base_path_ << ".sigmf-data" << std::endl;
+            }
+        }
+
+        close(fd_);
+
+        writeMetadata();
+    }
+
+    for (char* buffer : allocated_buffers_)
+    {
+        free(buffer);
+    }
+}
+
+bool sdr::IqRecorder::isOpen()
+{
+    return fd_ >= 0;
+}
+
+void sdr::IqRecorder::append(const std::complex<float>* samples, uint64_t sample_count)
+{
+    if (fd_ < 0)
+    {
+        return;
+    }
+
+    uint64_t retune_freq_hz = retune_freq_hz_.exchange(0, std::memory_order_acquire);
+    if (retune_freq_hz)
+    {
+        freq_hz_ = retune_freq_hz;
+        new_segment_ = true;
+    }
+
+    const char* data = reinterpret_cast<const char*>(samples);
+    uint64_t bytes = sample_count * sizeof(std::complex<float>);
+
+    while (bytes)
+    {
+        if ( ! buffer_ || buffer_bytes_ == IQ_RECORD_BUFFER_BYTES)
+        {
+            bool dropping = ! buffer_;
+            if ( ! swapBuffer())
+            {
+                // Whatever arrives next no longer follows on from the last sample recorded
+                uint64_t samples_dropped = bytes / sizeof(std::complex<float>);
+                samples_dropped_ += samples_dropped;
+                stats_->addIqDropped(samples_dropped, ! dropping);
+
+                new_segment_ = true;
+                return;
+            }
+        }
+
+        if (new_segment_)
+        {
+            segments_.push_back({samples_recorded_.load(std::memory_order_relaxed), freq_hz_, getRealtimeNs()});
+            new_segment_ = false;
+        }
+
+        // The buffer size is a multiple of the sample size, so samples never straddle buffers
+        uint64_t copy_bytes = std::min<uint64_t>(bytes, IQ_RECORD_BUFFER_BYTES - buffer_bytes_);
+        memcpy(buffer_ + buffer_bytes_, data, copy_bytes);
+
+        buffer_bytes_ += copy_bytes;
+        data += copy_bytes;
+        bytes -= copy_bytes;
+
+        samples_recorded_.fetch_add(copy_bytes / sizeof(std::complex<float>), std::memory_order_relaxed);
+    }
+}
+
+void sdr::IqRecorder::markRetune(uint64_t freq_hz)
+{
+    retune_freq_hz_.store(freq_hz, std::memory_order_release);
+}
+
+uint64_t sdr::IqRecorder::getSamplesRecorded()
+{
+    return samples_recorded_.load(std::memory_order_relaxed);
+}
+
+bool sdr::IqRecorder::swapBuffer()
+{
+    std::lock_guard<std::mutex> guard(lock_);
+
+    if (buffer_)
+    {
+        full_buffers_.push_back({buffer_, buffer_bytes_});
+        buffers_changed_.notify_one();
+    }
+
+    buffer_ = nullptr;
+    buffer_bytes_ = 0;
+
+    if (empty_buffers_.empty())
+    {
+        return false;
+    }
+
+    buffer_ = empty_buffers_.back();
+    empty_buffers_.pop_back();
+
+    return true;
+}
+
+void sdr::IqRecorder::run()
+{
+    while (true)
+    {
+        Buffer buffer;
+
+        {
+            std::unique_lock<std::mutex> guard(lock_);
+            buffers_changed_.wait(guard, [this]() {
+                return stop_ || ! full_buffers_.empty();
+            });
+
+            if (full_buffers_.empty())
+            {
+                break;
+            }
+
+            buffer = full_buffers_.front();
+            full_buffers_.pop_front();
+        }
+
+        // Once a write has failed (ie. the disk is full) the rest are dropped rather than leaving holes in the recording
+        auto t_start = std::chrono::steady_clock::now();
+        if ( ! write_failed_ && writeBuffer(buffer.data_, buffer.bytes_))
+        {
+            stats_->addIqWritten(buffer.bytes_, std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t_start).count());
+        }
+        else
+        {
+            if ( ! write_failed_)
+            {
+                std::cerr << "Could not write to the IQ recording " << base_path_ << ".sigmf-data: " << strerror(errno) << ", recording stopped" << std::endl;
+                write_failed_ = true;
+            }
+
+            stats_->addIqDropped(buffer.bytes_ / sizeof(std::complex<float>), false);
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            empty_buffers_.push_back(buffer.data_);
+        }
+    }
+}
+
+bool sdr::IqRecorder::writeBuffer(const char* data, uint64_t bytes)
+{
+    uint64_t written = 0;
+    while (written < bytes)
+    {
+        ssize_t result = pwrite(fd_, data + written, bytes - written, file_offset_ + written);
+        if (result < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (result <= 0)
+        {
+            return false;
+        }
+
+        written += result;
+    }
+
+    file_offset_ += written;
+
+    return true;
+}
+
+void sdr::IqRecorder::writeMetadata()
+{
+    std::string meta_path = base_path_ + ".sigmf-meta";
+
+    std::ofstream meta(meta_path, std::ios::out | std::ios::trunc);
+    if ( ! meta.is_open())
+    {
+        std::cerr << "Could not write " << meta_path << std::endl;
+        return;
+    }
+
+    uint64_t samples_written = file_offset_ / sizeof(std::complex<float>);
+
+    meta << "{\n";
+    meta << "    \"global\": {\n";
+    meta << "        \"core:datatype\": \"cf32_le\",\n";
+    meta << "        \"core:sample_rate\": " << sample_rate_hz_ << ",\n";
+    meta << "        \"core:version\": \"1.0.0\",\n";
+    meta << "        \"core:recorder\": \"waveguide\",\n";
+    meta << "        \"core:description\": \"Continuous recording from device " << static_cast<int>(device_id_) << ", "
+         << samples_dropped_ << " samples dropped between captures\"\n";
+    meta << "    },\n";
+    meta << "    \"captures\": [\n";
+
+    // A segment starts at each retune and after each run of dropped samples, those past a failed write aren't in the file
+    bool first = true;
+    for (const Segment& segment : segments_)
+    {
+        if (segment.sample_start_ >= samples_written && ! first)
+        {
+            break;
+        }
+
+        meta << (first ? "" : ",\n");
+        meta << "        {\n";
+        meta << "            \"core:sample_start\": " << segment.sample_start_ << ",\n";
+
+        if (segment.freq_hz_)
+        {
+            meta << "            \"core:frequency\": " << segment.freq_hz_ << ",\n";
+        }
+
+        meta << "            \"core:datetime\": \"" << formatTime(segment.time_ns_, false) << "\"\n";
+        meta << "        }";
+
+        first = false;
+    }
+
+    meta << "\n    ],\n";
+    meta << "    \"annotations\": []\n";
+    meta << "}\n";
+
+    meta.close();
+
+    std::cout << "Recorded " << samples_written << " IQ samples from device " << static_cast<int>(device_id_) << " to " << base_path_ << ".sigmf-data" << std::endl;
+}
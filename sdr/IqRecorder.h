@@ -0,0 +1,97 @@
+#ifndef WAVEGUIDE_SDR_IQRECORDER_H
+#define WAVEGUIDE_SDR_IQRECORDER_H
+
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <complex>
+#include <condition_variable>
+#include <cstdint>
+
+#include "SamplerStats.h"
+
+namespace sdr {
+
+    // Continuously records the raw IQ from a capture device to a SigMF recording (a .sigmf-data file of cf32_le
+    // samples, and a .sigmf-meta file with a capture segment for each retune). Samples are copied into a fixed pool of
+    // large page aligned buffers that a dedicated thread writes with O_DIRECT, bypassing the page cache so that
+    // recording at tens of MS/s doesn't evict everything else or stall on writeback. The GNU Radio thread only takes a
+    // lock to swap a full buffer for an empty one, and if the disk falls so far behind that none are empty it drops
+    // samples (counted in the SamplerStats) rather than holding back the rest of the flowgraph.
+    class IqRecorder {
+    public:
+        IqRecorder(const std::string& directory, uint8_t device_id, uint64_t sample_rate_hz, SamplerStats* stats);
+
+        // Writes whatever is still buffered and the metadata, so the flowgraph must have stopped appending.
+        ~IqRecorder();
+
+        // False if the recording couldn't be opened or its buffers couldn't be allocated, nothing is recorded.
+        bool isOpen();
+
+        // Called by the GNU Radio thread only.
+        void append(const std::complex<float>* samples, uint64_t sample_count);
+
+        // The device has been retuned to freq_hz, the next samples appended start a new capture segment.
+        void markRetune(uint64_t freq_hz);
+
+        uint64_t getSamplesRecorded();
+
+    private:
+        typedef struct
+        {
+            uint64_t sample_start_;         // first sample in the recording
+            uint64_t freq_hz_;
+            int64_t time_ns_;               // CLOCK_REALTIME when its first sample was appended
+        } Segment;
+
+        typedef struct
+        {
+            char* data_;
+            uint64_t bytes_;
+        } Buffer;
+
+        void run();
+
+        // Writes bytes from data at the end of the file, returns false on an error.
+        bool writeBuffer(const char* data, uint64_t bytes);
+
+        bool swapBuffer();
+        void writeMetadata();
+
+        std::string base_path_;
+        uint8_t device_id_;
+        uint64_t sample_rate_hz_;
+        SamplerStats* stats_;
+
+        int fd_;
+        bool direct_io_;                    // false if the filesystem doesn't support O_DIRECT
+        uint64_t file_offset_;              // owned by the writer thread (and the destructor once it has stopped)
+        bool write_failed_;
+
+        // Owned by the GNU Radio thread
+        char* buffer_;                      // being filled, nullptr while dropping samples
+        uint64_t buffer_bytes_;
+        std::vector<Segment> segments_;
+        bool new_segment_;                  // samples were dropped, the next appended start a new segment
+        uint64_t samples_dropped_;
+        uint64_t freq_hz_;
+
+        std::atomic<uint64_t> retune_freq_hz_;      // set by markRetune() until append() starts its segment (0 if none)
+        std::atomic<uint64_t> samples_recorded_;
+
+        std::vector<char*> allocated_buffers_;
+
+        std::thread* thread_;
+        std::mutex lock_;                   // guards everything below
+        std::condition_variable buffers_changed_;
+        std::vector<char*> empty_buffers_;
+        std::deque<Buffer> full_buffers_;
+        bool stop_;
+    };
+
+}
+
+#endif //WAVEGUIDE_SDR_IQRECORDER_H
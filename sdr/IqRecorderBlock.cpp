@@ -0,0 +1,19 @@
+#include "IqRecorderBlock.h"
+
+sdr::IqRecorderBlock::IqRecorderBlock(std::string name, IqRecorder* recorder) :
+        gr::sync_block(name, gr::io_signature::make(1, 1, sizeof(gr_complex)), gr::io_signature::make(0, 0, 0)),
+        recorder_(recorder)
+{
+}
+
+sdr::IqRecorderBlock::sptr sdr::IqRecorderBlock::make(std::string block_name, IqRecorder* recorder)
+{
+    return boost::shared_ptr<sdr::IqRecorderBlock>(new IqRecorderBlock(block_name, recorder));
+}
+
+int sdr::IqRecorderBlock::work(int noutput_items, gr_vector_const_void_star& input_items, gr_vector_void_star& output_items)
+{
+    recorder_->append(static_cast<const std::complex<float>*>(input_items[0]), noutput_items);
+
+    return noutput_items;
+}
@@ -0,0 +1,30 @@
+#ifndef WAVEGUIDE_SDR_IQRECORDERBLOCK_H
+#define WAVEGUIDE_SDR_IQRECORDERBLOCK_H
+
+#include <string>
+
+#include <gnuradio/sync_block.h>
+
+#include "IqRecorder.h"
+
+namespace sdr {
+
+    // Sink that hands the raw IQ from a capture device to an IqRecorder.
+    class IqRecorderBlock : public gr::sync_block {
+    public:
+        IqRecorderBlock(std::string block_name, IqRecorder* recorder);
+        virtual ~IqRecorderBlock() = default;
+
+        typedef boost::shared_ptr<IqRecorderBlock> sptr;
+
+        static sptr make(std::string block_name, IqRecorder* recorder);
+
+    private:
+        virtual int work(int noutput_items, gr_vector_const_void_star& input_items, gr_vector_void_star& output_items);
+
+        IqRecorder* recorder_;
+    };
+
+}
+
+#endif //WAVEGUIDE_SDR_IQRECORDERBLOCK_H
@@ -0,0 +1,170 @@
+#include "IqTapBlock.h"
+
+#include <cstring>
+#include <ctime>
+#include <algorithm>
+
+sdr::IqTapBlock::IqTapBlock(std::string name, uint64_t pre_trigger_samples, uint64_t post_trigger_samples) :
+        gr::sync_block(name, gr::io_signature::make(1, 1, sizeof(gr_complex)), gr::io_signature::make(0, 0, 0)),
+        ring_size_(std::max<uint64_t>(pre_trigger_samples, 1)), post_trigger_samples_(post_trigger_samples)
+{
+    ring_ = new std::complex<float>[ring_size_];
+    ring_position_ = 0;
+    ring_filled_ = 0;
+
+    retune_generation_ = 0;
+    settled_generation_ = 0;
+    retune_settle_samples_ = 0;
+    ring_generation_ = 0;
+    settle_remaining_ = 0;
+
+    state_ = IDLE;
+
+    capture_ = nullptr;
+    capture_length_ = 0;
+    capture_filled_ = 0;
+}
+
+sdr::IqTapBlock::~IqTapBlock()
+{
+    if (capture_)
+    {
+        delete capture_;
+    }
+
+    delete[] ring_;
+}
+
+sdr::IqTapBlock::sptr sdr::IqTapBlock::make(std::string block_name, uint64_t pre_trigger_samples, uint64_t post_trigger_samples)
+{
+    return boost::shared_ptr<sdr::IqTapBlock>(new IqTapBlock(block_name, pre_trigger_samples, post_trigger_samples));
+}
+
+bool sdr::IqTapBlock::trigger(const IqCapture& trigger)
+{
+    if (state_.load(std::memory_order_acquire) != IDLE)
+    {
+        return false;
+    }
+
+    // Sized (which also touches every page) here rather than in work(), so the GNU Radio thread never allocates
+    capture_ = new IqCapture(trigger);
+    capture_->samples_.resize(ring_size_ + post_trigger_samples_);
+
+    state_.store(TRIGGERED, std::memory_order_release);
+
+    return true;
+}
+
+bool sdr::IqTapBlock::isCapturing()
+{
+    return state_.load(std::memory_order_acquire) != IDLE;
+}
+
+sdr::IqCapture* sdr::IqTapBlock::takeCapture()
+{
+    if (state_.load(std::memory_order_acquire) != CAPTURED)
+    {
+        return nullptr;
+    }
+
+    IqCapture* capture = capture_;
+    capture_ = nullptr;
+
+    state_.store(IDLE, std::memory_order_release);
+
+    return capture;
+}
+
+void sdr::IqTapBlock::markRetune(uint64_t settle_samples)
+{
+    retune_settle_samples_.store(settle_samples, std::memory_order_relaxed);
+    retune_generation_.fetch_add(1, std::memory_order_release);
+}
+
+bool sdr::IqTapBlock::isSettled()
+{
+    return settled_generation_.load(std::memory_order_acquire) == retune_generation_.load(std::memory_order_acquire);
+}
+
+int sdr::IqTapBlock::work(int noutput_items, gr_vector_const_void_star& input_items, gr_vector_void_star& output_items)
+{
+    const std::complex<float>* samples = static_cast<const std::complex<float>*>(input_items[0]);
+    uint64_t sample_count = noutput_items;
+
+    // The ring is emptied on each retune and only refilled once the samples that were in flight have passed
+    uint64_t retune_generation = retune_generation_.load(std::memory_order_acquire);
+    if (retune_generation != ring_generation_)
+    {
+        ring_generation_ = retune_generation;
+        ring_position_ = 0;
+        ring_filled_ = 0;
+        settle_remaining_ = retune_settle_samples_.load(std::memory_order_relaxed);
+    }
+
+    if (settle_remaining_)
+    {
+        uint64_t dropped = std::min(settle_remaining_, sample_count);
+        samples += dropped;
+        sample_count -= dropped;
+        settle_remaining_ -= dropped;
+    }
+
+    if ( ! settle_remaining_)
+    {
+        settled_generation_.store(ring_generation_, std::memory_order_release);
+    }
+
+    State state = state_.load(std::memory_order_acquire);
+
+    if (state == TRIGGERED)
+    {
+        // The capture starts with the ring, oldest sample first
+        capture_length_ = ring_filled_ + post_trigger_samples_;
+        capture_->pre_trigger_samples_ = ring_filled_;
+
+        uint64_t oldest = (ring_position_ + ring_size_ - ring_filled_) % ring_size_;
+        uint64_t first_part = std::min(ring_filled_, ring_size_ - oldest);
+        memcpy(capture_->samples_.data(), ring_ + oldest, first_part * sizeof(std::complex<float>));
+        memcpy(capture_->samples_.data() + first_part, ring_, (ring_filled_ - first_part) * sizeof(std::complex<float>));
+        capture_filled_ = ring_filled_;
+
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        capture_->trigger_time_ns_ = (static_cast<int64_t>(now.tv_sec) * 1000000000) + now.tv_nsec;
+
+        state = CAPTURING;
+        state_.store(state, std::memory_order_release);
+    }
+
+    if (state == CAPTURING)
+    {
+        uint64_t count = std::min(capture_length_ - capture_filled_, sample_count);
+        memcpy(capture_->samples_.data() + capture_filled_, samples, count * sizeof(std::complex<float>));
+        capture_filled_ += count;
+
+        if (capture_filled_ >= capture_length_)
+        {
+            // Shrinking never reallocates
+            capture_->samples_.resize(capture_length_);
+
+            state_.store(CAPTURED, std::memory_order_release);
+        }
+    }
+
+    // Only the newest ring_size_ samples can survive
+    if (sample_count > ring_size_)
+    {
+        samples += sample_count - ring_size_;
+        sample_count = ring_size_;
+    }
+
+    uint64_t first_part = std::min(sample_count, ring_size_ - ring_position_);
+    memcpy(ring_ + ring_position_, samples, first_part * sizeof(std::complex<float>));
+    memcpy(ring_, samples + first_part, (sample_count - first_part) * sizeof(std::complex<float>));
+
+    ring_position_ = (ring_position_ + sample_count) % ring_size_;
+    ring_filled_ = std::min(ring_filled_ + sample_count, ring_size_);
+
+    return noutput_items;
+}
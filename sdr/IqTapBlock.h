@@ -0,0 +1,76 @@
+#ifndef WAVEGUIDE_SDR_IQTAPBLOCK_H
+#define WAVEGUIDE_SDR_IQTAPBLOCK_H
+
+#include <string>
+#include <atomic>
+
+#include <gnuradio/sync_block.h>
+
+#include "IqCaptureWriter.h"
+
+namespace sdr {
+
+    // Taps the raw IQ from a capture device, keeping the most recent pre_trigger_samples in a ring. When triggered it
+    // captures the ring followed by post_trigger_samples more, which the sample thread then takes (to hand to an
+    // IqCaptureWriter). Only the GNU Radio thread touches the ring and the capture in progress, triggering just hands it
+    // a request (with the capture's buffer already allocated) and finished captures are left for the sample thread, so
+    // the tap costs a copy into the ring and never locks, allocates or frees.
+    class IqTapBlock : public gr::sync_block {
+    public:
+        IqTapBlock(std::string block_name, uint64_t pre_trigger_samples, uint64_t post_trigger_samples);
+        virtual ~IqTapBlock();
+
+        typedef boost::shared_ptr<IqTapBlock> sptr;
+
+        static sptr make(std::string block_name, uint64_t pre_trigger_samples, uint64_t post_trigger_samples);
+
+        // Starts a capture described by trigger (whose samples_ are filled in by the tap), returns false if a capture
+        // is already in progress.
+        bool trigger(const IqCapture& trigger);
+
+        // A capture has been triggered but not yet taken (the device shouldn't be retuned).
+        bool isCapturing();
+
+        // Returns the finished capture (and ownership of it), or nullptr if there isn't one yet. A new capture can be
+        // triggered once it has been taken.
+        IqCapture* takeCapture();
+
+        // Empties the ring as the device has been retuned, then drops the next settle_samples (which were in flight
+        // when it was retuned) before filling it again.
+        void markRetune(uint64_t settle_samples);
+
+        // The ring only holds samples from after the last retune (so a trigger won't capture the previous slice).
+        bool isSettled();
+
+    private:
+        enum State : uint8_t {
+            IDLE,                           // only filling the ring
+            TRIGGERED,                      // trigger_ is ready to be started by work()
+            CAPTURING,                      // capture_ is being filled by work()
+            CAPTURED                        // capture_ is complete and waiting for takeCapture()
+        };
+
+        virtual int work(int noutput_items, gr_vector_const_void_star& input_items, gr_vector_void_star& output_items);
+
+        std::complex<float>* ring_;
+        uint64_t ring_size_;
+        uint64_t ring_position_;            // next sample to overwrite
+        uint64_t ring_filled_;
+
+        std::atomic<uint64_t> retune_generation_;       // bumped by markRetune()
+        std::atomic<uint64_t> settled_generation_;      // the retune the ring has been refilled since
+        std::atomic<uint64_t> retune_settle_samples_;
+        uint64_t ring_generation_;          // the retune the ring was last emptied for
+        uint64_t settle_remaining_;         // samples still to be dropped since then
+
+        std::atomic<State> state_;
+        uint64_t post_trigger_samples_;
+
+        IqCapture* capture_;                // allocated by trigger() while IDLE, filled by work() once TRIGGERED, taken once CAPTURED
+        uint64_t capture_length_;
+        uint64_t capture_filled_;
+    };
+
+}
+
+#endif //WAVEGUIDE_SDR_IQTAPBLOCK_H
@@ -0,0 +1,234 @@
+#include "OccupancyStore.h"
+
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <cassert>
+#include <cmath>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define OCCUPANCY_MAGIC 0x4f435550      // "OCUP"
+#define OCCUPANCY_VERSION 1
+
+sdr::OccupancyStore::OccupancyStore(const std::string& path, uint64_t start_freq_hz, double bin_bw_hz, uint64_t bin_count, uint32_t bucket_count) :
+        path_(path), start_freq_hz_(start_freq_hz), bin_bw_hz_(bin_bw_hz), bin_count_(bin_count), bucket_count_(bucket_count)
+{
+    mapping_ = nullptr;
+    header_ = nullptr;
+    bucket_start_times_ = nullptr;
+    counters_ = nullptr;
+
+    current_hour_ = -1;
+    current_bucket_ = 0;
+
+    mapping_size_ = sizeof(Header) + (sizeof(int64_t) * bucket_count_) + (sizeof(Counter) * bucket_count_ * bin_count_);
+
+    // Re-use an existing file if it describes exactly the same bins, otherwise start afresh
+    if ( ! mapFile(false))
+    {
+        mapFile(true);
+    }
+
+    if (mapping_)
+    {
+        advance(time(nullptr));
+    }
+}
+
+sdr::OccupancyStore::~OccupancyStore()
+{
+    if (mapping_)
+    {
+        msync(mapping_, mapping_size_, MS_ASYNC);
+        munmap(mapping_, mapping_size_);
+    }
+}
+
+bool sdr::OccupancyStore::mapFile(bool initialise)
+{
+    int fd = open(path_.c_str(), O_RDWR | O_CREAT | (initialise ? O_TRUNC : 0), 0644);
+    if (fd < 0)
+    {
+        std::cerr << "Could not open occupancy file " << path_ << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || (! initialise && static_cast<size_t>(file_stat.st_size) != mapping_size_))
+    {
+        close(fd);
+        return false;
+    }
+
+    if (initialise && ftruncate(fd, mapping_size_) != 0)
+    {
+        std::cerr << "Could not size occupancy file " << path_ << ": " << strerror(errno) << std::endl;
+        close(fd);
+        return false;
+    }
+
+    void* mapping = mmap(nullptr, mapping_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (mapping == MAP_FAILED)
+    {
+        std::cerr << "Could not map occupancy file " << path_ << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    Header* header = static_cast<Header*>(mapping);
+
+    if (initialise)
+    {
+        // The file was truncated, so all counters and bucket times start as zero
+        header->magic_ = OCCUPANCY_MAGIC;
+        header->version_ = OCCUPANCY_VERSION;
+        header->start_freq_hz_ = start_freq_hz_;
+        header->bin_bw_hz_ = bin_bw_hz_;
+        header->bin_count_ = bin_count_;
+        header->bucket_count_ = bucket_count_;
+        header->bucket_seconds_ = BUCKET_SECONDS;
+    }
+    else if (header->magic_ != OCCUPANCY_MAGIC || header->version_ != OCCUPANCY_VERSION ||
+             header->start_freq_hz_ != start_freq_hz_ || header->bin_bw_hz_ != bin_bw_hz_ ||
+             header->bin_count_ != bin_count_ || header->bucket_count_ != bucket_count_ ||
+             header->bucket_seconds_ != BUCKET_SECONDS)
+    {
+        munmap(mapping, mapping_size_);
+        return false;
+    }
+
+    mapping_ = mapping;
+    header_ = header;
+    bucket_start_times_ = reinterpret_cast<int64_t*>(static_cast<uint8_t*>(mapping) + sizeof(Header));
+    counters_ = reinterpret_cast<Counter*>(bucket_start_times_ + bucket_count_);
+
+    std::cout << (initialise ? "Created" : "Opened") << " occupancy file " << path_ << " (" << bucket_count_ << " hourly buckets of " << bin_count_ << " bins)" << std::endl;
+
+    return true;
+}
+
+bool sdr::OccupancyStore::isOpen()
+{
+    return mapping_ != nullptr;
+}
+
+uint64_t sdr::OccupancyStore::getBinCount()
+{
+    return bin_count_;
+}
+
+uint32_t sdr::OccupancyStore::getBucketCount()
+{
+    return bucket_count_;
+}
+
+sdr::OccupancyStore::Counter* sdr::OccupancyStore::getBucketCounters(uint32_t bucket)
+{
+    assert(bucket < bucket_count_);
+    return counters_ + (static_cast<uint64_t>(bucket) * bin_count_);
+}
+
+void sdr::OccupancyStore::advance(time_t now)
+{
+    int64_t hour = now / BUCKET_SECONDS;
+
+    if ( ! mapping_ || hour == current_hour_.load(std::memory_order_acquire))
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> guard(lock_);
+
+    if (hour == current_hour_.load(std::memory_order_relaxed))
+    {
+        return;     // another sampler thread beat us to it
+    }
+
+    uint32_t bucket = static_cast<uint32_t>(hour % bucket_count_);
+    int64_t bucket_start_time = hour * BUCKET_SECONDS;
+
+    // The bucket is re-used once the store wraps around, at which point its old hour is discarded
+    if (bucket_start_times_[bucket] != bucket_start_time)
+    {
+        memset(getBucketCounters(bucket), 0, sizeof(Counter) * bin_count_);
+        bucket_start_times_[bucket] = bucket_start_time;
+    }
+
+    current_bucket_.store(bucket, std::memory_order_release);
+    current_hour_.store(hour, std::memory_order_release);
+}
+
+void sdr::OccupancyStore::record(uint64_t bin_number, bool busy)
+{
+    assert(bin_number < bin_count_);
+
+    Counter* counter = getBucketCounters(current_bucket_.load(std::memory_order_relaxed)) + bin_number;
+
+    // Saturate rather than wrap so that a bucket never reports less occupancy than it saw
+    if (counter->total_ == UINT32_MAX)
+    {
+        return;
+    }
+
+    counter->total_++;
+    if (busy)
+    {
+        counter->busy_++;
+    }
+}
+
+float sdr::OccupancyStore::getDutyCycle(uint64_t start_freq_hz, uint64_t end_freq_hz, time_t start_time, time_t end_time)
+{
+    start_freq_hz = start_freq_hz < start_freq_hz_ ? start_freq_hz_ : start_freq_hz;
+    end_freq_hz = end_freq_hz < start_freq_hz ? start_freq_hz : end_freq_hz;
+
+    uint64_t start_bin = static_cast<uint64_t>(floor((start_freq_hz - start_freq_hz_) / bin_bw_hz_));
+    uint64_t end_bin = static_cast<uint64_t>(floor((end_freq_hz - start_freq_hz_) / bin_bw_hz_));
+
+    return getDutyCycleForBins(start_bin, end_bin, start_time, end_time);
+}
+
+float sdr::OccupancyStore::getDutyCycleForBins(uint64_t start_bin, uint64_t end_bin, time_t start_time, time_t end_time)
+{
+    if ( ! mapping_ || start_bin >= bin_count_)
+    {
+        return -1.0f;
+    }
+
+    if (end_bin >= bin_count_)
+    {
+        end_bin = bin_count_ - 1;
+    }
+
+    uint64_t busy = 0, total = 0;
+
+    for (uint32_t bucket = 0; bucket < bucket_count_; bucket++)
+    {
+        int64_t bucket_start_time = bucket_start_times_[bucket];
+
+        // Skip empty buckets and those that don't overlap the window
+        if (bucket_start_time == 0 || bucket_start_time > end_time || bucket_start_time + BUCKET_SECONDS <= start_time)
+        {
+            continue;
+        }
+
+        Counter* counters = getBucketCounters(bucket);
+        for (uint64_t bin = start_bin; bin <= end_bin; bin++)
+        {
+            busy += counters[bin].busy_;
+            total += counters[bin].total_;
+        }
+    }
+
+    if (total == 0)
+    {
+        return -1.0f;
+    }
+
+    return static_cast<float>(busy) / static_cast<float>(total);
+}
@@ -0,0 +1,83 @@
+#ifndef WAVEGUIDE_SDR_OCCUPANCYSTORE_H
+#define WAVEGUIDE_SDR_OCCUPANCYSTORE_H
+
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <cstdint>
+#include <ctime>
+
+namespace sdr {
+
+    // Counts how often each frequency bin is "busy" into hourly buckets held in a memory-mapped file, so that the duty
+    // cycle of any frequency range over any time window can be queried without keeping (or scanning) raw sweeps. The
+    // file survives restarts, so occupancy accumulates across sessions for the same frequency range.
+    class OccupancyStore {
+    public:
+        OccupancyStore(const std::string& path, uint64_t start_freq_hz, double bin_bw_hz, uint64_t bin_count, uint32_t bucket_count = 168);
+        ~OccupancyStore();
+
+        bool isOpen();
+
+        // Moves the store onto the hourly bucket covering now, clearing the bucket if it last held an older hour.
+        void advance(time_t now);
+
+        // Counts a single sample for bin_number. Each bin must only ever be recorded by a single thread.
+        void record(uint64_t bin_number, bool busy);
+
+        // Gets the fraction (0.0 - 1.0) of samples that were busy from start_freq_hz to end_freq_hz over every bucket
+        // overlapping the window from start_time to end_time. Returns a negative value if nothing was recorded.
+        float getDutyCycle(uint64_t start_freq_hz, uint64_t end_freq_hz, time_t start_time, time_t end_time);
+
+        // As above but for a range of bin numbers (inclusive of both ends).
+        float getDutyCycleForBins(uint64_t start_bin, uint64_t end_bin, time_t start_time, time_t end_time);
+
+        uint64_t getBinCount();
+        uint32_t getBucketCount();
+
+        // Length of time covered by each bucket in seconds.
+        static const uint32_t BUCKET_SECONDS = 3600;
+
+    private:
+        typedef struct
+        {
+            uint32_t magic_;
+            uint32_t version_;
+            uint64_t start_freq_hz_;
+            double bin_bw_hz_;
+            uint64_t bin_count_;
+            uint32_t bucket_count_;
+            uint32_t bucket_seconds_;
+        } Header;
+
+        // Compact per-bin, per-bucket counters.
+        typedef struct
+        {
+            uint32_t busy_;
+            uint32_t total_;
+        } Counter;
+
+        bool mapFile(bool initialise);
+        Counter* getBucketCounters(uint32_t bucket);
+
+        std::string path_;
+        std::mutex lock_;                       // serialises bucket rollover
+
+        uint64_t start_freq_hz_;
+        double bin_bw_hz_;
+        uint64_t bin_count_;
+        uint32_t bucket_count_;
+
+        size_t mapping_size_;
+        void* mapping_;
+        Header* header_;
+        int64_t* bucket_start_times_;           // start time (seconds since the epoch) of the hour held in each bucket
+        Counter* counters_;                     // bucket_count_ rows of bin_count_ counters
+
+        std::atomic<int64_t> current_hour_;
+        std::atomic<uint32_t> current_bucket_;
+    };
+
+}
+
+#endif //WAVEGUIDE_SDR_OCCUPANCYSTORE_H
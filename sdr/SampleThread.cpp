@@ -1,24 +1,32 @@
 #include "SampleThread.h"
 
 #include "VectorSinkBlock.h"
+#include "IqTapBlock.h"
+#include "IqRecorderBlock.h"
+#include "FftFanoutBlock.h"
 
 #include <iostream>
 #include <vector>
+#include <map>
 #include <cmath>
+#include <algorithm>
 
 #include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <cstring>
+#include <ctime>
 
 #include <gnuradio/top_block.h>
 #include <gnuradio/analog/sig_source.h>
+#include <gnuradio/analog/noise_source.h>
+#include <gnuradio/blocks/add_blk.h>
 #include <gnuradio/blocks/throttle.h>
 #include <gnuradio/blocks/stream_to_vector.h>
-#include <gnuradio/blocks/complex_to_mag_squared.h>
-#include <gnuradio/blocks/nlog10_ff.h>
 #include <gnuradio/blocks/probe_signal_v.h>
-#include <gnuradio/fft/fft_vcc.h>
 #include <gnuradio/filter/firdes.h>
+#include <gnuradio/filter/freq_xlating_fir_filter.h>
 #include <gnuradio/blocks/null_sink.h>
-#include <gnuradio/filter/single_pole_iir_filter_ff.h>
 #include <osmosdr/source.h>
 
 #include "Config.h"
@@ -26,10 +34,33 @@
 // When requesting a new center frequency, the capture device must tune to within 100Hz of the requested frequency.
 #define TUNING_TOLERANCE 100
 
+// How often to check for a completed sweep when the device is tuned to a single frequency.
+#define SINGLE_TUNE_POLL_INTERVAL_US 1000
+
+// The first sweep only dwells long enough for this many vectors per slice (if that's shorter than the configured dwell)
+// so that every bin has data on screen quickly after starting, later sweeps then refine it.
+#define FIRST_SWEEP_VECTORS 4
+
+// Vectors in flight when the device is retuned (in the device's and the flowgraph's buffers) hold the previous slice,
+// this long's worth of them are dropped after each retune and the dwell is extended to make up for them.
+#define RETUNE_SETTLE_MS 20
+
+// Raw IQ kept from before and after each trigger.
+#define IQ_PRE_TRIGGER_MS 250
+#define IQ_POST_TRIGGER_MS 250
+
+// How often the bins of the current slice are checked against the IQ trigger, and how long to wait after a trigger
+// before another (so that a persistent signal doesn't fill the disk).
+#define IQ_TRIGGER_CHECK_INTERVAL_MS 50
+#define IQ_TRIGGER_HOLDOFF_MS 10000
+
+// Device prefix that replaces the capture device with a generated test signal (used for benchmarking).
+#define SYNTHETIC_DEVICE_PREFIX "synthetic"
+
 sdr::SampleThread::SampleThread(Config* config, uint8_t device_id, uint64_t start_freq_hz,
-                                uint64_t end_freq_hz, SpectrumSamples* samples) :
+                                uint64_t end_freq_hz, SpectrumSamples* samples, IqCaptureWriter* iq_writer) :
     config_(config), device_id_(device_id), start_freq_hz_(start_freq_hz), end_freq_hz_(end_freq_hz),
-    samples_(samples)
+    samples_(samples), iq_writer_(iq_writer)
 {
     device_type_ = config->getDevicePrefix();
     sample_rate_hz_ = config->getSampleRate();
@@ -39,12 +70,35 @@ sdr::SampleThread::SampleThread(Config* config, uint8_t device_id, uint64_t star
     sweep_count_ = 0;
 
     dwell_time_us_ = config->getDwellTime();
+    settings_changed_ = false;
+
+    startup_timings_ = {-1.0, -1.0, -1.0, -1.0};
+
+    has_device_clock_offset_ = false;
+    device_clock_offset_ns_ = 0;
+
+    iq_trigger_requested_ = false;
 }
 
 sdr::SampleThread::~SampleThread()
 {
 }
 
+sdr::SamplerStats* sdr::SampleThread::getStats()
+{
+    return &stats_;
+}
+
+void sdr::SampleThread::updateSettings()
+{
+    settings_changed_.store(true, std::memory_order_release);
+}
+
+void sdr::SampleThread::triggerIqCapture()
+{
+    iq_trigger_requested_.store(true, std::memory_order_release);
+}
+
 bool sdr::SampleThread::start()
 {
     if (thread_)
@@ -53,11 +107,314 @@ bool sdr::SampleThread::start()
         return false;
     }
 
+    started_at_ = std::chrono::steady_clock::now();
     thread_ = new std::thread(std::ref(*this));
 
     return true;
 }
 
+sdr::SampleThread::StartupTimings sdr::SampleThread::getStartupTimings()
+{
+    std::lock_guard<std::mutex> guard(startup_lock_);
+
+    return startup_timings_;
+}
+
+void sdr::SampleThread::markStartupStage(double& timing)
+{
+    std::lock_guard<std::mutex> guard(startup_lock_);
+
+    if (timing < 0)
+    {
+        timing = std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(std::chrono::steady_clock::now() - started_at_).count();
+    }
+}
+
+void sdr::SampleThread::recordSliceCapture(VectorSinkBlock* vector_sink, uint64_t start_freq_hz, uint64_t end_freq_hz)
+{
+    int64_t first_capture_ns, last_capture_ns;
+    bool device_clock = vector_sink->takeCaptureTimes(first_capture_ns, last_capture_ns);
+    if (first_capture_ns < 0 || last_capture_ns < 0)
+    {
+        return;
+    }
+
+    // Capture times are moved onto CLOCK_REALTIME so that they can be compared across devices and with when sweeps
+    // completed
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    int64_t realtime_ns = (static_cast<int64_t>(now.tv_sec) * 1000000000) + now.tv_nsec;
+
+    int64_t offset_ns;
+    if (device_clock)
+    {
+        // The device's clock has its own epoch, so it's anchored to CLOCK_REALTIME by the first slice timed with it.
+        // Times keep the device clock's precision relative to each other but are early by up to that slice's latency.
+        if ( ! has_device_clock_offset_)
+        {
+            device_clock_offset_ns_ = realtime_ns - last_capture_ns;
+            has_device_clock_offset_ = true;
+        }
+
+        offset_ns = device_clock_offset_ns_;
+    }
+    else
+    {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        offset_ns = realtime_ns - ((static_cast<int64_t>(now.tv_sec) * 1000000000) + now.tv_nsec);
+    }
+
+    samples_->setSliceCapture(start_freq_hz, end_freq_hz, sweep_count_, first_capture_ns + offset_ns, last_capture_ns + offset_ns, device_clock);
+}
+
+void sdr::SampleThread::checkIqTrigger(IqTapBlock* iq_tap, bool slice_written, uint64_t center_freq_hz, uint64_t start_freq_hz, uint64_t end_freq_hz)
+{
+    // Finished captures are queued from here rather than the GNU Radio thread, as the writer locks (and may drop them)
+    IqCapture* capture = iq_tap->takeCapture();
+    if (capture)
+    {
+        iq_writer_->write(capture);
+    }
+
+    // Until then the bins hold the slice's previous visit and the tap's ring could still hold the previous slice
+    if ( ! slice_written || ! iq_tap->isSettled())
+    {
+        return;
+    }
+
+    auto t_now = std::chrono::steady_clock::now();
+    if (std::chrono::duration_cast<std::chrono::milliseconds>(t_now - iq_checked_at_).count() < IQ_TRIGGER_CHECK_INTERVAL_MS)
+    {
+        return;
+    }
+
+    iq_checked_at_ = t_now;
+
+    bool requested = iq_trigger_requested_.exchange(false, std::memory_order_acquire);
+    if ( ! requested && std::chrono::duration_cast<std::chrono::milliseconds>(t_now - iq_triggered_at_).count() < IQ_TRIGGER_HOLDOFF_MS)
+    {
+        return;
+    }
+
+    IqCapture trigger;
+    trigger.device_id_ = device_id_;
+    trigger.center_freq_hz_ = center_freq_hz;
+    trigger.sample_rate_hz_ = sample_rate_hz_;
+    trigger.trigger_freq_hz_ = 0;
+    trigger.trigger_snr_db_ = 0.0f;
+    trigger.trigger_time_ns_ = 0;
+    trigger.pre_trigger_samples_ = 0;
+
+    if ( ! requested)
+    {
+        // The latest sample (rather than the moving average) so that short bursts are caught while they're on air
+        uint64_t end_bin = std::min(samples_->getBinNumber(end_freq_hz), samples_->getBinCount() - 1);
+        for (uint64_t bin = samples_->getBinNumber(start_freq_hz); bin <= end_bin; bin++)
+        {
+            float snr_db = samples_->getBinSignalToNoiseRatio(bin, false);
+            if (snr_db > trigger.trigger_snr_db_)
+            {
+                trigger.trigger_snr_db_ = snr_db;
+                trigger.trigger_freq_hz_ = samples_->getBinFrequency(bin);
+            }
+        }
+
+        if (trigger.trigger_snr_db_ < config_->getIqTriggerSnr())
+        {
+            return;
+        }
+    }
+
+    if (iq_tap->trigger(trigger))
+    {
+        iq_triggered_at_ = t_now;
+    }
+    else if (requested)
+    {
+        // A capture is still in progress, so the request waits for the next check rather than being lost
+        iq_trigger_requested_.store(true, std::memory_order_release);
+    }
+}
+
+void sdr::SampleThread::applySchedulingPolicy()
+{
+    std::vector<int> cores = config_->getDeviceCores(device_id_);
+    if ( ! cores.empty())
+    {
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+
+        for (int core : cores)
+        {
+            CPU_SET(core, &cpu_set);
+        }
+
+        // Bins are allocated by the first thread to write them, so pinning also keeps this device's bins on its NUMA node
+        int error = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+        if (error != 0)
+        {
+            std::cerr << "Could not pin sample thread on " << start_freq_hz_ << "Hz to its cores: " << strerror(error) << std::endl;
+        }
+        else
+        {
+            std::cout << "Sample thread on " << start_freq_hz_ << "Hz is pinned to " << cores.size() << " cores" << std::endl;
+        }
+    }
+}
+
+bool sdr::SampleThread::setRealtimePriority(bool realtime)
+{
+    uint8_t priority = config_->getRealtimePriority();
+    if ( ! priority)
+    {
+        return false;
+    }
+
+    struct sched_param param;
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = realtime ? priority : 0;
+
+    int error = pthread_setschedparam(pthread_self(), realtime ? SCHED_FIFO : SCHED_OTHER, &param);
+    if (error != 0)
+    {
+        if (realtime)
+        {
+            std::cerr << "Could not set SCHED_FIFO priority " << static_cast<int>(priority) << " for flowgraph on " << start_freq_hz_ << "Hz (needs CAP_SYS_NICE): " << strerror(error) << std::endl;
+        }
+        else
+        {
+            std::cerr << "Could not return sample thread on " << start_freq_hz_ << "Hz to SCHED_OTHER: " << strerror(error) << std::endl;
+        }
+
+        return false;
+    }
+
+    return true;
+}
+
+std::vector<sdr::SampleThread::Slice> sdr::SampleThread::planSlices()
+{
+    std::vector<Slice> slices;
+    uint64_t tune_freq_hz = start_freq_hz_;
+
+    while (true)
+    {
+        Slice slice;
+        slice.tune_freq_hz_ = tune_freq_hz;
+
+        // The FFT straddles the center tuning frequency
+        slice.start_fft_freq_hz_ = static_cast<uint64_t>(tune_freq_hz - (sample_rate_hz_ / 2.0));  // TODO: watch for underrun
+        uint64_t end_fft_freq_hz = static_cast<uint64_t>(tune_freq_hz + (sample_rate_hz_ / 2.0));
+
+        // But we ignore out-of-range portions on the first and last slice, and the bottom and top ends of the
+        // FFT on intermediate slices (the SDR tested with often has aliases around these areas).
+        if (slice.start_fft_freq_hz_ < start_freq_hz_)     // first slice
+        {
+            slice.start_slice_freq_hz_ = start_freq_hz_;
+        }
+        else                                                // intermediate slice
+        {
+            slice.start_slice_freq_hz_ = slice.start_fft_freq_hz_ + static_cast<uint64_t>(sample_rate_hz_ / 6.0);
+        }
+
+        if (end_fft_freq_hz > end_freq_hz_)                 // last slice
+        {
+            slice.end_slice_freq_hz_ = end_freq_hz_;
+        }
+        else                                                // intermediate slice
+        {
+            slice.end_slice_freq_hz_ = end_fft_freq_hz - static_cast<uint64_t>(sample_rate_hz_ / 6.0);
+        }
+
+        if (slice.start_slice_freq_hz_ > end_freq_hz_)
+        {
+            break;
+        }
+
+        // Ensure ignoring the bottom and top ends doesn't create "gaps" that don't get scanned.
+        assert(slices.empty() || (slice.start_slice_freq_hz_ <= slices.back().end_slice_freq_hz_));
+
+//      std::cout << "Slice: " << slices.size() << ", tuned to " << tune_freq_hz << "Hz (FFT: " << slice.start_fft_freq_hz_ << ", " << end_fft_freq_hz << ") (Slice: " << slice.start_slice_freq_hz_ << ", " << slice.end_slice_freq_hz_ << ")" << std::endl;
+
+        slices.push_back(slice);
+        tune_freq_hz += sample_rate_hz_ / 2.0;
+    }
+
+    return slices;
+}
+
+std::vector<uint32_t> sdr::SampleThread::orderSlices(uint32_t slice_count, const std::string& slice_order)
+{
+    std::vector<uint32_t> order;
+
+    if (slice_order == "interleaved")
+    {
+        // Bit-reversed order (0, n/2, n/4, 3n/4, ...) repeatedly halves the largest unscanned gap
+        uint32_t bits = 0;
+        while ((1u << bits) < slice_count)
+        {
+            bits++;
+        }
+
+        for (uint32_t i = 0; i < (1u << bits); i++)
+        {
+            uint32_t reversed = 0;
+            for (uint32_t bit = 0; bit < bits; bit++)
+            {
+                reversed |= ((i >> bit) & 1) << (bits - 1 - bit);
+            }
+
+            if (reversed < slice_count)
+            {
+                order.push_back(reversed);
+            }
+        }
+    }
+    else if (slice_order == "coarse")
+    {
+        // A coarse pass over every stride'th slice, then the slices in between from low to high
+        uint32_t stride = std::max<uint32_t>(2, static_cast<uint32_t>(lround(sqrt(slice_count))));
+
+        for (uint32_t i = 0; i < slice_count; i += stride)
+        {
+            order.push_back(i);
+        }
+
+        for (uint32_t i = 0; i < slice_count; i++)
+        {
+            if (i % stride)
+            {
+                order.push_back(i);
+            }
+        }
+    }
+    else
+    {
+        for (uint32_t i = 0; i < slice_count; i++)
+        {
+            order.push_back(i);
+        }
+    }
+
+    return order;
+}
+
+std::vector<float> sdr::SampleThread::getWindow(size_t vector_length)
+{
+    static std::mutex windows_lock;
+    static std::map<size_t, std::vector<float>> windows;
+
+    std::lock_guard<std::mutex> guard(windows_lock);
+
+    auto window = windows.find(vector_length);
+    if (window == windows.end())
+    {
+        window = windows.emplace(vector_length, gr::filter::firdes::window(gr::filter::firdes::WIN_BLACKMAN_HARRIS, vector_length /* # taps */, 6.67)).first;
+    }
+
+    return window->second;
+}
+
 bool sdr::SampleThread::stop()
 {
     bool stopped = false;
@@ -83,19 +440,26 @@ void sdr::SampleThread::operator()()
 {
     std::cout << "Starting sample thread on " << start_freq_hz_ << "Hz (sample rate: " << sample_rate_hz_ << "Hz, gain: " << config_->getGain() << "dB)" << std::endl;
 
+    applySchedulingPolicy();
+
     size_t vector_length = samples_->getFFTSize();
     uint64_t total_bw_hz = (end_freq_hz_ - start_freq_hz_) + 1;
 
+    // With a zoom FFT each FFT covers a decimated slice of the capture bandwidth
+    uint32_t decimation = samples_->getDecimation();
+    double fft_rate_hz = sample_rate_hz_ / static_cast<double>(decimation);
+
+    stats_.setExpectedVectorRate(static_cast<float>(fft_rate_hz / vector_length));
+
     gr::top_block_sptr top_block;
+    gr::basic_block_sptr src;
     osmosdr::source::sptr hardware_src;
+    gr::filter::freq_xlating_fir_filter_ccf::sptr zoom_filter;
     gr::blocks::stream_to_vector::sptr stream_to_vec;
-    gr::fft::fft_vcc::sptr fft;
-    gr::blocks::complex_to_mag_squared::sptr complex_to_mag2;
-    gr::filter::single_pole_iir_filter_ff::sptr iir;
-    gr::blocks::nlog10_ff::sptr vector_log;
+    FftFanoutBlock::sptr fft;
     VectorSinkBlock::sptr vector_sink;
 
-    std::vector<float> blackman_window = gr::filter::firdes::window(gr::filter::firdes::WIN_BLACKMAN_HARRIS, vector_length /* # taps */, 6.67);
+    std::vector<float> blackman_window = getWindow(vector_length);
 
     char top_block_name[64], vector_sink_name[64];
     snprintf(top_block_name, sizeof(top_block_name), "spectrum%lu", start_freq_hz_);
@@ -103,121 +467,306 @@ void sdr::SampleThread::operator()()
 
     top_block = gr::make_top_block(top_block_name);
 
-    char hardware_src_name[64];
-    snprintf(hardware_src_name, sizeof(hardware_src_name), "%s=%u", device_type_.c_str(), device_id_);
-    hardware_src = osmosdr::source::make(hardware_src_name);
+    if (device_type_ == SYNTHETIC_DEVICE_PREFIX)
+    {
+        // A single carrier over a noise floor, throttled to the sample rate a real device would deliver
+        gr::analog::sig_source_c::sptr carrier = gr::analog::sig_source_c::make(sample_rate_hz_, gr::analog::GR_COS_WAVE, sample_rate_hz_ / 8.0, 0.5);
+        gr::analog::noise_source_c::sptr noise = gr::analog::noise_source_c::make(gr::analog::GR_GAUSSIAN, 0.01);
+        gr::blocks::add_cc::sptr adder = gr::blocks::add_cc::make();
+        gr::blocks::throttle::sptr throttle = gr::blocks::throttle::make(sizeof(gr_complex), sample_rate_hz_);
 
-    hardware_src->set_sample_rate(sample_rate_hz_);
-//    hardware_src->set_center_freq(start_freq_hz_);
-    hardware_src->set_freq_corr(0.0);
-    hardware_src->set_gain_mode(config_->getAgc());
-    hardware_src->set_gain(config_->getGain());
-    hardware_src->set_dc_offset_mode(config_->getDcSpikeRemoval() ? 2 : 0);
-//  hardware_src->set_if_gain(20);
+        top_block->connect(carrier, 0, adder, 0);
+        top_block->connect(noise, 0, adder, 1);
+        top_block->connect(adder, 0, throttle, 0);
 
-    float window_power = 0.0f;
-    for (float tap : blackman_window)
+        src = throttle;
+    }
+    else
     {
-        window_power += tap*tap;
+        char hardware_src_name[64];
+        snprintf(hardware_src_name, sizeof(hardware_src_name), "%s=%u", device_type_.c_str(), device_id_);
+        hardware_src = osmosdr::source::make(hardware_src_name);
+
+        hardware_src->set_sample_rate(sample_rate_hz_);
+//      hardware_src->set_center_freq(start_freq_hz_);
+        hardware_src->set_freq_corr(0.0);
+        hardware_src->set_gain_mode(config_->getAgc());
+        hardware_src->set_gain(config_->getGain());
+        hardware_src->set_dc_offset_mode(config_->getDcSpikeRemoval() ? 2 : 0);
+//      hardware_src->set_if_gain(20);
+
+        src = hardware_src;
     }
 
+    markStartupStage(startup_timings_.open_device_ms_);
+
     stream_to_vec = gr::blocks::stream_to_vector::make(sizeof(gr_complex), vector_length);
-    fft = gr::fft::fft_vcc::make(vector_length, true, blackman_window, true);
-    complex_to_mag2 = gr::blocks::complex_to_mag_squared::make(vector_length);
-    iir = gr::filter::single_pole_iir_filter_ff::make(1.0, vector_length);
-    vector_log = gr::blocks::nlog10_ff::make(10, vector_length, -20 * log10(vector_length) - 10 * log10(window_power / vector_length));
-    vector_sink = VectorSinkBlock::make(vector_sink_name, vector_length, samples_->getBinBandwidth(), samples_);
+    fft = FftFanoutBlock::make(vector_length, blackman_window, config_->getFftThreads());
+    vector_sink = VectorSinkBlock::make(vector_sink_name, vector_length, samples_->getBinBandwidth(), samples_, &stats_, fft_rate_hz / vector_length);
+
+    if (decimation > 1)
+    {
+        // The device is tuned a quarter of its bandwidth below the span (keeping the span clear of its DC spike), the
+        // filter shifts the span back to baseband and low pass filters it before decimating.
+        std::vector<float> zoom_taps = gr::filter::firdes::low_pass(1.0, sample_rate_hz_, fft_rate_hz * 0.4, fft_rate_hz * 0.1);
+        zoom_filter = gr::filter::freq_xlating_fir_filter_ccf::make(decimation, zoom_taps, sample_rate_hz_ / 4.0, sample_rate_hz_);
+
+        top_block->connect(src, 0, zoom_filter, 0);
+        top_block->connect(zoom_filter, 0, stream_to_vec, 0);
+
+        std::cout << "Sample thread on " << start_freq_hz_ << "Hz is decimating by " << decimation << " (" << zoom_taps.size() << " taps)" << std::endl;
+    }
+    else
+    {
+        top_block->connect(src, 0, stream_to_vec, 0);
+    }
+
+    // The tap takes the raw IQ (ahead of any decimation) alongside the FFT path rather than in front of it
+    IqTapBlock::sptr iq_tap;
+    if (iq_writer_)
+    {
+        char iq_tap_name[64];
+        snprintf(iq_tap_name, sizeof(iq_tap_name), "iq_tap%lu", start_freq_hz_);
+
+        iq_tap = IqTapBlock::make(iq_tap_name, (sample_rate_hz_ * IQ_PRE_TRIGGER_MS) / 1000, (sample_rate_hz_ * IQ_POST_TRIGGER_MS) / 1000);
+        top_block->connect(src, 0, iq_tap, 0);
+    }
+
+    // Also alongside the FFT path, so that a slow disk drops recorded samples rather than holding back the FFT
+    IqRecorder* iq_recorder = nullptr;
+    if ( ! config_->getIqRecordDirectory().empty())
+    {
+        iq_recorder = new IqRecorder(config_->getIqRecordDirectory(), device_id_, sample_rate_hz_, &stats_);
+
+        if (iq_recorder->isOpen())
+        {
+            char iq_recorder_name[64];
+            snprintf(iq_recorder_name, sizeof(iq_recorder_name), "iq_recorder%lu", start_freq_hz_);
+
+            top_block->connect(src, 0, IqRecorderBlock::make(iq_recorder_name, iq_recorder), 0);
+        }
+        else
+        {
+            // The recorder has already said why, the device carries on without recording
+            delete iq_recorder;
+            iq_recorder = nullptr;
+        }
+    }
 
-    top_block->connect(hardware_src, 0, stream_to_vec, 0);
     top_block->connect(stream_to_vec, 0, fft, 0);
-    top_block->connect(fft, 0, complex_to_mag2, 0);
-    top_block->connect(complex_to_mag2, 0, iir, 0);
-    top_block->connect(iir, 0, vector_log, 0);
-    top_block->connect(vector_log, 0, vector_sink, 0);
+    top_block->connect(fft, 0, vector_sink, 0);
+
+    // The block threads inherit this thread's affinity, setting it on the blocks too has GNU Radio apply it to each of them
+    std::vector<int> cores = config_->getDeviceCores(device_id_);
+    if ( ! cores.empty())
+    {
+        top_block->set_processor_affinity(cores);
+    }
+
+    markStartupStage(startup_timings_.build_flowgraph_ms_);
+
+    // Only the flowgraph's threads (started by start(), which inherit this thread's policy) run at the real-time
+    // priority, this thread just retunes and polls so it goes back to SCHED_OTHER once they're running
+    bool realtime = setRealtimePriority(true);
 
+    // GNU Radio's FFT blocks load (and save) FFTW wisdom from ~/.gr_fftw_wisdom, so planning is only slow on the first run
     top_block->start();
+    if (realtime)
+    {
+        setRealtimePriority(false);
+    }
 
-    uint64_t tune_freq_hz = start_freq_hz_;
-    uint64_t end_slice_freq_hz;
-    uint32_t slice_id = 0;
+    markStartupStage(startup_timings_.start_flowgraph_ms_);
+
+    // Each sweep visits every slice once, in the configured order
+    std::vector<Slice> slices = planSlices();
+    std::vector<uint32_t> slice_order = orderSlices(static_cast<uint32_t>(slices.size()), config_->getSliceOrder());
+    uint32_t slice_position = 0;            // index into slice_order of the next slice to tune to
+    Slice* slice = nullptr;
     bool retune = true;
 
-    while ( ! stop_)
+    sweep_started_at_ = std::chrono::high_resolution_clock::now();
+
+    // Slices only use the middle 2/3 of the FFT (see below), if the whole range fits in that the device can stay tuned
+    // to its center and stream continuously, with no retune gaps. Zoomed spans always fit, and must be single tuned as
+    // the zoom filter's quarter sample rate offset is only applied to the single tune frequency.
+    uint64_t single_tune_freq_hz = start_freq_hz_ + (total_bw_hz / 2);
+    uint64_t fft_half_bw_hz = static_cast<uint64_t>(fft_rate_hz / 2);
+    bool single_tune = (decimation > 1) || ((total_bw_hz <= (fft_rate_hz * 2) / 3) && (single_tune_freq_hz >= fft_half_bw_hz));
+    assert(decimation == 1 || (total_bw_hz <= fft_rate_hz && single_tune_freq_hz >= sample_rate_hz_ / 4));
+    uint64_t sweep_started_at_vector = 0;
+
+    uint32_t first_sweep_dwell_time_us = static_cast<uint32_t>((FIRST_SWEEP_VECTORS * vector_length * 1000000.0) / fft_rate_hz);
+    uint32_t retune_discard_vectors = std::max<uint32_t>(1, static_cast<uint32_t>(ceil((RETUNE_SETTLE_MS * fft_rate_hz) / (1000.0 * vector_length))));
+    uint32_t retune_settle_us = static_cast<uint32_t>((retune_discard_vectors * vector_length * 1000000.0) / fft_rate_hz);
+    uint64_t retune_settle_samples = (static_cast<uint64_t>(retune_settle_us) * sample_rate_hz_) / 1000000;
+    uint64_t slice_started_at_vector = 0;   // vectors saved when the current slice was tuned to
+
+    uint64_t single_tune_hardware_freq_hz = (decimation > 1) ? single_tune_freq_hz - (sample_rate_hz_ / 4) : single_tune_freq_hz;
+
+    if (single_tune)
     {
-        if (retune)
+        if (hardware_src)
         {
-            // The FFT straddles the center tuning frequency
-            uint64_t start_fft_freq_hz = static_cast<uint64_t>(tune_freq_hz - (sample_rate_hz_ / 2.0));  // TODO: watch for underrun
-            uint64_t end_fft_freq_hz = static_cast<uint64_t>(tune_freq_hz + (sample_rate_hz_ / 2.0));
+            uint64_t hardware_freq_hz = single_tune_hardware_freq_hz;
 
-            // But we ignore out-of-range portions on the first and last slice, and the bottom and top ends of the
-            // FFT on intermediate slices (the SDR tested with often has aliases around these areas).
-            uint64_t start_slice_freq_hz;
-            uint64_t new_end_slice_freq_hz;
+            double tuned_freq_hz = hardware_src->set_center_freq(hardware_freq_hz);
+            assert(fabs(tuned_freq_hz - hardware_freq_hz) <= TUNING_TOLERANCE);
+        }
 
-            if (start_fft_freq_hz < start_freq_hz_)     // first slice
-            {
-                start_slice_freq_hz = start_freq_hz_;
-            }
-            else                                        // intermediate slice
+        if (iq_recorder)
+        {
+            iq_recorder->markRetune(single_tune_hardware_freq_hz);
+        }
+
+        if (iq_tap)
+        {
+            iq_tap->markRetune(retune_settle_samples);
+        }
+
+        vector_sink->setCurrentFrequencyRange(single_tune_freq_hz - fft_half_bw_hz, start_freq_hz_, end_freq_hz_, retune_discard_vectors);
+
+        std::cout << "Sample thread on " << start_freq_hz_ << "Hz is tuned once to " << single_tune_freq_hz << "Hz" << std::endl;
+    }
+
+    while ( ! stop_)
+    {
+        if (settings_changed_.exchange(false, std::memory_order_acquire))
+        {
+            dwell_time_us_ = config_->getDwellTime();
+
+            if (hardware_src)
             {
-                start_slice_freq_hz = start_fft_freq_hz + static_cast<uint64_t>(sample_rate_hz_ / 6.0);
+                hardware_src->set_gain_mode(config_->getAgc());
+                hardware_src->set_gain(config_->getGain());
+                hardware_src->set_dc_offset_mode(config_->getDcSpikeRemoval() ? 2 : 0);
             }
 
-            if (end_fft_freq_hz > end_freq_hz_)         // last slice
+            std::cout << "Sample thread on " << start_freq_hz_ << "Hz now using gain: " << config_->getGain() << "dB, agc: " << config_->getAgc() << ", despike: " << config_->getDcSpikeRemoval() << ", dwell: " << dwell_time_us_ << "us" << std::endl;
+        }
+
+        if (single_tune)
+        {
+            // A sweep is a dwell's worth of vectors, the sink keeps saving while the slice is published
+            uint32_t dwell_time_us = (sweep_count_ == 0) ? std::min(dwell_time_us_, first_sweep_dwell_time_us) : dwell_time_us_;
+            uint64_t vectors_per_sweep = std::max<uint64_t>(1, (dwell_time_us * fft_rate_hz) / (1000000.0 * vector_length));
+            uint64_t vectors_saved = vector_sink->getVectorsSaved();
+
+            if (iq_tap)
             {
-                new_end_slice_freq_hz = end_freq_hz_;
+                checkIqTrigger(iq_tap.get(), vectors_saved > 0, single_tune_hardware_freq_hz, start_freq_hz_, end_freq_hz_);
             }
-            else                                        // intermediate slice
+
+            if (vectors_saved - sweep_started_at_vector < vectors_per_sweep)
             {
-                new_end_slice_freq_hz = end_fft_freq_hz - static_cast<uint64_t>(sample_rate_hz_ / 6.0);
+                usleep(SINGLE_TUNE_POLL_INTERVAL_US);
+                continue;
             }
 
-//          std::cout << "Proposed Slice: " << slice_id << ", tuned to " << tune_freq_hz << "Hz (FFT: " << start_fft_freq_hz << ", " << end_fft_freq_hz << ") (Slice: " << start_slice_freq_hz << ", " << new_end_slice_freq_hz << ")" << std::endl;
+            samples_->publishSlice(start_freq_hz_, end_freq_hz_, sweep_count_);
+            recordSliceCapture(vector_sink.get(), start_freq_hz_, end_freq_hz_);
 
-            if (start_slice_freq_hz > end_freq_hz_)
+            auto t_now = std::chrono::high_resolution_clock::now();
+            stats_.recordSweep(std::chrono::duration_cast<std::chrono::milliseconds>(t_now - sweep_started_at_).count(), 1);
+            markStartupStage(startup_timings_.first_sweep_ms_);
+            sweep_started_at_ = t_now;
+            sweep_started_at_vector = vectors_saved;
+
+            sweep_count_++;
+            vector_sink->setSweepCount(sweep_count_);
+            samples_->completeSweep(device_id_, sweep_count_);
+
+            continue;
+        }
+
+        if (retune)
+        {
+            if (slice_position >= slice_order.size())
             {
-                tune_freq_hz = start_freq_hz_;
-                slice_id = 0;
+                auto t_now = std::chrono::high_resolution_clock::now();
+                stats_.recordSweep(std::chrono::duration_cast<std::chrono::milliseconds>(t_now - sweep_started_at_).count(), slice_position);
+                markStartupStage(startup_timings_.first_sweep_ms_);
+                sweep_started_at_ = t_now;
+
+                slice_position = 0;
                 sweep_count_++;
 
                 vector_sink->setSweepCount(sweep_count_);
+                samples_->completeSweep(device_id_, sweep_count_);
 
                 continue;
             }
 
-            // Ensure ignoring the bottom and top ends doesn't create "gaps" that don't get scanned.
-            assert(slice_id == 0 || (start_slice_freq_hz <= end_slice_freq_hz));
-            end_slice_freq_hz = new_end_slice_freq_hz;
+            slice = &slices[slice_order[slice_position]];
+
+            if (hardware_src)
+            {
+                auto t_start = std::chrono::high_resolution_clock::now();
+                double tuned_freq_hz = hardware_src->set_center_freq(slice->tune_freq_hz_);
+                stats_.recordRetune(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - t_start).count());
+
+                assert(fabs(tuned_freq_hz - slice->tune_freq_hz_) <= TUNING_TOLERANCE);
+            }
 
-//          std::cout << "Slice: " << slice_id << ", tuned to " << tune_freq_hz << "Hz (FFT: " << start_fft_freq_hz << ", " << end_fft_freq_hz << ") (Slice: " << start_slice_freq_hz << ", " << end_slice_freq_hz << ")" << std::endl;
+            // Samples already in the flowgraph's buffers are from before the retune, so the segment can start a
+            // little early
+            if (iq_recorder)
+            {
+                iq_recorder->markRetune(slice->tune_freq_hz_);
+            }
 
-            double tuned_freq_hz = hardware_src->set_center_freq(tune_freq_hz);
-            assert(fabs(tuned_freq_hz - tune_freq_hz) <= TUNING_TOLERANCE);
+            if (iq_tap)
+            {
+                iq_tap->markRetune(retune_settle_samples);
+            }
 
-            vector_sink->setCurrentFrequencyRange(start_fft_freq_hz, start_slice_freq_hz, end_slice_freq_hz);
+            slice_started_at_vector = vector_sink->getVectorsSaved();
+            vector_sink->setCurrentFrequencyRange(slice->start_fft_freq_hz_, slice->start_slice_freq_hz_, slice->end_slice_freq_hz_, retune_discard_vectors);
             last_retuned_at_ = std::chrono::high_resolution_clock::now();
 
             retune = false;
-            slice_id++;
+            slice_position++;
+        }
+
+        if (iq_tap)
+        {
+            bool slice_written = vector_sink->getVectorsSaved() > slice_started_at_vector;
+            checkIqTrigger(iq_tap.get(), slice_written, slice->tune_freq_hz_, slice->start_slice_freq_hz_, slice->end_slice_freq_hz_);
         }
 
         // If our dwell time has elapsed, it's time to retune
         auto t_now = std::chrono::high_resolution_clock::now();
         float secs_since_last_retune = std::chrono::duration_cast<std::chrono::duration<float>>(t_now - last_retuned_at_).count();
 
-        if ((secs_since_last_retune * 1000000) > dwell_time_us_)
+        uint32_t dwell_time_us = ((sweep_count_ == 0) ? std::min(dwell_time_us_, first_sweep_dwell_time_us) : dwell_time_us_) + retune_settle_us;
+
+        // Stay on the slice until any IQ capture from it is complete
+        if ((secs_since_last_retune * 1000000) > dwell_time_us && ! (iq_tap && iq_tap->isCapturing()))
         {
             vector_sink->setSaveSamples(false);             // don't update data while retuning
+            samples_->publishSlice(slice->start_slice_freq_hz_, slice->end_slice_freq_hz_, sweep_count_);
+            recordSliceCapture(vector_sink.get(), slice->start_slice_freq_hz_, slice->end_slice_freq_hz_);
 
-            tune_freq_hz += sample_rate_hz_ / 2.0;
             retune = true;
         }
+        else
+        {
+            // Sleep until the dwell is over, waking at least every IQ trigger check so triggers and stop() aren't missed
+            uint64_t elapsed_us = static_cast<uint64_t>(secs_since_last_retune * 1000000);
+            uint64_t remaining_us = (elapsed_us < dwell_time_us) ? dwell_time_us - elapsed_us : 0;
+            usleep(std::max<uint64_t>(SINGLE_TUNE_POLL_INTERVAL_US, std::min<uint64_t>(remaining_us, IQ_TRIGGER_CHECK_INTERVAL_MS * 1000)));
+        }
     }
 
     top_block->stop();
     top_block->wait();
 
+    // Only once nothing else can be appended
+    if (iq_recorder)
+    {
+        delete iq_recorder;
+    }
+
     std::cout << "Sample thread on " << start_freq_hz_ << "Hz is exiting" << std::endl;
 }
 
@@ -2,26 +2,97 @@
 #define WAVEGUIDE_SDR_SAMPLETHREAD_H
 
 #include <thread>
+#include <atomic>
+#include <mutex>
 #include <string>
+#include <vector>
 #include <chrono>
 #include <cstdint>
 
 #include "SpectrumSamples.h"
+#include "SamplerStats.h"
+#include "IqCaptureWriter.h"
 
 class Config;
 
 namespace sdr {
 
+    class VectorSinkBlock;
+    class IqTapBlock;
+
     class SampleThread {
     public:
-        SampleThread(Config* config, uint8_t device_id, uint64_t start_freq_hz, uint64_t end_freq_hz, SpectrumSamples* samples_);
+        // How long (in msec since start()) each stage of starting up took, or -1 if it hasn't finished yet.
+        typedef struct
+        {
+            double open_device_ms_;
+            double build_flowgraph_ms_;
+            double start_flowgraph_ms_;         // the device is streaming (ie. ready)
+            double first_sweep_ms_;
+        } StartupTimings;
+
+        // Raw IQ is captured around triggers when iq_writer is given.
+        SampleThread(Config* config, uint8_t device_id, uint64_t start_freq_hz, uint64_t end_freq_hz, SpectrumSamples* samples_,
+                     IqCaptureWriter* iq_writer = nullptr);
         ~SampleThread();
 
         void operator()();
         bool start();
         bool stop();
 
+        SamplerStats* getStats();
+
+        // Signals that the capture settings (gain, AGC, DC spike removal, dwell) in Config have changed. The sampling
+        // loop re-reads and applies them to the running device without stopping the flowgraph.
+        void updateSettings();
+
+        // Captures raw IQ from the slice currently being sampled (if IQ capture is enabled), as if a bin had triggered it.
+        void triggerIqCapture();
+
+        StartupTimings getStartupTimings();
+
+        // Gets the FFT window for vector_length bins, which is calculated once and shared by every thread (and by
+        // offline analysis, so that its spectra match).
+        static std::vector<float> getWindow(size_t vector_length);
+
     private:
+        // A slice is the portion of the range covered while tuned to one center frequency.
+        typedef struct
+        {
+            uint64_t tune_freq_hz_;
+            uint64_t start_fft_freq_hz_;                // the FFT runs from this frequency to this + sample rate
+            uint64_t start_slice_freq_hz_;              // but only bins from here
+            uint64_t end_slice_freq_hz_;                // to here are sampled
+        } Slice;
+
+        // Splits start_freq_hz_ to end_freq_hz_ into slices, from low to high.
+        std::vector<Slice> planSlices();
+
+        // Gets the order to visit slice_count slices in during each sweep (every slice is visited exactly once), see
+        // Config::getSliceOrder().
+        static std::vector<uint32_t> orderSlices(uint32_t slice_count, const std::string& slice_order);
+
+        // Records that the startup stage timed by timing has finished.
+        void markStartupStage(double& timing);
+
+        // Pins the calling thread to the device's cores (if configured). Threads started afterwards, including the
+        // flowgraph's, inherit it.
+        void applySchedulingPolicy();
+
+        // Moves the calling thread to SCHED_FIFO at the configured priority, or back to SCHED_OTHER. Returns false if
+        // no priority is configured or the policy couldn't be changed.
+        bool setRealtimePriority(bool realtime);
+
+        // Stores when the vectors saved for the slice from start_freq_hz to end_freq_hz were captured, converted to
+        // CLOCK_REALTIME.
+        void recordSliceCapture(VectorSinkBlock* vector_sink, uint64_t start_freq_hz, uint64_t end_freq_hz);
+
+        // Hands the tap's finished capture to iq_writer_, then triggers an IQ capture if a bin from start_freq_hz to
+        // end_freq_hz is above the trigger SNR (or a capture was requested), checked at most every
+        // IQ_TRIGGER_CHECK_INTERVAL_MS. Nothing is checked until slice_written (the sink has saved vectors since the
+        // slice was tuned to) and the tap's ring holds only samples from this tuning.
+        void checkIqTrigger(IqTapBlock* iq_tap, bool slice_written, uint64_t center_freq_hz, uint64_t start_freq_hz, uint64_t end_freq_hz);
+
         std::thread* thread_;
         Config* config_;
         SpectrumSamples* samples_;
@@ -36,6 +107,23 @@ namespace sdr {
 
         uint32_t dwell_time_us_;                    // how long to dwell on each tuned center freq (split into n FFT iterations)
         std::chrono::high_resolution_clock::time_point last_retuned_at_;
+        std::chrono::high_resolution_clock::time_point sweep_started_at_;
+
+        SamplerStats stats_;
+
+        bool has_device_clock_offset_;
+        int64_t device_clock_offset_ns_;            // CLOCK_REALTIME minus the device's clock, for its rx_time capture times
+
+        std::atomic<bool> settings_changed_;
+
+        IqCaptureWriter* iq_writer_;
+        std::atomic<bool> iq_trigger_requested_;
+        std::chrono::steady_clock::time_point iq_checked_at_;
+        std::chrono::steady_clock::time_point iq_triggered_at_;
+
+        std::chrono::steady_clock::time_point started_at_;
+        StartupTimings startup_timings_;
+        std::mutex startup_lock_;                   // guards startup_timings_
 
         bool stop_;
     };
@@ -0,0 +1,256 @@
+#include "SamplerStats.h"
+
+#include <cstdio>
+#include <algorithm>
+
+// Deliveries can lag the sample rate by this long without anything being lost, as the flowgraph buffers hold it.
+#define OVERFLOW_BUFFERED_SECS 0.5f
+
+sdr::StatsHistogram::StatsHistogram()
+{
+    for (uint32_t i = 0; i < BUCKET_COUNT; i++)
+    {
+        buckets_[i] = 0;
+    }
+
+    count_ = 0;
+    sum_ = 0;
+    maximum_ = 0;
+}
+
+void sdr::StatsHistogram::record(uint64_t value)
+{
+    uint32_t bucket = (value == 0) ? 0 : static_cast<uint32_t>(64 - __builtin_clzll(value));
+    if (bucket >= BUCKET_COUNT)
+    {
+        bucket = BUCKET_COUNT - 1;
+    }
+
+    buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+
+    uint64_t maximum = maximum_.load(std::memory_order_relaxed);
+    while (value > maximum && ! maximum_.compare_exchange_weak(maximum, value, std::memory_order_relaxed))
+    {
+    }
+}
+
+uint64_t sdr::StatsHistogram::getCount()
+{
+    return count_.load(std::memory_order_relaxed);
+}
+
+uint64_t sdr::StatsHistogram::getMean()
+{
+    uint64_t count = getCount();
+
+    return count ? sum_.load(std::memory_order_relaxed) / count : 0;
+}
+
+uint64_t sdr::StatsHistogram::getMaximum()
+{
+    return maximum_.load(std::memory_order_relaxed);
+}
+
+uint64_t sdr::StatsHistogram::getPercentile(float percentile)
+{
+    uint64_t count = getCount();
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    uint64_t target = static_cast<uint64_t>(count * percentile);
+    uint64_t seen = 0;
+
+    for (uint32_t i = 0; i < BUCKET_COUNT; i++)
+    {
+        seen += buckets_[i].load(std::memory_order_relaxed);
+        if (seen > target)
+        {
+            return (i == 0) ? 0 : (1ull << i) - 1;
+        }
+    }
+
+    return getMaximum();
+}
+
+sdr::SamplerStats::SamplerStats()
+{
+    vectors_received_ = 0;
+    vectors_discarded_ = 0;
+
+    last_vectors_received_ = 0;
+    last_rate_update_at_ = std::chrono::steady_clock::now();
+    vectors_per_sec_ = 0.0f;
+
+    expected_vectors_per_sec_ = 0.0f;
+    vectors_behind_ = 0.0f;
+    vectors_lost_ = 0;
+
+    iq_bytes_written_ = 0;
+    iq_samples_dropped_ = 0;
+    iq_stalls_ = 0;
+}
+
+void sdr::SamplerStats::addVectors(uint64_t count, bool saved)
+{
+    vectors_received_.fetch_add(count, std::memory_order_relaxed);
+
+    if ( ! saved)
+    {
+        vectors_discarded_.fetch_add(count, std::memory_order_relaxed);
+    }
+}
+
+void sdr::SamplerStats::recordRetune(uint64_t latency_us)
+{
+    retune_latency_us_.record(latency_us);
+}
+
+void sdr::SamplerStats::recordSweep(uint64_t duration_ms, uint32_t slice_count)
+{
+    sweep_duration_ms_.record(duration_ms);
+    slices_per_sweep_.record(slice_count);
+}
+
+void sdr::SamplerStats::recordLockWait(uint64_t wait_ns)
+{
+    lock_wait_ns_.record(wait_ns);
+}
+
+void sdr::SamplerStats::addIqWritten(uint64_t bytes, uint64_t write_us)
+{
+    iq_bytes_written_.fetch_add(bytes, std::memory_order_relaxed);
+    iq_write_latency_us_.record(write_us);
+}
+
+void sdr::SamplerStats::addIqDropped(uint64_t samples, bool stalled)
+{
+    iq_samples_dropped_.fetch_add(samples, std::memory_order_relaxed);
+
+    if (stalled)
+    {
+        iq_stalls_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void sdr::SamplerStats::setExpectedVectorRate(float vectors_per_sec)
+{
+    expected_vectors_per_sec_.store(vectors_per_sec, std::memory_order_relaxed);
+}
+
+void sdr::SamplerStats::updateRates()
+{
+    auto t_now = std::chrono::steady_clock::now();
+    float secs = std::chrono::duration_cast<std::chrono::duration<float>>(t_now - last_rate_update_at_).count();
+
+    if (secs <= 0.0f)
+    {
+        return;
+    }
+
+    uint64_t vectors_received = getVectorsReceived();
+
+    vectors_per_sec_.store((vectors_received - last_vectors_received_) / secs, std::memory_order_relaxed);
+
+    // Devices don't report their overflows, so they're estimated from how far deliveries have fallen behind the sample
+    // rate. Nothing is expected until the first vectors arrive (the flowgraph is still starting).
+    float expected_vectors_per_sec = expected_vectors_per_sec_.load(std::memory_order_relaxed);
+    if (expected_vectors_per_sec > 0.0f && last_vectors_received_)
+    {
+        vectors_behind_ = std::max(0.0f, vectors_behind_ + (expected_vectors_per_sec * secs) - (vectors_received - last_vectors_received_));
+
+        float vectors_lost = vectors_behind_ - (expected_vectors_per_sec * OVERFLOW_BUFFERED_SECS);
+        if (vectors_lost > vectors_lost_.load(std::memory_order_relaxed))
+        {
+            vectors_lost_.store(static_cast<uint64_t>(vectors_lost), std::memory_order_relaxed);
+        }
+    }
+
+    last_vectors_received_ = vectors_received;
+    last_rate_update_at_ = t_now;
+}
+
+uint64_t sdr::SamplerStats::getVectorsReceived()
+{
+    return vectors_received_.load(std::memory_order_relaxed);
+}
+
+uint64_t sdr::SamplerStats::getVectorsDiscarded()
+{
+    return vectors_discarded_.load(std::memory_order_relaxed);
+}
+
+float sdr::SamplerStats::getVectorsPerSecond()
+{
+    return vectors_per_sec_.load(std::memory_order_relaxed);
+}
+
+uint64_t sdr::SamplerStats::getVectorsLost()
+{
+    return vectors_lost_.load(std::memory_order_relaxed);
+}
+
+uint64_t sdr::SamplerStats::getIqBytesWritten()
+{
+    return iq_bytes_written_.load(std::memory_order_relaxed);
+}
+
+uint64_t sdr::SamplerStats::getIqSamplesDropped()
+{
+    return iq_samples_dropped_.load(std::memory_order_relaxed);
+}
+
+uint64_t sdr::SamplerStats::getIqStalls()
+{
+    return iq_stalls_.load(std::memory_order_relaxed);
+}
+
+sdr::StatsHistogram& sdr::SamplerStats::getRetuneLatency()
+{
+    return retune_latency_us_;
+}
+
+sdr::StatsHistogram& sdr::SamplerStats::getSweepDuration()
+{
+    return sweep_duration_ms_;
+}
+
+sdr::StatsHistogram& sdr::SamplerStats::getSlicesPerSweep()
+{
+    return slices_per_sweep_;
+}
+
+sdr::StatsHistogram& sdr::SamplerStats::getLockWaits()
+{
+    return lock_wait_ns_;
+}
+
+sdr::StatsHistogram& sdr::SamplerStats::getIqWriteLatency()
+{
+    return iq_write_latency_us_;
+}
+
+std::string sdr::SamplerStats::describe()
+{
+    char msg[256];
+    snprintf(msg, sizeof(msg), "vectors: %lu (%.0f/s, %lu dropped, ~%lu lost), retune: p50 %luus p99 %luus, sweep: %lums (%lu slices), lock waits: %lu (max %luns)",
+             getVectorsReceived(), getVectorsPerSecond(), getVectorsDiscarded(), getVectorsLost(),
+             retune_latency_us_.getPercentile(0.5f), retune_latency_us_.getPercentile(0.99f),
+             sweep_duration_ms_.getMean(), slices_per_sweep_.getMean(),
+             lock_wait_ns_.getCount(), lock_wait_ns_.getMaximum());
+
+    std::string description(msg);
+
+    // Only while recording IQ
+    if (iq_write_latency_us_.getCount())
+    {
+        snprintf(msg, sizeof(msg), ", iq: %luMB written (p99 %luus), %lu stalls, %lu samples dropped",
+                 getIqBytesWritten() / (1024 * 1024), iq_write_latency_us_.getPercentile(0.99f), getIqStalls(), getIqSamplesDropped());
+        description += msg;
+    }
+
+    return description;
+}
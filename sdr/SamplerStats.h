@@ -0,0 +1,104 @@
+#ifndef WAVEGUIDE_SDR_SAMPLERSTATS_H
+#define WAVEGUIDE_SDR_SAMPLERSTATS_H
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <cstdint>
+
+namespace sdr {
+
+    // Histogram with power of two buckets (bucket n counts values in [2^(n-1), 2^n)), cheap enough to record into from
+    // the sampling hot path. Percentiles are approximate, reported as the upper bound of the bucket they fall into.
+    class StatsHistogram {
+    public:
+        StatsHistogram();
+
+        void record(uint64_t value);
+
+        uint64_t getCount();
+        uint64_t getMean();
+        uint64_t getMaximum();
+        uint64_t getPercentile(float percentile);
+
+        static const uint32_t BUCKET_COUNT = 64;
+
+    private:
+        std::atomic<uint64_t> buckets_[BUCKET_COUNT];
+        std::atomic<uint64_t> count_;
+        std::atomic<uint64_t> sum_;
+        std::atomic<uint64_t> maximum_;
+    };
+
+    // Telemetry for a single sdr::SampleThread and its VectorSinkBlock. Every update is a relaxed atomic so that the
+    // GNU Radio and sampler threads never block on (or order against) readers of the statistics.
+    class SamplerStats {
+    public:
+        SamplerStats();
+
+        // Counts vectors delivered to the VectorSinkBlock, saved is false when they arrived mid-retune and were dropped.
+        void addVectors(uint64_t count, bool saved);
+
+        void recordRetune(uint64_t latency_us);
+        void recordSweep(uint64_t duration_ms, uint32_t slice_count);
+        void recordLockWait(uint64_t wait_ns);
+
+        // Counts raw IQ written by an IqRecorder, samples it had to drop because every buffer was still waiting on the
+        // disk, and how often it ran out of buffers (each stall drops samples until a buffer is free again).
+        void addIqWritten(uint64_t bytes, uint64_t write_us);
+        void addIqDropped(uint64_t samples, bool stalled);
+
+        // The rate vectors should arrive at if no samples are lost, used to estimate overflows (0 disables the estimate).
+        void setExpectedVectorRate(float vectors_per_sec);
+
+        // Recalculates the vector rate from the counts since the last call (called periodically by SpectrumSampler).
+        void updateRates();
+
+        uint64_t getVectorsReceived();
+        uint64_t getVectorsDiscarded();
+        float getVectorsPerSecond();
+
+        // Estimated number of vectors lost to overflows, ie. how far deliveries have fallen behind the expected rate
+        // (beyond what the flowgraph buffers could be holding).
+        uint64_t getVectorsLost();
+
+        uint64_t getIqBytesWritten();
+        uint64_t getIqSamplesDropped();
+        uint64_t getIqStalls();
+
+        StatsHistogram& getRetuneLatency();
+        StatsHistogram& getSweepDuration();
+        StatsHistogram& getSlicesPerSweep();
+        StatsHistogram& getLockWaits();
+        StatsHistogram& getIqWriteLatency();
+
+        // Single line summary used by the stats overlay and stats file.
+        std::string describe();
+
+    private:
+        std::atomic<uint64_t> vectors_received_;
+        std::atomic<uint64_t> vectors_discarded_;      // received while save_samples_ was false (ie. while retuning)
+
+        StatsHistogram retune_latency_us_;              // time spent in set_center_freq()
+        StatsHistogram sweep_duration_ms_;
+        StatsHistogram slices_per_sweep_;
+        StatsHistogram lock_wait_ns_;                   // only contended FrequencyBin locks are timed
+
+        std::atomic<uint64_t> iq_bytes_written_;
+        std::atomic<uint64_t> iq_samples_dropped_;
+        std::atomic<uint64_t> iq_stalls_;
+        StatsHistogram iq_write_latency_us_;            // time to write each recording buffer
+
+        // Owned by the thread calling updateRates()
+        uint64_t last_vectors_received_;
+        std::chrono::steady_clock::time_point last_rate_update_at_;
+        std::atomic<float> vectors_per_sec_;
+
+        std::atomic<float> expected_vectors_per_sec_;
+        float vectors_behind_;                          // shortfall against the expected rate, caught up vectors reduce it
+        std::atomic<uint64_t> vectors_lost_;
+    };
+
+}
+
+#endif //WAVEGUIDE_SDR_SAMPLERSTATS_H
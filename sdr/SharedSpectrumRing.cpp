@@ -0,0 +1,269 @@
+#include "SharedSpectrumRing.h"
+
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define SHARED_SPECTRUM_MAGIC 0x57475350      // "WGSP"
+#define SHARED_SPECTRUM_VERSION 1
+
+#define CACHE_LINE_SIZE 64
+
+sdr::SharedSpectrumRing::SharedSpectrumRing(const std::string& name, uint64_t start_freq_hz, uint64_t end_freq_hz, uint64_t sample_rate_hz,
+                                            double bin_bw_hz, uint64_t bin_count, uint32_t max_slice_bins, uint32_t slot_count) :
+        name_(name), owner_(true)
+{
+    mapping_ = nullptr;
+    header_ = nullptr;
+
+    uint64_t slot_size = sizeof(SlotHeader) + (sizeof(float) * max_slice_bins);
+    slot_size = (slot_size + CACHE_LINE_SIZE - 1) & ~static_cast<uint64_t>(CACHE_LINE_SIZE - 1);
+
+    uint64_t header_size = (sizeof(Header) + CACHE_LINE_SIZE - 1) & ~static_cast<uint64_t>(CACHE_LINE_SIZE - 1);
+    mapping_size_ = header_size + (slot_size * slot_count);
+
+    // Readers still attached to a previous segment keep their mapping, they'll see it closed and re-attach
+    shm_unlink(name_.c_str());
+
+    int fd = shm_open(name_.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0)
+    {
+        std::cerr << "Could not create shared memory " << name_ << ": " << strerror(errno) << std::endl;
+        return;
+    }
+
+    if (ftruncate(fd, mapping_size_) != 0)
+    {
+        std::cerr << "Could not size shared memory " << name_ << ": " << strerror(errno) << std::endl;
+        ::close(fd);
+        shm_unlink(name_.c_str());
+        return;
+    }
+
+    if ( ! map(fd))
+    {
+        shm_unlink(name_.c_str());
+        return;
+    }
+
+    // The segment is zero filled, so every slot starts with an even (idle) sequence
+    header_->start_freq_hz_ = start_freq_hz;
+    header_->end_freq_hz_ = end_freq_hz;
+    header_->sample_rate_hz_ = sample_rate_hz;
+    header_->bin_bw_hz_ = bin_bw_hz;
+    header_->bin_count_ = bin_count;
+    header_->max_slice_bins_ = max_slice_bins;
+    header_->slot_count_ = slot_count;
+    header_->slot_size_ = slot_size;
+    header_->next_frame_.store(0, std::memory_order_relaxed);
+    header_->closed_.store(0, std::memory_order_relaxed);
+    header_->version_ = SHARED_SPECTRUM_VERSION;
+
+    // Readers check the magic last, so it's only set once everything else is in place
+    std::atomic_thread_fence(std::memory_order_release);
+    header_->magic_ = SHARED_SPECTRUM_MAGIC;
+
+    std::cout << "Publishing spectrum to shared memory " << name_ << " (" << slot_count << " slots of " << max_slice_bins << " bins)" << std::endl;
+}
+
+sdr::SharedSpectrumRing::SharedSpectrumRing(const std::string& name) : name_(name), owner_(false)
+{
+    mapping_ = nullptr;
+    header_ = nullptr;
+    mapping_size_ = 0;
+
+    int fd = shm_open(name_.c_str(), O_RDWR, 0);
+    if (fd < 0)
+    {
+        std::cerr << "Could not open shared memory " << name_ << ": " << strerror(errno) << std::endl;
+        return;
+    }
+
+    struct stat shm_stat;
+    if (fstat(fd, &shm_stat) != 0 || static_cast<size_t>(shm_stat.st_size) < sizeof(Header))
+    {
+        std::cerr << "Shared memory " << name_ << " is not a spectrum ring" << std::endl;
+        ::close(fd);
+        return;
+    }
+
+    mapping_size_ = shm_stat.st_size;
+
+    // Readers map the segment writable only because the seqlock sequence is a std::atomic, they never store to it
+    if ( ! map(fd))
+    {
+        return;
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    if (header_->magic_ != SHARED_SPECTRUM_MAGIC || header_->version_ != SHARED_SPECTRUM_VERSION ||
+        mapping_size_ < sizeof(Header) + (header_->slot_size_ * header_->slot_count_))
+    {
+        std::cerr << "Shared memory " << name_ << " is not a compatible spectrum ring" << std::endl;
+        munmap(mapping_, mapping_size_);
+        mapping_ = nullptr;
+        header_ = nullptr;
+        return;
+    }
+
+    std::cout << "Attached to shared memory " << name_ << " (" << header_->start_freq_hz_ << "Hz - " << header_->end_freq_hz_ << "Hz)" << std::endl;
+}
+
+sdr::SharedSpectrumRing::~SharedSpectrumRing()
+{
+    if (mapping_)
+    {
+        if (owner_)
+        {
+            close();
+        }
+
+        munmap(mapping_, mapping_size_);
+    }
+
+    if (owner_)
+    {
+        shm_unlink(name_.c_str());
+    }
+}
+
+bool sdr::SharedSpectrumRing::map(int fd)
+{
+    void* mapping = mmap(nullptr, mapping_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+
+    if (mapping == MAP_FAILED)
+    {
+        std::cerr << "Could not map shared memory " << name_ << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    mapping_ = mapping;
+    header_ = static_cast<Header*>(mapping);
+
+    return true;
+}
+
+bool sdr::SharedSpectrumRing::isOpen()
+{
+    return mapping_ != nullptr;
+}
+
+sdr::SharedSpectrumRing::SlotHeader* sdr::SharedSpectrumRing::getSlot(uint64_t frame_number)
+{
+    uint64_t header_size = (sizeof(Header) + CACHE_LINE_SIZE - 1) & ~static_cast<uint64_t>(CACHE_LINE_SIZE - 1);
+    uint64_t slot = frame_number % header_->slot_count_;
+
+    return reinterpret_cast<SlotHeader*>(static_cast<uint8_t*>(mapping_) + header_size + (slot * header_->slot_size_));
+}
+
+uint64_t sdr::SharedSpectrumRing::publish(uint64_t start_bin, uint32_t bin_count, uint64_t sweep_count, const std::function<void(float*)>& fill)
+{
+    if (bin_count > header_->max_slice_bins_)
+    {
+        bin_count = header_->max_slice_bins_;
+    }
+
+    uint64_t frame_number = header_->next_frame_.fetch_add(1, std::memory_order_relaxed);
+    SlotHeader* slot = getSlot(frame_number);
+
+    // Mark the slot as being written (odd), readers that started before this will fail their sequence check
+    uint32_t sequence = slot->sequence_.load(std::memory_order_relaxed);
+    slot->sequence_.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    slot->info_.frame_number_ = frame_number;
+    slot->info_.start_bin_ = start_bin;
+    slot->info_.bin_count_ = bin_count;
+    slot->info_.sweep_count_ = sweep_count;
+    slot->info_.timestamp_ns_ = (static_cast<int64_t>(now.tv_sec) * 1000000000) + now.tv_nsec;
+
+    fill(reinterpret_cast<float*>(slot + 1));
+
+    slot->sequence_.store(sequence + 2, std::memory_order_release);
+
+    return frame_number;
+}
+
+sdr::SharedSpectrumRing::ReadResult sdr::SharedSpectrumRing::read(uint64_t frame_number, const std::function<void(const FrameInfo&, const float*)>& consume)
+{
+    SlotHeader* slot = getSlot(frame_number);
+
+    uint32_t sequence = slot->sequence_.load(std::memory_order_acquire);
+    if (sequence & 1)
+    {
+        // Being written, either with this frame or (if we've been lapped) a later one
+        return (getFramesWritten() > frame_number + header_->slot_count_) ? ReadResult::OVERWRITTEN : ReadResult::NOT_READY;
+    }
+
+    FrameInfo info = slot->info_;
+    if (info.frame_number_ != frame_number || sequence == 0)
+    {
+        return (sequence != 0 && info.frame_number_ > frame_number) ? ReadResult::OVERWRITTEN : ReadResult::NOT_READY;
+    }
+
+    consume(info, reinterpret_cast<const float*>(slot + 1));
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot->sequence_.load(std::memory_order_relaxed) != sequence)
+    {
+        return ReadResult::OVERWRITTEN;
+    }
+
+    return ReadResult::OK;
+}
+
+uint64_t sdr::SharedSpectrumRing::getFramesWritten()
+{
+    return header_->next_frame_.load(std::memory_order_acquire);
+}
+
+void sdr::SharedSpectrumRing::close()
+{
+    header_->closed_.store(1, std::memory_order_release);
+}
+
+bool sdr::SharedSpectrumRing::isClosed()
+{
+    return header_->closed_.load(std::memory_order_acquire) != 0;
+}
+
+uint64_t sdr::SharedSpectrumRing::getStartFrequency()
+{
+    return header_->start_freq_hz_;
+}
+
+uint64_t sdr::SharedSpectrumRing::getEndFrequency()
+{
+    return header_->end_freq_hz_;
+}
+
+uint64_t sdr::SharedSpectrumRing::getSampleRate()
+{
+    return header_->sample_rate_hz_;
+}
+
+double sdr::SharedSpectrumRing::getBinBandwidth()
+{
+    return header_->bin_bw_hz_;
+}
+
+uint64_t sdr::SharedSpectrumRing::getBinCount()
+{
+    return header_->bin_count_;
+}
+
+uint32_t sdr::SharedSpectrumRing::getSlotCount()
+{
+    return header_->slot_count_;
+}
@@ -0,0 +1,101 @@
+#ifndef WAVEGUIDE_SDR_SHAREDSPECTRUMRING_H
+#define WAVEGUIDE_SDR_SHAREDSPECTRUMRING_H
+
+#include <atomic>
+#include <string>
+#include <functional>
+#include <cstdint>
+
+namespace sdr {
+
+    // Ring of slice frames in POSIX shared memory. The sampler publishes the amplitudes of each slice as it finishes
+    // dwelling on it, and any number of local processes attach to read them straight out of the mapping. Each slot is
+    // guarded by a seqlock so that writers never wait for readers, readers instead detect (and drop) frames that were
+    // overwritten while they were being read.
+    class SharedSpectrumRing {
+    public:
+        // Creates (replacing any existing segment of the same name) a ring for publishing.
+        SharedSpectrumRing(const std::string& name, uint64_t start_freq_hz, uint64_t end_freq_hz, uint64_t sample_rate_hz,
+                           double bin_bw_hz, uint64_t bin_count, uint32_t max_slice_bins, uint32_t slot_count = 256);
+
+        // Attaches to an existing ring for reading.
+        explicit SharedSpectrumRing(const std::string& name);
+
+        ~SharedSpectrumRing();
+
+        bool isOpen();
+
+        typedef struct
+        {
+            uint64_t frame_number_;
+            uint64_t start_bin_;            // bin number of the first amplitude in the frame
+            uint32_t bin_count_;
+            uint64_t sweep_count_;
+            int64_t timestamp_ns_;          // CLOCK_REALTIME when the frame was published
+        } FrameInfo;
+
+        enum class ReadResult {
+            OK,
+            NOT_READY,                      // the frame hasn't been (completely) written yet
+            OVERWRITTEN                     // the writer lapped the reader, the frame is gone
+        };
+
+        // Claims the next frame and lets fill write bin_count amplitudes directly into its slot. Safe to call from
+        // multiple sampler threads at once.
+        uint64_t publish(uint64_t start_bin, uint32_t bin_count, uint64_t sweep_count, const std::function<void(float*)>& fill);
+
+        // Passes the frame's amplitudes to consume without copying them out of shared memory. Anything consume
+        // derived from them must be discarded unless OK is returned (the slot may have been rewritten under it).
+        ReadResult read(uint64_t frame_number, const std::function<void(const FrameInfo&, const float*)>& consume);
+
+        // Number of frames claimed by publishers so far (frames below this are, or soon will be, readable).
+        uint64_t getFramesWritten();
+
+        // Publishers mark the ring as closed when they stop (or retune) so readers know to re-attach.
+        void close();
+        bool isClosed();
+
+        uint64_t getStartFrequency();
+        uint64_t getEndFrequency();
+        uint64_t getSampleRate();
+        double getBinBandwidth();
+        uint64_t getBinCount();
+        uint32_t getSlotCount();
+
+    private:
+        typedef struct
+        {
+            uint32_t magic_;
+            uint32_t version_;
+            uint64_t start_freq_hz_;
+            uint64_t end_freq_hz_;
+            uint64_t sample_rate_hz_;
+            double bin_bw_hz_;
+            uint64_t bin_count_;
+            uint32_t max_slice_bins_;
+            uint32_t slot_count_;
+            uint64_t slot_size_;            // bytes per slot (header + amplitudes), cache line aligned
+            std::atomic<uint64_t> next_frame_;
+            std::atomic<uint32_t> closed_;
+        } Header;
+
+        typedef struct
+        {
+            std::atomic<uint32_t> sequence_;    // odd while the slot is being written
+            FrameInfo info_;
+        } SlotHeader;
+
+        bool map(int fd);
+        SlotHeader* getSlot(uint64_t frame_number);
+
+        std::string name_;
+        bool owner_;                        // the publisher unlinks the segment when done
+
+        size_t mapping_size_;
+        void* mapping_;
+        Header* header_;
+    };
+
+}
+
+#endif //WAVEGUIDE_SDR_SHAREDSPECTRUMRING_H
@@ -2,11 +2,36 @@
 
 #include <iostream>
 #include <cassert>
+#include <algorithm>
+#include <functional>
 #include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <chrono>
+#include <fstream>
 #include <boost/thread/exceptions.hpp>
 
 #include "Config.h"
 
+// How often the rates in each device's SamplerStats are recalculated.
+#define STATS_UPDATE_INTERVAL_MS 1000
+
+// The stats file (if any) is rewritten every this many updates.
+#define STATS_FILE_UPDATES 5
+
+// A zoomed span may only fill this fraction of the decimated bandwidth, leaving the edges of the FFT (and the
+// decimating filter's roll-off) unused.
+#define ZOOM_FFT_USABLE_FRACTION (2.0 / 3.0)
+
+// How long capture devices have to start streaming before those that haven't are reported.
+#define STARTUP_TIMEOUT_MS 10000
+
+// How long the viewer thread sleeps when it has caught up with the publisher.
+#define VIEWER_POLL_INTERVAL_MS 5
+
+// Widest the sweep history gets, neighbouring bins are averaged into each column beyond this.
+#define HISTORY_MAX_COLUMNS 4096
+
 sdr::SpectrumSampler::SpectrumSampler(Config* config) :
     config_(config)
 {
@@ -17,11 +42,51 @@ sdr::SpectrumSampler::SpectrumSampler(Config* config) :
 
     sample_threads_.clear();
     samples_ = nullptr;
+
+    stats_thread_ = nullptr;
+    stop_stats_thread_ = false;
+
+    range_generation_ = 0;
+
+    viewer_ring_ = nullptr;
+    viewer_thread_ = nullptr;
+    stop_viewer_thread_ = false;
+
+    stream_client_ = nullptr;
+    stream_server_ = nullptr;
+
+    iq_writer_ = nullptr;
+    if ( ! config_->getIqCaptureDirectory().empty())
+    {
+        iq_writer_ = new IqCaptureWriter(config_->getIqCaptureDirectory());
+    }
+
+    control_socket_ = nullptr;
+    if ( ! config_->getControlSocketPath().empty())
+    {
+        control_socket_ = new ControlSocket(config_->getControlSocketPath(), this);
+    }
 }
 
 sdr::SpectrumSampler::~SpectrumSampler()
 {
+    if (control_socket_)
+    {
+        delete control_socket_;
+    }
+
     stop();
+
+    if (stream_server_)
+    {
+        delete stream_server_;
+    }
+
+    // Once the sample threads are stopped nothing else is queued, this waits for what has been
+    if (iq_writer_)
+    {
+        delete iq_writer_;
+    }
 }
 
 sdr::SpectrumSamples* sdr::SpectrumSampler::getSamples()
@@ -31,21 +96,68 @@ sdr::SpectrumSamples* sdr::SpectrumSampler::getSamples()
 
 void sdr::SpectrumSampler::stop()
 {
-    std::cout << "Signalling all sample threads to exit" << std::endl;
+    if (stats_thread_)
+    {
+        {
+            std::lock_guard<std::mutex> guard(stats_thread_lock_);
+            stop_stats_thread_ = true;
+        }
 
-    for (SampleThread* t : sample_threads_)
+        stats_thread_stopping_.notify_one();
+        stats_thread_->join();
+
+        delete stats_thread_;
+        stats_thread_ = nullptr;
+    }
+
+    if (viewer_thread_)
     {
-        // This will block until the thread has stopped
-        t->stop();
-        delete t;
+        stop_viewer_thread_ = true;
+        viewer_thread_->join();
+
+        delete viewer_thread_;
+        viewer_thread_ = nullptr;
     }
 
-    sample_threads_.clear();
+    if (viewer_ring_)
+    {
+        delete viewer_ring_;
+        viewer_ring_ = nullptr;
+    }
 
-    if (samples_)
+    if (stream_client_)
     {
-        delete samples_;
-        samples_ = nullptr;
+        delete stream_client_;
+        stream_client_ = nullptr;
+    }
+
+    std::cout << "Signalling all sample threads to exit" << std::endl;
+
+    {
+        std::lock_guard<std::mutex> guard(sample_threads_lock_);
+
+        for (SampleThread* t : sample_threads_)
+        {
+            // This will block until the thread has stopped
+            t->stop();
+            delete t;
+        }
+
+        sample_threads_.clear();
+
+        // Also held by exportHistory()
+        if (samples_)
+        {
+            delete samples_;
+            samples_ = nullptr;
+        }
+
+        for (SpectrumSamples* samples : retired_samples_)
+        {
+            delete samples;
+        }
+
+        retired_samples_.clear();
     }
 
     std::cout << "All sample threads have been stopped" << std::endl;
@@ -53,34 +165,426 @@ void sdr::SpectrumSampler::stop()
 
 bool sdr::SpectrumSampler::start(uint64_t start_freq_hz, uint64_t end_freq_hz)
 {
-    if (sample_threads_.size())
+    if (sample_threads_.size() || samples_)
     {
         std::cout << "Cannot start SpectrumSampler while it is already running, call stop() first" << std::endl;
         return false;
     }
 
+    uint64_t sample_rate_hz = capture_device_sample_rate_hz_;
+    uint32_t decimation = 1;
+
+    if ( ! config_->getViewSharedMemory().empty())
+    {
+        // The publisher decides what is scanned, the requested range is ignored
+        viewer_ring_ = new SharedSpectrumRing(config_->getViewSharedMemory());
+        if ( ! viewer_ring_->isOpen())
+        {
+            delete viewer_ring_;
+            viewer_ring_ = nullptr;
+            return false;
+        }
+
+        start_freq_hz = viewer_ring_->getStartFrequency();
+        end_freq_hz = viewer_ring_->getEndFrequency();
+        sample_rate_hz = viewer_ring_->getSampleRate();
+        decimation = SpectrumSamples::getDecimationForBinBandwidth(sample_rate_hz, viewer_ring_->getBinBandwidth());
+    }
+    else if ( ! config_->getStreamConnectHost().empty())
+    {
+        // As above, the stream server decides what is scanned
+        stream_client_ = new SpectrumStreamClient(config_->getStreamConnectHost(), config_->getStreamConnectPort());
+        if ( ! stream_client_->isConnected())
+        {
+            delete stream_client_;
+            stream_client_ = nullptr;
+            return false;
+        }
+
+        start_freq_hz = stream_client_->getStartFrequency();
+        end_freq_hz = stream_client_->getEndFrequency();
+        sample_rate_hz = stream_client_->getSampleRate();
+        decimation = SpectrumSamples::getDecimationForBinBandwidth(sample_rate_hz, stream_client_->getBinBandwidth());
+    }
+    else if (config_->getZoomFft())
+    {
+        decimation = getZoomDecimation(start_freq_hz, end_freq_hz);
+    }
+
     start_freq_hz_ = start_freq_hz;
     end_freq_hz_ = end_freq_hz;
 
-    samples_ = new SpectrumSamples(start_freq_hz, end_freq_hz, capture_device_sample_rate_hz_, config_->getAveragingWindow());
+    samples_ = createSamples(start_freq_hz, end_freq_hz, sample_rate_hz, decimation);
+    range_generation_.fetch_add(1, std::memory_order_release);
+
+    if (viewer_ring_)
+    {
+        if (samples_->getBinCount() != viewer_ring_->getBinCount() || samples_->getBinBandwidth() != viewer_ring_->getBinBandwidth())
+        {
+            std::cerr << "Published spectrum has " << viewer_ring_->getBinCount() << " bins but " << samples_->getBinCount() << " were allocated" << std::endl;
+            stop();
+            return false;
+        }
+
+        stop_viewer_thread_ = false;
+        viewer_thread_ = new std::thread(&SpectrumSampler::runViewerThread, this);
+
+        return true;
+    }
+
+    if (stream_client_)
+    {
+        if (samples_->getBinCount() != stream_client_->getBinCount() || samples_->getBinBandwidth() != stream_client_->getBinBandwidth())
+        {
+            std::cerr << "Streamed spectrum has " << stream_client_->getBinCount() << " bins but " << samples_->getBinCount() << " were allocated" << std::endl;
+            stop();
+            return false;
+        }
+
+        stream_client_->start(std::bind(&SpectrumSampler::applyViewerSlice, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4));
+
+        return true;
+    }
+
+    if ( ! config_->getPublishSharedMemory().empty() && ! samples_->enablePublishing(config_->getPublishSharedMemory()))
+    {
+        std::cerr << "Samples will not be published" << std::endl;
+    }
+
+    if (config_->getStreamPort())
+    {
+        if ( ! stream_server_)
+        {
+            stream_server_ = new SpectrumStreamServer(config_->getStreamPort());
+        }
+
+        if (stream_server_->isListening())
+        {
+            stream_server_->setRange(start_freq_hz, end_freq_hz, sample_rate_hz, samples_->getBinBandwidth(), samples_->getBinCount());
+            samples_->enableStreaming(stream_server_);
+        }
+    }
+
+    samples_->setDeviceCount(device_count_);
 
     uint64_t total_bw_hz = end_freq_hz - start_freq_hz;
     uint64_t bw_per_device_hz = static_cast<uint64_t>(ceil(total_bw_hz / static_cast<float>(device_count_)));        // may be > capture_device_sample_rate_hz_
     uint64_t device_start_freq_hz = start_freq_hz;
 
+    // Devices are opened and their flowgraphs built in parallel, each by its own thread. Nothing waits for them here
+    // (so zooming doesn't block the display), the stats thread reports once they're streaming.
     for (uint8_t i = 0; i < device_count_; i++)
     {
-        SampleThread* thread = new SampleThread(config_, i, device_start_freq_hz, device_start_freq_hz + bw_per_device_hz, samples_);
-        sample_threads_.push_back(thread);
+        SampleThread* thread = new SampleThread(config_, i, device_start_freq_hz, device_start_freq_hz + bw_per_device_hz, samples_, iq_writer_);
+
+        {
+            std::lock_guard<std::mutex> guard(sample_threads_lock_);
+            sample_threads_.push_back(thread);
+        }
 
         thread->start();
 
         device_start_freq_hz += bw_per_device_hz;
     }
 
+    started_at_ = std::chrono::steady_clock::now();
+    stop_stats_thread_ = false;
+    stats_thread_ = new std::thread(&SpectrumSampler::runStatsThread, this);
+
     return true;
 }
 
+sdr::SpectrumSamples* sdr::SpectrumSampler::createSamples(uint64_t start_freq_hz, uint64_t end_freq_hz, uint64_t sample_rate_hz, uint32_t decimation)
+{
+    FrequencyBin::StorageMode storage_mode = FrequencyBin::STORAGE_FLOAT;
+    if (config_->getBinStorage() == "int16")
+    {
+        storage_mode = FrequencyBin::STORAGE_INT16;
+    }
+    else if (config_->getBinStorage() == "ema")
+    {
+        storage_mode = FrequencyBin::STORAGE_EMA;
+    }
+
+    SpectrumSamples* samples = new SpectrumSamples(start_freq_hz, end_freq_hz, sample_rate_hz, config_->getAveragingWindow(), decimation, storage_mode);
+
+    if ( ! config_->getOccupancyDirectory().empty())
+    {
+        // Each scanned range accumulates into its own file so that zooming doesn't discard occupancy for other ranges
+        char occupancy_path[256];
+        snprintf(occupancy_path, sizeof(occupancy_path), "%s/occupancy_%lu_%lu.dat", config_->getOccupancyDirectory().c_str(), start_freq_hz, end_freq_hz);
+
+        if ( ! samples->enableOccupancy(occupancy_path, config_->getOccupancyMargin()))
+        {
+            std::cerr << "Occupancy will not be recorded" << std::endl;
+        }
+    }
+
+    if (config_->getHistoryDepth())
+    {
+        // Columns are coalesced so that history stays a bounded size however wide the range is
+        uint64_t bin_count = samples->getBinCount();
+        samples->enableHistory(config_->getHistoryDepth(), static_cast<uint32_t>((bin_count + HISTORY_MAX_COLUMNS - 1) / HISTORY_MAX_COLUMNS));
+    }
+
+    return samples;
+}
+
+bool sdr::SpectrumSampler::exportHistory(const std::string& path)
+{
+    std::lock_guard<std::mutex> guard(sample_threads_lock_);
+
+    if ( ! samples_ || ! samples_->getHistory())
+    {
+        return false;
+    }
+
+    return samples_->getHistory()->exportCsv(path);
+}
+
+bool sdr::SpectrumSampler::triggerIqCapture()
+{
+    std::lock_guard<std::mutex> guard(sample_threads_lock_);
+
+    if ( ! iq_writer_ || sample_threads_.empty())
+    {
+        return false;
+    }
+
+    for (SampleThread* t : sample_threads_)
+    {
+        t->triggerIqCapture();
+    }
+
+    return true;
+}
+
+std::vector<sdr::SampleThread::StartupTimings> sdr::SpectrumSampler::getStartupTimings()
+{
+    std::lock_guard<std::mutex> guard(sample_threads_lock_);
+
+    std::vector<SampleThread::StartupTimings> timings;
+    for (SampleThread* t : sample_threads_)
+    {
+        timings.push_back(t->getStartupTimings());
+    }
+
+    return timings;
+}
+
+uint32_t sdr::SpectrumSampler::getZoomDecimation(uint64_t start_freq_hz, uint64_t end_freq_hz)
+{
+    // Each device's share of the range must fit in the usable part of its decimated FFT
+    double bw_per_device_hz = ceil((end_freq_hz - start_freq_hz) / static_cast<double>(device_count_)) + 1;
+    uint32_t decimation = static_cast<uint32_t>(floor((capture_device_sample_rate_hz_ * ZOOM_FFT_USABLE_FRACTION) / bw_per_device_hz));
+
+    // The device is tuned a quarter of the capture bandwidth below the span (away from its DC spike), which must not
+    // go below 0Hz.
+    if (decimation < 2 || start_freq_hz < capture_device_sample_rate_hz_)
+    {
+        return 1;
+    }
+
+    std::cout << "Zooming into " << bw_per_device_hz << "Hz per device by decimating by " << decimation << std::endl;
+
+    return decimation;
+}
+
+bool sdr::SpectrumSampler::setGain(float gain)
+{
+    if ( ! config_->setGain(gain))
+    {
+        return false;
+    }
+
+    updateSettings();
+
+    return true;
+}
+
+bool sdr::SpectrumSampler::setAgc(bool enable_agc)
+{
+    config_->setAgc(enable_agc);
+    updateSettings();
+
+    return true;
+}
+
+bool sdr::SpectrumSampler::setDcSpikeRemoval(bool enable_dc_spike_removal)
+{
+    config_->setDcSpikeRemoval(enable_dc_spike_removal);
+    updateSettings();
+
+    return true;
+}
+
+bool sdr::SpectrumSampler::setDwellTime(uint32_t dwell_time_us)
+{
+    if ( ! config_->setDwellTime(dwell_time_us))
+    {
+        return false;
+    }
+
+    updateSettings();
+
+    return true;
+}
+
+Config* sdr::SpectrumSampler::getConfig()
+{
+    return config_;
+}
+
+void sdr::SpectrumSampler::updateSettings()
+{
+    std::lock_guard<std::mutex> guard(sample_threads_lock_);
+
+    for (SampleThread* t : sample_threads_)
+    {
+        t->updateSettings();
+    }
+}
+
+uint8_t sdr::SpectrumSampler::getDeviceCount()
+{
+    std::lock_guard<std::mutex> guard(sample_threads_lock_);
+
+    return static_cast<uint8_t>(sample_threads_.size());
+}
+
+sdr::SamplerStats* sdr::SpectrumSampler::getStats(uint8_t device_id)
+{
+    std::lock_guard<std::mutex> guard(sample_threads_lock_);
+
+    if (device_id >= sample_threads_.size())
+    {
+        return nullptr;
+    }
+
+    return sample_threads_[device_id]->getStats();
+}
+
+std::vector<std::string> sdr::SpectrumSampler::getStatsSummary()
+{
+    std::vector<std::string> summary;
+
+    std::lock_guard<std::mutex> guard(sample_threads_lock_);
+
+    for (uint8_t i = 0; i < sample_threads_.size(); i++)
+    {
+        char prefix[32];
+        snprintf(prefix, sizeof(prefix), "device %u: ", i);
+
+        summary.push_back(std::string(prefix) + sample_threads_[i]->getStats()->describe());
+    }
+
+    return summary;
+}
+
+bool sdr::SpectrumSampler::reportStartupTimings()
+{
+    std::vector<SampleThread::StartupTimings> timings = getStartupTimings();
+
+    bool timed_out = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started_at_).count() >= STARTUP_TIMEOUT_MS;
+    bool all_ready = true;
+    for (const SampleThread::StartupTimings& device_timings : timings)
+    {
+        all_ready = all_ready && device_timings.start_flowgraph_ms_ >= 0;
+    }
+
+    if ( ! all_ready && ! timed_out)
+    {
+        return false;
+    }
+
+    double ready_ms = 0.0;
+    for (size_t i = 0; i < timings.size(); i++)
+    {
+        if (timings[i].start_flowgraph_ms_ < 0)
+        {
+            std::cerr << "Capture device " << i << " did not start streaming within " << STARTUP_TIMEOUT_MS << "ms" << std::endl;
+            continue;
+        }
+
+        std::cout << "Capture device " << i << " opened in " << timings[i].open_device_ms_ << "ms, flowgraph built in "
+                  << (timings[i].build_flowgraph_ms_ - timings[i].open_device_ms_) << "ms and started in "
+                  << (timings[i].start_flowgraph_ms_ - timings[i].build_flowgraph_ms_) << "ms" << std::endl;
+
+        ready_ms = std::max(ready_ms, timings[i].start_flowgraph_ms_);
+    }
+
+    if (all_ready)
+    {
+        std::cout << "All capture devices ready in " << ready_ms << "ms" << std::endl;
+    }
+
+    return true;
+}
+
+void sdr::SpectrumSampler::runStatsThread()
+{
+    uint32_t updates = 0;
+    bool startup_reported = false;
+
+    while (true)
+    {
+        {
+            // Waits out the interval unless stop() is waiting on this thread
+            std::unique_lock<std::mutex> guard(stats_thread_lock_);
+            if (stats_thread_stopping_.wait_for(guard, std::chrono::milliseconds(STATS_UPDATE_INTERVAL_MS), [this]() { return stop_stats_thread_; }))
+            {
+                break;
+            }
+        }
+
+        if ( ! startup_reported)
+        {
+            startup_reported = reportStartupTimings();
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(sample_threads_lock_);
+
+            for (SampleThread* t : sample_threads_)
+            {
+                t->getStats()->updateRates();
+            }
+        }
+
+        if (++updates % STATS_FILE_UPDATES == 0 && ! config_->getStatsFile().empty())
+        {
+            writeStatsFile();
+        }
+    }
+}
+
+void sdr::SpectrumSampler::writeStatsFile()
+{
+    // Write alongside and rename over the previous file so that readers never see a partial update
+    std::string path = config_->getStatsFile();
+    std::string tmp_path = path + ".tmp";
+
+    std::ofstream stats_file(tmp_path, std::ios::out | std::ios::trunc);
+    if ( ! stats_file.is_open())
+    {
+        std::cerr << "Could not write stats file " << tmp_path << std::endl;
+        return;
+    }
+
+    stats_file << "time: " << time(nullptr) << ", range: " << start_freq_hz_ << "Hz - " << end_freq_hz_ << "Hz, sweeps: " << samples_->getSweepCount() << std::endl;
+    for (const std::string& line : getStatsSummary())
+    {
+        stats_file << line << std::endl;
+    }
+
+    stats_file.close();
+
+    if (rename(tmp_path.c_str(), path.c_str()) != 0)
+    {
+        std::cerr << "Could not replace stats file " << path << std::endl;
+    }
+}
+
 uint64_t sdr::SpectrumSampler::getStartFrequency()
 {
     return start_freq_hz_;
@@ -89,4 +593,148 @@ uint64_t sdr::SpectrumSampler::getStartFrequency()
 uint64_t sdr::SpectrumSampler::getEndFrequency()
 {
     return end_freq_hz_;
-}
\ No newline at end of file
+}
+
+bool sdr::SpectrumSampler::isViewer()
+{
+    return ! config_->getViewSharedMemory().empty() || ! config_->getStreamConnectHost().empty();
+}
+
+uint64_t sdr::SpectrumSampler::getRangeGeneration()
+{
+    return range_generation_.load(std::memory_order_acquire);
+}
+
+void sdr::SpectrumSampler::runViewerThread()
+{
+    SharedSpectrumRing::FrameInfo info;
+    uint64_t dropped_frames = 0;
+
+    // Start with the most recent ring's worth of frames so the display fills quickly
+    uint64_t frames_written = viewer_ring_->getFramesWritten();
+    uint64_t next_frame = frames_written - std::min(frames_written, static_cast<uint64_t>(viewer_ring_->getSlotCount() / 2));
+
+    while ( ! stop_viewer_thread_)
+    {
+        if (viewer_ring_->isClosed())
+        {
+            if (reattachViewer())
+            {
+                next_frame = 0;
+            }
+            else
+            {
+                std::this_thread::sleep_for(std::chrono::seconds(1));
+            }
+
+            continue;
+        }
+
+        frames_written = viewer_ring_->getFramesWritten();
+        if (next_frame >= frames_written)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(VIEWER_POLL_INTERVAL_MS));
+            continue;
+        }
+
+        // Slices are applied straight out of their slot, so skip ahead rather than read slots the publisher is about
+        // to reuse
+        if (frames_written - next_frame > viewer_ring_->getSlotCount() / 2)
+        {
+            uint64_t skipped_to = frames_written - (viewer_ring_->getSlotCount() / 4);
+            dropped_frames += skipped_to - next_frame;
+            next_frame = skipped_to;
+
+            std::cout << "Viewer has fallen behind the publisher (" << dropped_frames << " frames dropped)" << std::endl;
+        }
+
+        SharedSpectrumRing::ReadResult result = viewer_ring_->read(next_frame, [&](const SharedSpectrumRing::FrameInfo& frame_info, const float* frame_amplitudes) {
+            info = frame_info;
+            applyViewerSlice(info.start_bin_, info.bin_count_, info.sweep_count_, frame_amplitudes);
+        });
+
+        switch (result)
+        {
+            case SharedSpectrumRing::ReadResult::OK:
+                next_frame++;
+                break;
+
+            case SharedSpectrumRing::ReadResult::OVERWRITTEN:
+                // Only happens if the publisher laps the viewer mid slice, in which case some of the slice's bins may
+                // have been given the overwriting frame's amplitudes until they are next published
+                if (++dropped_frames % 100 == 1)
+                {
+                    std::cout << "Viewer has fallen behind the publisher (" << dropped_frames << " frames dropped)" << std::endl;
+                }
+
+                next_frame++;
+                break;
+
+            case SharedSpectrumRing::ReadResult::NOT_READY:
+                std::this_thread::sleep_for(std::chrono::milliseconds(VIEWER_POLL_INTERVAL_MS));
+                break;
+        }
+    }
+}
+
+bool sdr::SpectrumSampler::reattachViewer()
+{
+    SharedSpectrumRing* ring = new SharedSpectrumRing(config_->getViewSharedMemory());
+    if ( ! ring->isOpen() || ring->isClosed())
+    {
+        delete ring;
+        return false;
+    }
+
+    if (ring->getStartFrequency() != start_freq_hz_ || ring->getEndFrequency() != end_freq_hz_ ||
+        ring->getBinCount() != samples_->getBinCount() || ring->getBinBandwidth() != samples_->getBinBandwidth())
+    {
+        // The publisher has zoomed, follow it onto the new range
+        uint32_t decimation = SpectrumSamples::getDecimationForBinBandwidth(ring->getSampleRate(), ring->getBinBandwidth());
+        SpectrumSamples* samples = createSamples(ring->getStartFrequency(), ring->getEndFrequency(), ring->getSampleRate(), decimation);
+
+        if (samples->getBinCount() != ring->getBinCount() || samples->getBinBandwidth() != ring->getBinBandwidth())
+        {
+            std::cerr << "Published spectrum has " << ring->getBinCount() << " bins but " << samples->getBinCount() << " were allocated" << std::endl;
+            delete samples;
+            delete ring;
+            return false;
+        }
+
+        std::cout << "Publisher is now scanning " << ring->getStartFrequency() << "Hz - " << ring->getEndFrequency() << "Hz" << std::endl;
+
+        {
+            std::lock_guard<std::mutex> guard(sample_threads_lock_);
+
+            // Scenarios may still be reading the previous samples until they see the new range generation
+            retired_samples_.push_back(samples_);
+            samples_ = samples;
+            start_freq_hz_ = ring->getStartFrequency();
+            end_freq_hz_ = ring->getEndFrequency();
+        }
+
+        range_generation_.fetch_add(1, std::memory_order_release);
+    }
+
+    delete viewer_ring_;
+    viewer_ring_ = ring;
+
+    return true;
+}
+
+void sdr::SpectrumSampler::applyViewerSlice(uint64_t start_bin, uint32_t bin_count, uint64_t sweep_count, const float* amplitudes)
+{
+    uint32_t applied_bin_count = 0;
+    for (; applied_bin_count < bin_count && start_bin + applied_bin_count < samples_->getBinCount(); applied_bin_count++)
+    {
+        samples_->setLatestSampleForBin(start_bin + applied_bin_count, amplitudes[applied_bin_count], sweep_count);
+    }
+
+    samples_->markBinsWritten(start_bin, applied_bin_count);
+
+    // Snapshots are built from the amplitudes as they were published rather than from the bins they were averaged into
+    samples_->stageSlice(start_bin, applied_bin_count, sweep_count, amplitudes);
+
+    // Slices are tagged with the sweep in progress, so every earlier sweep has been completed by the publisher
+    samples_->completeSweep(0, sweep_count);
+}
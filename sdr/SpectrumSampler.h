@@ -3,10 +3,19 @@
 
 #include <vector>
 #include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <string>
+#include <chrono>
 #include <cstdint>
 
 #include "SampleThread.h"
 #include "SpectrumSamples.h"
+#include "SharedSpectrumRing.h"
+#include "SpectrumStreamServer.h"
+#include "SpectrumStreamClient.h"
+#include "ControlSocket.h"
 
 class Config;
 
@@ -25,7 +34,64 @@ namespace sdr {
 
         SpectrumSamples* getSamples();
 
+        // Whether samples come from another process (see runViewerThread()) rather than from capture devices. Viewers
+        // follow whatever range the publisher scans, so they can't be zoomed.
+        bool isViewer();
+
+        // Changes whenever start() is called or a viewer follows the publisher onto a new range, after which
+        // getSamples() and the frequency range must be fetched again.
+        uint64_t getRangeGeneration();
+
+        // Gets the telemetry for each running capture device (nullptr if device_id isn't running).
+        uint8_t getDeviceCount();
+        SamplerStats* getStats(uint8_t device_id);
+
+        // Gets a one line summary of the telemetry for each running capture device.
+        std::vector<std::string> getStatsSummary();
+
+        // Gets how long each capture device took to reach each stage of starting up (see SampleThread::StartupTimings).
+        std::vector<SampleThread::StartupTimings> getStartupTimings();
+
+        // Change capture settings on the running devices without restarting them (later restarts keep the new values
+        // too). Each returns false if the value is invalid.
+        bool setGain(float gain);
+        bool setAgc(bool enable_agc);
+        bool setDcSpikeRemoval(bool enable_dc_spike_removal);
+        bool setDwellTime(uint32_t dwell_time_us);
+
+        // Writes the completed sweeps held in the history to path as CSV, returns false if history isn't being kept.
+        bool exportHistory(const std::string& path);
+
+        // Captures raw IQ from every device's current slice, returns false if IQ capture isn't enabled.
+        bool triggerIqCapture();
+
+        Config* getConfig();
+
     private:
+        // Periodically updates rates in each device's SamplerStats and writes the stats file (if configured).
+        void runStatsThread();
+        void writeStatsFile();
+
+        // Logs how long each capture device took to start streaming once they all have (or STARTUP_TIMEOUT_MS has
+        // passed since start()), returns true once logged.
+        bool reportStartupTimings();
+
+        // In viewer mode samples come from a SharedSpectrumRing published by another process (or from a remote
+        // SpectrumStreamServer) rather than from SampleThreads. Each received slice is copied into samples_.
+        void runViewerThread();
+        bool reattachViewer();
+        void applyViewerSlice(uint64_t start_bin, uint32_t bin_count, uint64_t sweep_count, const float* amplitudes);
+
+        // Gets the factor to decimate each device's capture by before the FFT so that its share of the range fills
+        // the usable part of the FFT (or 1 if the range is too wide to benefit).
+        uint32_t getZoomDecimation(uint64_t start_freq_hz, uint64_t end_freq_hz);
+
+        // Tells each SampleThread to pick up changed capture settings from config_.
+        void updateSettings();
+
+        // Creates the samples for a range, with occupancy and history enabled as configured.
+        SpectrumSamples* createSamples(uint64_t start_freq_hz, uint64_t end_freq_hz, uint64_t sample_rate_hz, uint32_t decimation);
+
         Config* config_;
 
         uint8_t device_count_;             // number of devices to split the total bandwidth over
@@ -34,7 +100,34 @@ namespace sdr {
         uint64_t end_freq_hz_;
 
         std::vector<SampleThread*> sample_threads_;
+        std::mutex sample_threads_lock_;    // held while sample_threads_ changes, as settings can change from other threads
         SpectrumSamples* samples_;
+
+        // Samples replaced when a viewer follows the publisher onto a new range, kept until stop() as scenarios may
+        // still hold them.
+        std::vector<SpectrumSamples*> retired_samples_;
+        std::atomic<uint64_t> range_generation_;
+
+        std::chrono::steady_clock::time_point started_at_;
+
+        std::thread* stats_thread_;
+        bool stop_stats_thread_;                   // held under stats_thread_lock_
+        std::mutex stats_thread_lock_;
+        std::condition_variable stats_thread_stopping_;    // wakes the stats thread early when it is stopped
+
+        SharedSpectrumRing* viewer_ring_;
+        std::thread* viewer_thread_;
+        std::atomic<bool> stop_viewer_thread_;
+
+        SpectrumStreamClient* stream_client_;
+
+        // Outlives restarts (ie. zooming) so that remote viewers stay connected.
+        SpectrumStreamServer* stream_server_;
+
+        ControlSocket* control_socket_;
+
+        // Shared by every SampleThread and outlives restarts, so that captures queued before a zoom are still written.
+        IqCaptureWriter* iq_writer_;
     };
 
 }
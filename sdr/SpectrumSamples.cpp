@@ -3,39 +3,126 @@
 #include <iostream>
 #include <cassert>
 #include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <new>
 
 #define FFT_SIZE 8192
 
-sdr::SpectrumSamples::SpectrumSamples(uint64_t start_freq_hz, uint64_t end_freq_hz, uint64_t capture_sample_rate_hz, uint16_t history_size) :
-        start_freq_hz_(start_freq_hz), end_freq_hz_(end_freq_hz), capture_sample_rate_hz_(capture_sample_rate_hz)
+// A device that stops completing sweeps mustn't leave the others staging slices without limit, the oldest sweeps' slices
+// are dropped beyond this many.
+#define MAX_STAGED_SWEEPS 8
+
+sdr::SpectrumSamples::SpectrumSamples(uint64_t start_freq_hz, uint64_t end_freq_hz, uint64_t capture_sample_rate_hz, uint16_t history_size,
+                                      uint32_t decimation, FrequencyBin::StorageMode storage_mode) :
+        start_freq_hz_(start_freq_hz), end_freq_hz_(end_freq_hz), capture_sample_rate_hz_(capture_sample_rate_hz), decimation_(decimation)
 {
     fft_size_ = FFT_SIZE;
 
     keep_maximum_sample_ = true;
     sweep_count_ = 0;
 
+    occupancy_ = nullptr;
+    occupancy_busy_margin_db_ = 0.0f;
+
+    publisher_ = nullptr;
+    stream_server_ = nullptr;
+
+    device_sweep_counts_.assign(1, 0);
+    completed_sweep_count_ = 0;
+    completed_sweep_capture_ns_ = -1;
+    snapshots_enabled_ = false;
+    sweep_publisher_ = nullptr;
+    stop_sweep_publisher_ = false;
+    sweep_history_ = nullptr;
+
     assert(end_freq_hz_ > start_freq_hz_);
 
     uint64_t total_bw_hz = (end_freq_hz_ - start_freq_hz_) + 1;     // inclusive of start and end (ie. 1000 - 1 = 1000Hz)
 
     // How much bandwidth is represented by an FFT bin and how many total bins are required for the whole range?
-    bin_bw_hz_ = floor(capture_sample_rate_hz_ / static_cast<double>(fft_size_));
-    uint64_t bin_count = static_cast<uint64_t>(ceil(total_bw_hz / bin_bw_hz_));
-    std::cout << "Allocating " << bin_count << " bins (" << bin_bw_hz_ << "Hz per bin) to cover " << total_bw_hz << "Hz" << std::endl;
+    // Zoomed bins are only a few Hz wide, so they keep their fractional part rather than accumulating rounding errors.
+    if (decimation_ > 1)
+    {
+        bin_bw_hz_ = capture_sample_rate_hz_ / (static_cast<double>(fft_size_) * decimation_);
+    }
+    else
+    {
+        bin_bw_hz_ = floor(capture_sample_rate_hz_ / static_cast<double>(fft_size_));
+    }
+
+    bin_count_ = static_cast<uint64_t>(ceil(total_bw_hz / bin_bw_hz_));
+    history_size_ = history_size;
+    storage_mode_ = storage_mode;
 
-    uint64_t bin_start_freq_hz = start_freq_hz_;
-    for (uint64_t i = 0; i < bin_count; i++)
+    // Bins are only allocated once samples arrive for them, so wide scans start immediately and pages nobody writes to
+    // (ie. a viewer of a partially published range) never use memory.
+    page_size_ = fft_size_;
+    page_count_ = (bin_count_ + page_size_ - 1) / page_size_;
+
+    pages_ = new std::atomic<FrequencyBin*>[page_count_];
+    page_generations_ = new std::atomic<uint64_t>[page_count_];
+    for (uint64_t i = 0; i < page_count_; i++)
     {
-        bins_.push_back(new FrequencyBin(bin_start_freq_hz, history_size));
-        bin_start_freq_hz += bin_bw_hz_;
+        pages_[i].store(nullptr, std::memory_order_relaxed);
+        page_generations_[i].store(0, std::memory_order_relaxed);
     }
+
+    size_t bytes_per_bin = FrequencyBin::getBytesPerBin(history_size, storage_mode);
+    std::cout << "Using " << bin_count_ << " bins (" << bin_bw_hz_ << "Hz per bin) to cover " << total_bw_hz << "Hz" << std::endl;
+    std::cout << "Bins use " << bytes_per_bin << " bytes each (" << ((bin_count_ * bytes_per_bin) / (1024 * 1024)) << "MB once all are allocated)" << std::endl;
 }
 
 sdr::SpectrumSamples::~SpectrumSamples()
 {
-    for (uint64_t i = 0; i < bins_.size(); i++)
+    if (sweep_publisher_)
     {
-        delete bins_[i];
+        {
+            std::lock_guard<std::mutex> guard(sweep_lock_);
+            stop_sweep_publisher_ = true;
+            completed_sweeps_changed_.notify_one();
+        }
+
+        // Sweeps already completed are still published
+        sweep_publisher_->join();
+        delete sweep_publisher_;
+    }
+
+    for (uint64_t page = 0; page < page_count_; page++)
+    {
+        FrequencyBin* bins = pages_[page].load(std::memory_order_relaxed);
+        if ( ! bins)
+        {
+            continue;
+        }
+
+        uint64_t first_bin = page * page_size_;
+        for (uint64_t i = 0; i < page_size_ && first_bin + i < bin_count_; i++)
+        {
+            bins[i].~FrequencyBin();
+        }
+
+        operator delete(bins);
+    }
+
+    delete[] pages_;
+    delete[] page_generations_;
+
+    if (occupancy_)
+    {
+        delete occupancy_;
+    }
+
+    if (publisher_)
+    {
+        delete publisher_;
+    }
+
+    if (sweep_history_)
+    {
+        delete sweep_history_;
     }
 }
 
@@ -44,6 +131,18 @@ uint32_t sdr::SpectrumSamples::getFFTSize()
     return fft_size_;
 }
 
+uint32_t sdr::SpectrumSamples::getDecimation()
+{
+    return decimation_;
+}
+
+uint32_t sdr::SpectrumSamples::getDecimationForBinBandwidth(uint64_t capture_sample_rate_hz, double bin_bw_hz)
+{
+    long decimation = lround(capture_sample_rate_hz / (bin_bw_hz * FFT_SIZE));
+
+    return decimation > 1 ? static_cast<uint32_t>(decimation) : 1;
+}
+
 double sdr::SpectrumSamples::getBinBandwidth()
 {
     return bin_bw_hz_;
@@ -51,18 +150,121 @@ double sdr::SpectrumSamples::getBinBandwidth()
 
 float sdr::SpectrumSamples::getLatestAmplitude(uint64_t freq_hz, bool moving_average)
 {
-    return bins_[getBinNumber(freq_hz)]->getLatestAmplitude(moving_average);
+    return getBinAmplitude(getBinNumber(freq_hz), moving_average);
+}
+
+float sdr::SpectrumSamples::getNoiseFloor(uint64_t freq_hz)
+{
+    FrequencyBin* bin = const_cast<FrequencyBin*>(getFrequencyBin(getBinNumber(freq_hz)));
+
+    return bin ? bin->getNoiseFloorAmplitude() : 0.0f;
+}
+
+float sdr::SpectrumSamples::getSignalToNoiseRatio(uint64_t freq_hz, bool moving_average)
+{
+    return getBinSignalToNoiseRatio(getBinNumber(freq_hz), moving_average);
 }
 
 sdr::FrequencyBin const* sdr::SpectrumSamples::getFrequencyBin(uint64_t bin_number)
 {
-    assert(bin_number < bins_.size());
-    return bins_[bin_number];
+    assert(bin_number < bin_count_);
+
+    FrequencyBin* bins = pages_[bin_number / page_size_].load(std::memory_order_acquire);
+
+    return bins ? &bins[bin_number % page_size_] : nullptr;
+}
+
+uint64_t sdr::SpectrumSamples::getBinFrequency(uint64_t bin_number)
+{
+    return start_freq_hz_ + static_cast<uint64_t>(bin_number * bin_bw_hz_);
+}
+
+bool sdr::SpectrumSamples::getHasBeenSet(uint64_t bin_number, uint32_t minimum_samples)
+{
+    FrequencyBin* bin = const_cast<FrequencyBin*>(getFrequencyBin(bin_number));
+
+    return bin && bin->getHasBeenSet(minimum_samples);
+}
+
+float sdr::SpectrumSamples::getBinAmplitude(uint64_t bin_number, bool moving_average)
+{
+    FrequencyBin* bin = const_cast<FrequencyBin*>(getFrequencyBin(bin_number));
+
+    return bin ? bin->getLatestAmplitude(moving_average) : 0.0f;
+}
+
+float sdr::SpectrumSamples::getBinSignalToNoiseRatio(uint64_t bin_number, bool moving_average)
+{
+    FrequencyBin* bin = const_cast<FrequencyBin*>(getFrequencyBin(bin_number));
+
+    return bin ? bin->getSignalToNoiseRatio(moving_average) : 0.0f;
+}
+
+uint64_t sdr::SpectrumSamples::getGeneration(uint64_t first_bin, uint64_t bin_count)
+{
+    assert(bin_count > 0 && first_bin + bin_count <= bin_count_);
+
+    // Generations only ever increase, so their sum changes whenever any of them do
+    uint64_t generation = 0;
+    for (uint64_t page = first_bin / page_size_; page <= (first_bin + bin_count - 1) / page_size_; page++)
+    {
+        generation += page_generations_[page].load(std::memory_order_acquire);
+    }
+
+    return generation;
+}
+
+void sdr::SpectrumSamples::allocateAllBins()
+{
+    for (uint64_t page = 0; page < page_count_; page++)
+    {
+        allocatePage(page);
+    }
+}
+
+sdr::FrequencyBin* sdr::SpectrumSamples::getOrAllocateBin(uint64_t bin_number)
+{
+    assert(bin_number < bin_count_);
+
+    uint64_t page = bin_number / page_size_;
+
+    FrequencyBin* bins = pages_[page].load(std::memory_order_acquire);
+    if ( ! bins)
+    {
+        bins = allocatePage(page);
+    }
+
+    return &bins[bin_number % page_size_];
+}
+
+sdr::FrequencyBin* sdr::SpectrumSamples::allocatePage(uint64_t page)
+{
+    std::lock_guard<std::mutex> guard(pages_lock_);
+
+    // Another sampler thread may have allocated it while we waited
+    FrequencyBin* bins = pages_[page].load(std::memory_order_relaxed);
+    if (bins)
+    {
+        return bins;
+    }
+
+    // The page's bins are constructed in a single block rather than allocated individually
+    bins = static_cast<FrequencyBin*>(operator new(sizeof(FrequencyBin) * page_size_));
+
+    uint64_t first_bin = page * page_size_;
+    for (uint64_t i = 0; i < page_size_ && first_bin + i < bin_count_; i++)
+    {
+        new (&bins[i]) FrequencyBin(getBinFrequency(first_bin + i), history_size_, storage_mode_);
+    }
+
+    pages_[page].store(bins, std::memory_order_release);
+
+    return bins;
 }
 
 uint64_t sdr::SpectrumSamples::getBinCount()
 {
-    return bins_.size();
+    return bin_count_;
 }
 
 void sdr::SpectrumSamples::setKeepMaximumSample(bool keep_maximum_sample)
@@ -70,22 +272,462 @@ void sdr::SpectrumSamples::setKeepMaximumSample(bool keep_maximum_sample)
     keep_maximum_sample_ = keep_maximum_sample;
 }
 
-void sdr::SpectrumSamples::setLatestSample(uint64_t freq_hz, float amplitude, uint64_t sweep_count)
+void sdr::SpectrumSamples::setLatestSample(uint64_t freq_hz, float amplitude, uint64_t sweep_count, SamplerStats* stats)
 {
-    uint64_t bin_number = getBinNumber(freq_hz);
+    setLatestSampleForBin(getBinNumber(freq_hz), amplitude, sweep_count, stats);
+}
 
-    bins_[bin_number]->setLatestAmplitude(amplitude, keep_maximum_sample_);
+void sdr::SpectrumSamples::setLatestSampleForBin(uint64_t bin_number, float amplitude, uint64_t sweep_count, SamplerStats* stats)
+{
+    FrequencyBin* bin = getOrAllocateBin(bin_number);
+    float noise_floor = bin->setLatestAmplitude(amplitude, keep_maximum_sample_, stats);
+
+    if (occupancy_)
+    {
+        occupancy_->record(bin_number, (amplitude - noise_floor) >= occupancy_busy_margin_db_);
+    }
 
     // If any of the sampler threads has moved onto its next sweep, keep our sweep count aligned
-    if (sweep_count > sweep_count_)
+    uint64_t current_sweep_count = sweep_count_.load(std::memory_order_relaxed);
+    while (sweep_count > current_sweep_count && ! sweep_count_.compare_exchange_weak(current_sweep_count, sweep_count, std::memory_order_relaxed))
     {
-        sweep_count_ = sweep_count;
+    }
+}
+
+void sdr::SpectrumSamples::markBinsWritten(uint64_t first_bin, uint64_t bin_count)
+{
+    if ( ! bin_count)
+    {
+        return;
+    }
+
+    // Released after the samples so that a reader seeing the new generation also sees them
+    for (uint64_t page = first_bin / page_size_; page <= (first_bin + bin_count - 1) / page_size_; page++)
+    {
+        page_generations_[page].fetch_add(1, std::memory_order_release);
     }
 }
 
 uint64_t sdr::SpectrumSamples::getSweepCount()
 {
-    return sweep_count_;
+    return sweep_count_.load(std::memory_order_relaxed);
+}
+
+uint64_t sdr::SpectrumSamples::getCompletedSweepCount()
+{
+    return completed_sweep_count_.load(std::memory_order_acquire);
+}
+
+int64_t sdr::SpectrumSamples::getCompletedSweepCaptureTime()
+{
+    return completed_sweep_capture_ns_.load(std::memory_order_relaxed);
+}
+
+void sdr::SpectrumSamples::setSliceCapture(uint64_t start_freq_hz, uint64_t end_freq_hz, uint64_t sweep_count, int64_t first_capture_ns,
+                                           int64_t last_capture_ns, bool device_clock)
+{
+    if (first_capture_ns < 0 || last_capture_ns < 0)
+    {
+        return;
+    }
+
+    SliceCapture capture;
+    capture.start_bin_ = getBinNumber(start_freq_hz);
+    capture.end_bin_ = getBinNumber(end_freq_hz);
+    capture.sweep_count_ = sweep_count;
+    capture.first_capture_ns_ = first_capture_ns;
+    capture.last_capture_ns_ = last_capture_ns;
+    capture.device_clock_ = device_clock;
+
+    std::lock_guard<std::mutex> guard(sweep_lock_);
+
+    slice_captures_[capture.start_bin_] = capture;
+
+    int64_t& sweep_capture_ns = sweep_capture_ns_.emplace(sweep_count, last_capture_ns).first->second;
+    sweep_capture_ns = std::max(sweep_capture_ns, last_capture_ns);
+}
+
+bool sdr::SpectrumSamples::getBinCapture(uint64_t bin_number, SliceCapture& capture)
+{
+    std::lock_guard<std::mutex> guard(sweep_lock_);
+
+    // The slice starting at or before the bin
+    auto slice = slice_captures_.upper_bound(bin_number);
+    if (slice == slice_captures_.begin())
+    {
+        return false;
+    }
+
+    slice--;
+    if (bin_number > slice->second.end_bin_)
+    {
+        return false;
+    }
+
+    capture = slice->second;
+
+    return true;
+}
+
+std::vector<sdr::SliceCapture> sdr::SpectrumSamples::getSliceCaptures()
+{
+    std::lock_guard<std::mutex> guard(sweep_lock_);
+
+    std::vector<SliceCapture> captures;
+    for (auto& slice : slice_captures_)
+    {
+        captures.push_back(slice.second);
+    }
+
+    return captures;
+}
+
+bool sdr::SpectrumSamples::waitForCompletedSweep(uint64_t after_sweep_count, uint32_t timeout_ms)
+{
+    std::unique_lock<std::mutex> guard(sweep_lock_);
+
+    return sweep_completed_.wait_for(guard, std::chrono::milliseconds(timeout_ms), [this, after_sweep_count]() {
+        return completed_sweep_count_.load(std::memory_order_relaxed) > after_sweep_count;
+    });
+}
+
+void sdr::SpectrumSamples::addSweepHandler(SweepHandler handler)
+{
+    std::lock_guard<std::mutex> guard(sweep_lock_);
+
+    sweep_handlers_.push_back(handler);
+}
+
+void sdr::SpectrumSamples::enableSnapshots()
+{
+    std::lock_guard<std::mutex> guard(sweep_lock_);
+
+    snapshots_enabled_ = true;
+}
+
+std::shared_ptr<const sdr::SweepSnapshot> sdr::SpectrumSamples::getLatestSnapshot()
+{
+    std::lock_guard<std::mutex> guard(sweep_lock_);
+
+    return latest_snapshot_;
+}
+
+void sdr::SpectrumSamples::enableHistory(uint16_t depth, uint32_t coalesce_factor)
+{
+    std::lock_guard<std::mutex> guard(history_lock_);
+
+    if (sweep_history_ || ! depth)
+    {
+        return;
+    }
+
+    sweep_history_ = new SweepHistory(start_freq_hz_, bin_bw_hz_, bin_count_, coalesce_factor, depth);
+    history_frame_.assign(sweep_history_->getColumnCount(), 0.0f);
+
+    std::cout << "Keeping " << depth << " sweeps of history at " << sweep_history_->getColumnCount() << " columns per sweep" << std::endl;
+}
+
+sdr::SweepHistory* sdr::SpectrumSamples::getHistory()
+{
+    return sweep_history_;
+}
+
+void sdr::SpectrumSamples::setDeviceCount(uint8_t device_count)
+{
+    std::lock_guard<std::mutex> guard(sweep_lock_);
+
+    device_sweep_counts_.assign(std::max<uint8_t>(device_count, 1), completed_sweep_count_.load(std::memory_order_relaxed));
+}
+
+void sdr::SpectrumSamples::completeSweep(uint8_t device_id, uint64_t sweep_count)
+{
+    uint64_t completed_sweep_count;
+    int64_t capture_ns = -1;
+
+    {
+        std::lock_guard<std::mutex> guard(sweep_lock_);
+
+        if (device_id >= device_sweep_counts_.size() || sweep_count <= device_sweep_counts_[device_id])
+        {
+            return;
+        }
+
+        device_sweep_counts_[device_id] = sweep_count;
+
+        // The sweep only completes when the slowest device gets to it
+        completed_sweep_count = *std::min_element(device_sweep_counts_.begin(), device_sweep_counts_.end());
+        if (completed_sweep_count <= completed_sweep_count_.load(std::memory_order_relaxed))
+        {
+            return;
+        }
+
+        // Sweeps are counted from 0 while in progress, so completing n sweeps finishes sweep n - 1. Every device's
+        // capture times are on CLOCK_REALTIME (see SampleThread::recordSliceCapture), so the latest can be taken.
+        while ( ! sweep_capture_ns_.empty() && sweep_capture_ns_.begin()->first < completed_sweep_count)
+        {
+            capture_ns = std::max(capture_ns, sweep_capture_ns_.begin()->second);
+            sweep_capture_ns_.erase(sweep_capture_ns_.begin());
+        }
+
+        completed_sweep_capture_ns_.store(capture_ns, std::memory_order_relaxed);
+        completed_sweep_count_.store(completed_sweep_count, std::memory_order_release);
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(sweep_lock_);
+
+        if (snapshots_enabled_ || sweep_history_ || ! sweep_handlers_.empty())
+        {
+            CompletedSweep sweep;
+            sweep.sweep_count_ = completed_sweep_count;
+            sweep.capture_ns_ = capture_ns;
+
+            struct timespec now;
+            clock_gettime(CLOCK_REALTIME, &now);
+            sweep.timestamp_ns_ = (static_cast<int64_t>(now.tv_sec) * 1000000000) + now.tv_nsec;
+
+            // Only the slices are handed over here, the sweep publisher does the copying
+            while ( ! staged_sweeps_.empty() && staged_sweeps_.begin()->first < completed_sweep_count)
+            {
+                for (StagedSlice& slice : staged_sweeps_.begin()->second)
+                {
+                    sweep.slices_.push_back(std::move(slice));
+                }
+
+                staged_sweeps_.erase(staged_sweeps_.begin());
+            }
+
+            completed_sweeps_.push_back(std::move(sweep));
+            completed_sweeps_changed_.notify_one();
+
+            if ( ! sweep_publisher_)
+            {
+                sweep_publisher_ = new std::thread(&SpectrumSamples::runSweepPublisher, this);
+            }
+        }
+    }
+
+    sweep_completed_.notify_all();
+}
+
+void sdr::SpectrumSamples::stageSlice(uint64_t start_bin, uint32_t bin_count, uint64_t sweep_count, const float* amplitudes)
+{
+    std::lock_guard<std::mutex> guard(sweep_lock_);
+
+    // A slice may be published after its sweep has completed (ie. by a viewer that fell behind), it is left out
+    if (( ! snapshots_enabled_ && ! sweep_history_) || sweep_count < completed_sweep_count_.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+
+    StagedSlice slice;
+    slice.start_bin_ = start_bin;
+    slice.amplitudes_.assign(amplitudes, amplitudes + bin_count);
+
+    staged_sweeps_[sweep_count].push_back(std::move(slice));
+
+    while (staged_sweeps_.size() > MAX_STAGED_SWEEPS)
+    {
+        staged_sweeps_.erase(staged_sweeps_.begin());
+    }
+}
+
+void sdr::SpectrumSamples::runSweepPublisher()
+{
+    while (true)
+    {
+        CompletedSweep sweep;
+        std::vector<SweepHandler> handlers;
+        bool build_snapshot;
+
+        {
+            std::unique_lock<std::mutex> guard(sweep_lock_);
+            completed_sweeps_changed_.wait(guard, [this]() {
+                return stop_sweep_publisher_ || ! completed_sweeps_.empty();
+            });
+
+            if (completed_sweeps_.empty())
+            {
+                break;
+            }
+
+            sweep = std::move(completed_sweeps_.front());
+            completed_sweeps_.pop_front();
+
+            handlers = sweep_handlers_;
+            build_snapshot = snapshots_enabled_;
+        }
+
+        // Slices are applied in the order they were staged, so where neighbouring slices overlap the later one wins
+        if (published_amplitudes_.empty() && ! sweep.slices_.empty())
+        {
+            published_amplitudes_.assign(bin_count_, 0.0f);
+        }
+
+        for (StagedSlice& slice : sweep.slices_)
+        {
+            uint64_t bin_count = std::min<uint64_t>(slice.amplitudes_.size(), bin_count_ - slice.start_bin_);
+            std::copy(slice.amplitudes_.begin(), slice.amplitudes_.begin() + bin_count, published_amplitudes_.begin() + slice.start_bin_);
+        }
+
+        if (build_snapshot && ! published_amplitudes_.empty())
+        {
+            std::shared_ptr<SweepSnapshot> snapshot = std::make_shared<SweepSnapshot>();
+            snapshot->sweep_count_ = sweep.sweep_count_;
+            snapshot->timestamp_ns_ = sweep.timestamp_ns_;
+            snapshot->capture_ns_ = sweep.capture_ns_;
+            snapshot->amplitudes_ = published_amplitudes_;
+
+            std::lock_guard<std::mutex> guard(sweep_lock_);
+            latest_snapshot_ = snapshot;
+        }
+
+        if (sweep_history_ && ! published_amplitudes_.empty())
+        {
+            std::lock_guard<std::mutex> guard(history_lock_);
+
+            uint32_t coalesce_factor = sweep_history_->getCoalesceFactor();
+            for (uint64_t column = 0; column < history_frame_.size(); column++)
+            {
+                uint64_t first_bin = column * coalesce_factor;
+                uint64_t bin_count = std::min<uint64_t>(coalesce_factor, bin_count_ - first_bin);
+
+                float total_amplitude = 0.0f;
+                for (uint64_t bin = first_bin; bin < first_bin + bin_count; bin++)
+                {
+                    total_amplitude += published_amplitudes_[bin];
+                }
+
+                history_frame_[column] = total_amplitude / bin_count;
+            }
+
+            sweep_history_->publish(sweep.sweep_count_, sweep.timestamp_ns_, sweep.capture_ns_, history_frame_.data());
+        }
+
+        for (SweepHandler& handler : handlers)
+        {
+            handler(sweep.sweep_count_);
+        }
+    }
+}
+
+bool sdr::SpectrumSamples::enableOccupancy(const std::string& path, float busy_margin_db)
+{
+    if (occupancy_)
+    {
+        return false;
+    }
+
+    OccupancyStore* occupancy = new OccupancyStore(path, start_freq_hz_, bin_bw_hz_, bin_count_);
+    if ( ! occupancy->isOpen())
+    {
+        delete occupancy;
+        return false;
+    }
+
+    occupancy_busy_margin_db_ = busy_margin_db;
+    occupancy_ = occupancy;
+
+    return true;
+}
+
+sdr::OccupancyStore* sdr::SpectrumSamples::getOccupancy()
+{
+    return occupancy_;
+}
+
+void sdr::SpectrumSamples::updateOccupancyBucket()
+{
+    if (occupancy_)
+    {
+        occupancy_->advance(time(nullptr));
+    }
+}
+
+bool sdr::SpectrumSamples::enablePublishing(const std::string& shm_name)
+{
+    if (publisher_)
+    {
+        return false;
+    }
+
+    SharedSpectrumRing* publisher = new SharedSpectrumRing(shm_name, start_freq_hz_, end_freq_hz_, capture_sample_rate_hz_, bin_bw_hz_, bin_count_, fft_size_);
+    if ( ! publisher->isOpen())
+    {
+        delete publisher;
+        return false;
+    }
+
+    publisher_ = publisher;
+
+    return true;
+}
+
+void sdr::SpectrumSamples::publishSlice(uint64_t start_freq_hz, uint64_t end_freq_hz, uint64_t sweep_count)
+{
+    bool staging;
+    {
+        std::lock_guard<std::mutex> guard(sweep_lock_);
+        staging = snapshots_enabled_ || sweep_history_;
+    }
+
+    if ( ! publisher_ && ! stream_server_ && ! staging)
+    {
+        return;
+    }
+
+    uint64_t start_bin = getBinNumber(start_freq_hz);
+    uint64_t end_bin = getBinNumber(end_freq_hz < end_freq_hz_ ? end_freq_hz : end_freq_hz_);
+    uint32_t bin_count = static_cast<uint32_t>(end_bin - start_bin + 1);
+
+    auto read_amplitudes = [&](float* amplitudes) {
+        for (uint32_t i = 0; i < bin_count && i < fft_size_; i++)
+        {
+            amplitudes[i] = getBinAmplitude(start_bin + i, true);
+        }
+    };
+
+    if ( ! stream_server_ && ! staging)
+    {
+        // The amplitudes are written straight into the shared memory slot
+        publisher_->publish(start_bin, bin_count, sweep_count_, read_amplitudes);
+        return;
+    }
+
+    std::vector<float> amplitudes(bin_count);
+    read_amplitudes(amplitudes.data());
+
+    if (stream_server_)
+    {
+        stream_server_->publishSlice(start_bin, bin_count, sweep_count_, amplitudes.data());
+    }
+
+    if (publisher_)
+    {
+        publisher_->publish(start_bin, bin_count, sweep_count_, [&](float* shared_amplitudes) {
+            memcpy(shared_amplitudes, amplitudes.data(), sizeof(float) * std::min(bin_count, fft_size_));
+        });
+    }
+
+    if (staging)
+    {
+        stageSlice(start_bin, bin_count, sweep_count, amplitudes.data());
+    }
+}
+
+void sdr::SpectrumSamples::enableStreaming(SpectrumStreamServer* stream_server)
+{
+    stream_server_ = stream_server;
+}
+
+uint64_t sdr::SpectrumSamples::getStartFrequency()
+{
+    return start_freq_hz_;
+}
+
+uint64_t sdr::SpectrumSamples::getEndFrequency()
+{
+    return end_freq_hz_;
 }
 
 uint64_t sdr::SpectrumSamples::getBinNumber(uint64_t freq_hz)
@@ -96,7 +738,7 @@ uint64_t sdr::SpectrumSamples::getBinNumber(uint64_t freq_hz)
 
     uint64_t bin_number = static_cast<uint64_t>(floor(freq_offset_hz / bin_bw_hz_));
 
-    assert(bin_number < bins_.size());
+    assert(bin_number < bin_count_);
 
     return bin_number;
 }
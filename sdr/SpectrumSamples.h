@@ -2,42 +2,211 @@
 #define WAVEGUIDE_SDR_SPECTRUMSAMPLES_H
 
 #include <vector>
+#include <map>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <functional>
+#include <condition_variable>
 #include <cstdint>
 
 #include "FrequencyBin.h"
+#include "OccupancyStore.h"
+#include "SamplerStats.h"
+#include "SharedSpectrumRing.h"
+#include "SpectrumStreamServer.h"
+#include "SweepHistory.h"
 
 namespace sdr {
 
     class SampleThread;
     class FrequencyBin;
 
+    // The moving average amplitude of every bin once all of the devices have completed the same sweep, as read when each
+    // slice of the sweep was published (bins that weren't published in the sweep keep their previous amplitude). A
+    // snapshot is never modified after it's published, so readers can hold on to it while the sampler threads carry on.
+    struct SweepSnapshot
+    {
+        uint64_t sweep_count_;              // number of sweeps every device had completed
+        int64_t timestamp_ns_;              // CLOCK_REALTIME when the last device completed the sweep
+        int64_t capture_ns_;                // CLOCK_REALTIME when the sweep's last vector was captured (see SliceCapture)
+        std::vector<float> amplitudes_;     // one per bin
+    };
+
+    // When the vectors that last updated a slice's bins were captured, as CLOCK_REALTIME. Times are derived from the
+    // capture device's clock (ie. rx_time tags) when device_clock_ is set, otherwise from when each vector reached the
+    // sampler.
+    struct SliceCapture
+    {
+        uint64_t start_bin_;
+        uint64_t end_bin_;                  // inclusive
+        uint64_t sweep_count_;              // sweep in progress when the slice was captured
+        int64_t first_capture_ns_;
+        int64_t last_capture_ns_;
+        bool device_clock_;
+    };
+
     class SpectrumSamples {
     public:
-        SpectrumSamples(uint64_t start_freq_hz, uint64_t end_freq_hz, uint64_t capture_sample_rate_hz, uint16_t history_size);
+        // When decimation is greater than 1 the capture is decimated by that factor before the FFT (ie. zoom FFT), so
+        // each FFT covers capture_sample_rate_hz / decimation with correspondingly narrower bins.
+        SpectrumSamples(uint64_t start_freq_hz, uint64_t end_freq_hz, uint64_t capture_sample_rate_hz, uint16_t history_size,
+                        uint32_t decimation = 1, FrequencyBin::StorageMode storage_mode = FrequencyBin::STORAGE_FLOAT);
         ~SpectrumSamples();
 
         float getLatestAmplitude(uint64_t freq_hz, bool moving_average = true);
 
+        // Gets the estimated noise floor (in dB) and the signal to noise ratio (in dB) of the bin covering freq_hz.
+        float getNoiseFloor(uint64_t freq_hz);
+        float getSignalToNoiseRatio(uint64_t freq_hz, bool moving_average = true);
+
         // Gets the number of FFT bins being used to cover the entire range from start_freq_hz_ to end_freq_hz_.
         uint64_t getBinCount();
 
+        // Bins are allocated a page at a time when a sample is first written to the page, until then this returns
+        // nullptr. The per-bin getters below treat such bins as unset.
         FrequencyBin const* getFrequencyBin(uint64_t bin_number);
 
+        uint64_t getBinFrequency(uint64_t bin_number);
+        bool getHasBeenSet(uint64_t bin_number, uint32_t minimum_samples = 1);
+        float getBinAmplitude(uint64_t bin_number, bool moving_average = true);
+        float getBinSignalToNoiseRatio(uint64_t bin_number, bool moving_average = true);
+
+        // Gets a count that changes whenever samples are written to any of the bin_count bins from first_bin (or to
+        // bins sharing a page with them), so that readers can skip bins that haven't changed since they last looked.
+        uint64_t getGeneration(uint64_t first_bin, uint64_t bin_count);
+
+        // Allocates every bin up front rather than as each page is first written to.
+        void allocateAllBins();
+
         void setKeepMaximumSample(bool keep_maximum_sample);
 
-        // Gets the number of FFT bins being used per FFT (one FFT covers capture_sample_rate_hz_).
+        // Gets the number of FFT bins being used per FFT (one FFT covers capture_sample_rate_hz_ / decimation_).
         uint32_t getFFTSize();
 
+        uint32_t getDecimation();
+
+        // Gets the decimation that produced bins of bin_bw_hz from capture_sample_rate_hz, used by viewers to allocate
+        // the same bins as the sampler they follow.
+        static uint32_t getDecimationForBinBandwidth(uint64_t capture_sample_rate_hz, double bin_bw_hz);
+
         // Gets the bandwidth (in hz) of each FFT bin.
         double getBinBandwidth();
 
+        // Gets the bin covering freq_hz.
+        uint64_t getBinNumber(uint64_t freq_hz);
+
+        // Write samples as a VectorSinkBlock does, for replaying them without a flowgraph (ie. in benchmarks). Writers
+        // must not overlap, as the sinks' slices don't.
+        void setLatestSample(uint64_t freq_hz, float amplitude, uint64_t sweep_count, SamplerStats* stats = nullptr);
+        void setLatestSampleForBin(uint64_t bin_number, float amplitude, uint64_t sweep_count, SamplerStats* stats = nullptr);
+
+        // Bumps the generation of the pages covering the bin_count bins from first_bin, once a batch of samples has
+        // been written to them (so that it's paid per vector rather than per sample).
+        void markBinsWritten(uint64_t first_bin, uint64_t bin_count);
+
         uint64_t getSweepCount();
 
+        // Gets the number of sweeps that every device has completed (which may lag getSweepCount() by a sweep).
+        uint64_t getCompletedSweepCount();
+
+        // Gets when the last vector of the most recently completed sweep was captured (-1 if not known, ie. in viewers).
+        int64_t getCompletedSweepCaptureTime();
+
+        // Records when the vectors for the slice from start_freq_hz to end_freq_hz were captured (see SliceCapture).
+        void setSliceCapture(uint64_t start_freq_hz, uint64_t end_freq_hz, uint64_t sweep_count, int64_t first_capture_ns,
+                             int64_t last_capture_ns, bool device_clock);
+
+        // Gets the capture times of the slice that last updated bin_number, returns false if it hasn't been captured.
+        bool getBinCapture(uint64_t bin_number, SliceCapture& capture);
+
+        // Gets the capture times of every slice captured so far, in frequency order.
+        std::vector<SliceCapture> getSliceCaptures();
+
+        // Blocks until every device has completed more than after_sweep_count sweeps, returns false on timeout.
+        bool waitForCompletedSweep(uint64_t after_sweep_count, uint32_t timeout_ms);
+
+        // Called with the count of each sweep completed by every device, from the thread that publishes completed sweeps
+        // once the sweep's snapshot and history (if enabled) have been published.
+        typedef std::function<void(uint64_t completed_sweep_count)> SweepHandler;
+        void addSweepHandler(SweepHandler handler);
+
+        // Start building a SweepSnapshot each time every device completes a sweep.
+        void enableSnapshots();
+
+        // Gets the most recent snapshot (or nullptr if snapshots aren't enabled or no sweep has completed yet).
+        std::shared_ptr<const SweepSnapshot> getLatestSnapshot();
+
+        // Start keeping the last depth completed sweeps, with coalesce_factor bins averaged into each column.
+        void enableHistory(uint16_t depth, uint32_t coalesce_factor);
+
+        // Gets the history of completed sweeps (or nullptr if history isn't being kept).
+        SweepHistory* getHistory();
+
+        // Start accumulating per-bin occupancy into the file at path. A sample counts as busy when it is at least
+        // busy_margin_db above the bin's noise floor.
+        bool enableOccupancy(const std::string& path, float busy_margin_db);
+
+        // Gets the occupancy accumulator (or nullptr if occupancy is not being recorded).
+        OccupancyStore* getOccupancy();
+
+        uint64_t getStartFrequency();
+        uint64_t getEndFrequency();
+
+        // Start publishing each completed slice into a shared memory ring that other processes can attach to.
+        bool enablePublishing(const std::string& shm_name);
+
+        // Also stream each completed slice to remote viewers (the server is owned by the caller).
+        void enableStreaming(SpectrumStreamServer* stream_server);
+
+        // Publishes the moving average amplitudes of the bins from start_freq_hz to end_freq_hz (if publishing or
+        // streaming), and stages them for the snapshot and history of sweep_count (the publishing device's sweep in
+        // progress).
+        void publishSlice(uint64_t start_freq_hz, uint64_t end_freq_hz, uint64_t sweep_count);
+
     private:
+        // Amplitudes of a slice as they were published, kept until the sweep they belong to completes.
+        typedef struct
+        {
+            uint64_t start_bin_;
+            std::vector<float> amplitudes_;
+        } StagedSlice;
+
+        // A sweep that every device has completed, waiting for the sweep publisher.
+        typedef struct
+        {
+            uint64_t sweep_count_;
+            int64_t timestamp_ns_;
+            int64_t capture_ns_;
+            std::vector<StagedSlice> slices_;
+        } CompletedSweep;
+
         friend class VectorSinkBlock;
+        friend class SampleThread;
+        friend class SpectrumSampler;
 
-        void setLatestSample(uint64_t freq_hz, float amplitude, uint64_t sweep_count);
-        uint64_t getBinNumber(uint64_t freq_hz);
+        // Sets how many devices have to complete a sweep before it counts as completed.
+        void setDeviceCount(uint8_t device_count);
+
+        // Records that device_id has completed sweep_count sweeps, publishing the sweep if it was the last device to.
+        void completeSweep(uint8_t device_id, uint64_t sweep_count);
+
+        // Copies bin_count amplitudes from start_bin into the slices staged for sweep_count (if snapshots or history are
+        // enabled).
+        void stageSlice(uint64_t start_bin, uint32_t bin_count, uint64_t sweep_count, const float* amplitudes);
+
+        // Applies each completed sweep's staged slices to published_amplitudes_, then publishes its snapshot and history
+        // frame and calls the sweep handlers. Runs on its own thread so that none of it holds up the sampler threads.
+        void runSweepPublisher();
+
+        // Gets the bin, allocating its page if this is the first write to it.
+        FrequencyBin* getOrAllocateBin(uint64_t bin_number);
+        FrequencyBin* allocatePage(uint64_t page);
+
+        // Called before each batch of samples is written so that occupancy is counted against the current hour.
+        void updateOccupancyBucket();
 
         bool keep_maximum_sample_;          // if keeping a single sample, do we keep the latest or the max?
 
@@ -45,11 +214,48 @@ namespace sdr {
         uint64_t end_freq_hz_;              // end frequency for samples
         uint64_t capture_sample_rate_hz_;   // sample rate of the capture device(s)
         double bin_bw_hz_;                  // bandwidth of each frequency bin in the FFT
-        uint64_t sweep_count_;              // how many sweeps of the full spectrum have been performed by the sampler threads?
+        std::atomic<uint64_t> sweep_count_; // how many sweeps of the full spectrum have been started by the sampler threads?
+
+        uint32_t fft_size_;                 // number of FFT bins used per FFT (one FFT covers capture_sample_rate_hz_ / decimation_)
+        uint32_t decimation_;               // capture samples per FFT input sample
+
+        uint64_t bin_count_;
+        uint16_t history_size_;
+        FrequencyBin::StorageMode storage_mode_;
+
+        uint32_t page_size_;                // number of bins allocated together, the same as the FFT size
+        uint64_t page_count_;
+        std::atomic<FrequencyBin*>* pages_; // each page is an array of page_size_ bins (or nullptr until first written)
+        std::mutex pages_lock_;             // held while allocating a page
+        std::atomic<uint64_t>* page_generations_;   // batches of samples written to each page so far (see getGeneration())
+
+        OccupancyStore* occupancy_;
+        float occupancy_busy_margin_db_;
+
+        SharedSpectrumRing* publisher_;
+        SpectrumStreamServer* stream_server_;
+
+        std::mutex sweep_lock_;                         // guards the members below
+        std::condition_variable sweep_completed_;
+        std::vector<uint64_t> device_sweep_counts_;     // sweeps completed by each device
+        std::atomic<uint64_t> completed_sweep_count_;   // minimum of device_sweep_counts_
+        std::atomic<int64_t> completed_sweep_capture_ns_;
+        std::map<uint64_t, SliceCapture> slice_captures_;   // keyed by start bin
+        std::map<uint64_t, int64_t> sweep_capture_ns_;      // latest capture time of each sweep that hasn't completed
+        std::vector<SweepHandler> sweep_handlers_;
+        bool snapshots_enabled_;
+        std::shared_ptr<const SweepSnapshot> latest_snapshot_;
+        std::map<uint64_t, std::vector<StagedSlice>> staged_sweeps_;    // keyed by the sweep the slices were published in
+        std::deque<CompletedSweep> completed_sweeps_;   // waiting for the sweep publisher
+        std::condition_variable completed_sweeps_changed_;
+        std::thread* sweep_publisher_;                  // started when the first sweep completes
+        bool stop_sweep_publisher_;
 
-        uint32_t fft_size_;                 // number of FFT bins used per FFT (one FFT covers capture_sample_rate_hz_)
+        std::vector<float> published_amplitudes_;       // every bin as of the latest published sweep, owned by the sweep publisher
 
-        std::vector<FrequencyBin*> bins_;
+        SweepHistory* sweep_history_;
+        std::vector<float> history_frame_;              // coalesced amplitudes of the sweep being added to sweep_history_ (by the sweep publisher)
+        std::mutex history_lock_;                       // held while history_frame_ is filled and published
     };
 
 }   // namespace sdr
@@ -0,0 +1,286 @@
+#include "SpectrumStreamClient.h"
+
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+// Frames larger than this are treated as corrupt.
+#define MAX_FRAME_LENGTH (64 * 1024 * 1024)
+
+sdr::SpectrumStreamClient::SpectrumStreamClient(const std::string& host, uint16_t port)
+{
+    fd_ = -1;
+    thread_ = nullptr;
+    stop_ = false;
+    range_changed_ = false;
+
+    frames_received_ = 0;
+    bytes_received_ = 0;
+
+    memset(&hello_, 0, sizeof(hello_));
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    struct addrinfo* addresses = nullptr;
+    std::string service = std::to_string(port);
+
+    int error = getaddrinfo(host.c_str(), service.c_str(), &hints, &addresses);
+    if (error != 0)
+    {
+        std::cerr << "Could not resolve stream server " << host << ": " << gai_strerror(error) << std::endl;
+        return;
+    }
+
+    for (struct addrinfo* address = addresses; address != nullptr; address = address->ai_next)
+    {
+        int fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+        if (fd < 0)
+        {
+            continue;
+        }
+
+        if (connect(fd, address->ai_addr, address->ai_addrlen) == 0)
+        {
+            fd_ = fd;
+            break;
+        }
+
+        close(fd);
+    }
+
+    freeaddrinfo(addresses);
+
+    if (fd_ < 0)
+    {
+        std::cerr << "Could not connect to stream server " << host << ":" << port << std::endl;
+        return;
+    }
+
+    int no_delay = 1;
+    setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+
+    // The server always starts with a HELLO
+    stream::FrameHeader header;
+    std::vector<uint8_t> payload;
+
+    if ( ! readFrame(header, payload) || header.type_ != stream::HELLO || payload.size() != sizeof(hello_))
+    {
+        std::cerr << "Stream server " << host << ":" << port << " did not describe its range" << std::endl;
+        close(fd_);
+        fd_ = -1;
+        return;
+    }
+
+    memcpy(&hello_, payload.data(), sizeof(hello_));
+    reconstructed_.assign(hello_.bin_count_, 0);
+
+    std::cout << "Connected to stream server " << host << ":" << port << " (" << hello_.start_freq_hz_ << "Hz - " << hello_.end_freq_hz_ << "Hz)" << std::endl;
+}
+
+sdr::SpectrumStreamClient::~SpectrumStreamClient()
+{
+    stop();
+
+    if (fd_ >= 0)
+    {
+        close(fd_);
+    }
+}
+
+bool sdr::SpectrumStreamClient::isConnected()
+{
+    return fd_ >= 0;
+}
+
+bool sdr::SpectrumStreamClient::start(SliceHandler handler)
+{
+    if (thread_ || fd_ < 0)
+    {
+        return false;
+    }
+
+    handler_ = handler;
+    stop_ = false;
+    thread_ = new std::thread(&SpectrumStreamClient::receive, this);
+
+    return true;
+}
+
+void sdr::SpectrumStreamClient::stop()
+{
+    if (thread_)
+    {
+        stop_ = true;
+
+        // Unblock the receive thread
+        shutdown(fd_, SHUT_RDWR);
+
+        thread_->join();
+        delete thread_;
+        thread_ = nullptr;
+    }
+}
+
+void sdr::SpectrumStreamClient::receive()
+{
+    stream::FrameHeader header;
+    std::vector<uint8_t> payload;
+
+    while ( ! stop_ && readFrame(header, payload))
+    {
+        if (header.type_ == stream::HELLO && payload.size() == sizeof(stream::Hello))
+        {
+            stream::Hello hello;
+            memcpy(&hello, payload.data(), sizeof(hello));
+
+            // Deltas restart from zero, but the viewer can only follow the server if the bins are the same
+            range_changed_ = hello.start_freq_hz_ != hello_.start_freq_hz_ || hello.end_freq_hz_ != hello_.end_freq_hz_ ||
+                             hello.bin_count_ != hello_.bin_count_;
+
+            if ( ! range_changed_)
+            {
+                reconstructed_.assign(hello.bin_count_, 0);
+            }
+            else
+            {
+                // No slices are applied (see below) until the server is back on the range this client was set up for
+                reconstructed_.clear();
+
+                std::cout << "Stream server is now scanning " << hello.start_freq_hz_ << "Hz - " << hello.end_freq_hz_ << "Hz, restart the viewer to follow it" << std::endl;
+            }
+
+            continue;
+        }
+
+        // Slices of a range this client wasn't set up for are dropped outright
+        if (header.type_ != stream::SLICE || payload.size() < sizeof(stream::SliceHeader) || range_changed_)
+        {
+            continue;
+        }
+
+        stream::SliceHeader slice;
+        memcpy(&slice, payload.data(), sizeof(slice));
+
+        if (payload.size() != sizeof(slice) + (sizeof(int16_t) * slice.bin_count_) || slice.start_bin_ + slice.bin_count_ > reconstructed_.size())
+        {
+            std::cerr << "Ignoring malformed slice from stream server" << std::endl;
+            continue;
+        }
+
+        const int16_t* deltas = reinterpret_cast<const int16_t*>(payload.data() + sizeof(slice));
+        int32_t* reconstructed = reconstructed_.data() + slice.start_bin_;
+
+        amplitudes_.resize(slice.bin_count_);
+        for (uint32_t i = 0; i < slice.bin_count_; i++)
+        {
+            reconstructed[i] += deltas[i];
+            amplitudes_[i] = stream::dequantize(reconstructed[i]);
+        }
+
+        handler_(slice.start_bin_, slice.bin_count_, slice.sweep_count_, amplitudes_.data());
+
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        int64_t latency_ns = ((static_cast<int64_t>(now.tv_sec) * 1000000000) + now.tv_nsec) - slice.timestamp_ns_;
+
+        latency_us_.record(latency_ns > 0 ? static_cast<uint64_t>(latency_ns / 1000) : 0);
+        frames_received_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if ( ! stop_)
+    {
+        std::cout << "Stream server closed the connection" << std::endl;
+    }
+}
+
+bool sdr::SpectrumStreamClient::readFrame(stream::FrameHeader& header, std::vector<uint8_t>& payload)
+{
+    if ( ! readFully(&header, sizeof(header)) || header.magic_ != stream::MAGIC || header.length_ > MAX_FRAME_LENGTH)
+    {
+        return false;
+    }
+
+    payload.resize(header.length_);
+    if ( ! readFully(payload.data(), header.length_))
+    {
+        return false;
+    }
+
+    bytes_received_.fetch_add(sizeof(header) + header.length_, std::memory_order_relaxed);
+
+    return true;
+}
+
+bool sdr::SpectrumStreamClient::readFully(void* data, size_t length)
+{
+    uint8_t* remaining = static_cast<uint8_t*>(data);
+
+    while (length)
+    {
+        ssize_t received = recv(fd_, remaining, length, 0);
+        if (received < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (received <= 0)
+        {
+            return false;
+        }
+
+        remaining += received;
+        length -= received;
+    }
+
+    return true;
+}
+
+uint64_t sdr::SpectrumStreamClient::getStartFrequency()
+{
+    return hello_.start_freq_hz_;
+}
+
+uint64_t sdr::SpectrumStreamClient::getEndFrequency()
+{
+    return hello_.end_freq_hz_;
+}
+
+uint64_t sdr::SpectrumStreamClient::getSampleRate()
+{
+    return hello_.sample_rate_hz_;
+}
+
+double sdr::SpectrumStreamClient::getBinBandwidth()
+{
+    return hello_.bin_bw_hz_;
+}
+
+uint64_t sdr::SpectrumStreamClient::getBinCount()
+{
+    return hello_.bin_count_;
+}
+
+uint64_t sdr::SpectrumStreamClient::getFramesReceived()
+{
+    return frames_received_.load(std::memory_order_relaxed);
+}
+
+uint64_t sdr::SpectrumStreamClient::getBytesReceived()
+{
+    return bytes_received_.load(std::memory_order_relaxed);
+}
+
+sdr::StatsHistogram& sdr::SpectrumStreamClient::getLatency()
+{
+    return latency_us_;
+}
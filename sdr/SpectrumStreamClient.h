@@ -0,0 +1,69 @@
+#ifndef WAVEGUIDE_SDR_SPECTRUMSTREAMCLIENT_H
+#define WAVEGUIDE_SDR_SPECTRUMSTREAMCLIENT_H
+
+#include <atomic>
+#include <thread>
+#include <string>
+#include <vector>
+#include <functional>
+#include <cstdint>
+
+#include "SpectrumStreamProtocol.h"
+#include "SamplerStats.h"
+
+namespace sdr {
+
+    // Receives slices from a SpectrumStreamServer and reconstructs their amplitudes for a viewer.
+    class SpectrumStreamClient {
+    public:
+        // Connects to host:port and waits for the server to describe the range it is scanning.
+        SpectrumStreamClient(const std::string& host, uint16_t port);
+        ~SpectrumStreamClient();
+
+        bool isConnected();
+
+        // Called from the receive thread for each reconstructed slice.
+        typedef std::function<void(uint64_t start_bin, uint32_t bin_count, uint64_t sweep_count, const float* amplitudes)> SliceHandler;
+
+        bool start(SliceHandler handler);
+        void stop();
+
+        uint64_t getStartFrequency();
+        uint64_t getEndFrequency();
+        uint64_t getSampleRate();
+        double getBinBandwidth();
+        uint64_t getBinCount();
+
+        uint64_t getFramesReceived();
+        uint64_t getBytesReceived();
+
+        // Time (in usec) from the server publishing a slice to it being handled, only meaningful when both ends
+        // share a clock (eg. over loopback).
+        StatsHistogram& getLatency();
+
+    private:
+        void receive();
+
+        bool readFrame(stream::FrameHeader& header, std::vector<uint8_t>& payload);
+        bool readFully(void* data, size_t length);
+
+        int fd_;
+        std::thread* thread_;
+        std::atomic<bool> stop_;
+
+        SliceHandler handler_;
+
+        stream::Hello hello_;
+        bool range_changed_;                    // the server moved to a range this client wasn't set up for
+
+        std::vector<int32_t> reconstructed_;
+        std::vector<float> amplitudes_;
+
+        std::atomic<uint64_t> frames_received_;
+        std::atomic<uint64_t> bytes_received_;
+        StatsHistogram latency_us_;
+    };
+
+}
+
+#endif //WAVEGUIDE_SDR_SPECTRUMSTREAMCLIENT_H
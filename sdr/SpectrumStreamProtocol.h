@@ -0,0 +1,69 @@
+#ifndef WAVEGUIDE_SDR_SPECTRUMSTREAMPROTOCOL_H
+#define WAVEGUIDE_SDR_SPECTRUMSTREAMPROTOCOL_H
+
+#include <cstdint>
+#include <cmath>
+
+// Wire format shared by SpectrumStreamServer and SpectrumStreamClient. Every message is a FrameHeader followed by
+// length_ bytes of payload. Fields are sent in host byte order, both ends are expected to be little-endian.
+//
+// A client first receives a HELLO describing the bins being scanned, followed by a SLICE for each slice the sampler
+// completes. Amplitudes in a SLICE are int16 deltas, in centi-dB, against the value the client reconstructed for the
+// same bin from the previous SLICE covering it (which starts from 0 after each HELLO).
+namespace sdr {
+
+    namespace stream {
+
+        const uint32_t MAGIC = 0x57475354;      // "WGST"
+
+        // Amplitudes are quantized to this many steps per dB.
+        const float STEPS_PER_DB = 100.0f;
+
+        enum FrameType : uint8_t {
+            HELLO = 1,
+            SLICE = 2
+        };
+
+#pragma pack(push, 1)
+        typedef struct
+        {
+            uint32_t magic_;
+            uint8_t type_;
+            uint8_t reserved_[3];
+            uint32_t length_;                   // bytes of payload following the header
+        } FrameHeader;
+
+        typedef struct
+        {
+            uint64_t start_freq_hz_;
+            uint64_t end_freq_hz_;
+            uint64_t sample_rate_hz_;
+            double bin_bw_hz_;
+            uint64_t bin_count_;
+        } Hello;
+
+        typedef struct
+        {
+            uint64_t frame_number_;
+            uint64_t start_bin_;
+            uint64_t sweep_count_;
+            int64_t timestamp_ns_;              // CLOCK_REALTIME when the slice was published
+            uint32_t bin_count_;                // followed by this many int16_t deltas
+        } SliceHeader;
+#pragma pack(pop)
+
+        inline int32_t quantize(float amplitude)
+        {
+            return static_cast<int32_t>(lrintf(amplitude * STEPS_PER_DB));
+        }
+
+        inline float dequantize(int32_t quantized)
+        {
+            return quantized / STEPS_PER_DB;
+        }
+
+    }
+
+}
+
+#endif //WAVEGUIDE_SDR_SPECTRUMSTREAMPROTOCOL_H
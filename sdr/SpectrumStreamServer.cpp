@@ -0,0 +1,356 @@
+#include "SpectrumStreamServer.h"
+
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+#include <climits>
+
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+// How often the accept thread wakes up to check for shutdown and reap disconnected clients.
+#define ACCEPT_POLL_INTERVAL_MS 250
+
+sdr::SpectrumStreamServer::SpectrumStreamServer(uint16_t port) : port_(port)
+{
+    accept_thread_ = nullptr;
+    stop_ = false;
+
+    next_sequence_ = 0;
+    frames_sent_ = 0;
+    frames_dropped_ = 0;
+
+    memset(&hello_, 0, sizeof(hello_));
+
+    listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd_ < 0)
+    {
+        std::cerr << "Could not create stream server socket: " << strerror(errno) << std::endl;
+        return;
+    }
+
+    int reuse = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port_);
+
+    if (bind(listen_fd_, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0 || listen(listen_fd_, 8) != 0)
+    {
+        std::cerr << "Could not listen for stream clients on port " << port_ << ": " << strerror(errno) << std::endl;
+        close(listen_fd_);
+        listen_fd_ = -1;
+        return;
+    }
+
+    socklen_t address_length = sizeof(address);
+    getsockname(listen_fd_, reinterpret_cast<struct sockaddr*>(&address), &address_length);
+    port_ = ntohs(address.sin_port);
+
+    accept_thread_ = new std::thread(&SpectrumStreamServer::acceptConnections, this);
+
+    std::cout << "Streaming spectrum to clients on port " << port_ << std::endl;
+}
+
+sdr::SpectrumStreamServer::~SpectrumStreamServer()
+{
+    stop_ = true;
+
+    if (accept_thread_)
+    {
+        accept_thread_->join();
+        delete accept_thread_;
+    }
+
+    removeClients(false);
+
+    if (listen_fd_ >= 0)
+    {
+        close(listen_fd_);
+    }
+}
+
+bool sdr::SpectrumStreamServer::isListening()
+{
+    return listen_fd_ >= 0;
+}
+
+uint16_t sdr::SpectrumStreamServer::getPort()
+{
+    return port_;
+}
+
+void sdr::SpectrumStreamServer::setRange(uint64_t start_freq_hz, uint64_t end_freq_hz, uint64_t sample_rate_hz, double bin_bw_hz, uint64_t bin_count)
+{
+    std::lock_guard<std::mutex> guard(clients_lock_);
+
+    hello_.start_freq_hz_ = start_freq_hz;
+    hello_.end_freq_hz_ = end_freq_hz;
+    hello_.sample_rate_hz_ = sample_rate_hz;
+    hello_.bin_bw_hz_ = bin_bw_hz;
+    hello_.bin_count_ = bin_count;
+
+    // Slices from the old range are meaningless to clients, and deltas restart from zero after the new HELLO
+    for (Client* client : clients_)
+    {
+        std::lock_guard<std::mutex> client_guard(client->lock_);
+
+        client->pending_slices_.clear();
+        client->reconstructed_.assign(bin_count, 0);
+        client->hello_ = hello_;
+        client->hello_pending_ = true;
+        client->pending_changed_.notify_one();
+    }
+}
+
+void sdr::SpectrumStreamServer::publishSlice(uint64_t start_bin, uint32_t bin_count, uint64_t sweep_count, const float* amplitudes)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    uint64_t sequence = next_sequence_.fetch_add(1, std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> guard(clients_lock_);
+
+    for (Client* client : clients_)
+    {
+        std::lock_guard<std::mutex> client_guard(client->lock_);
+
+        if (client->stop_ || start_bin + bin_count > client->reconstructed_.size())
+        {
+            continue;
+        }
+
+        PendingSlice& slice = client->pending_slices_[start_bin];
+        if ( ! slice.amplitudes_.empty())
+        {
+            frames_dropped_.fetch_add(1, std::memory_order_relaxed);     // the client never got the previous copy
+        }
+
+        slice.sequence_ = sequence;
+        slice.sweep_count_ = sweep_count;
+        slice.timestamp_ns_ = (static_cast<int64_t>(now.tv_sec) * 1000000000) + now.tv_nsec;
+        slice.amplitudes_.assign(amplitudes, amplitudes + bin_count);
+
+        client->pending_changed_.notify_one();
+    }
+}
+
+uint32_t sdr::SpectrumStreamServer::getClientCount()
+{
+    std::lock_guard<std::mutex> guard(clients_lock_);
+
+    return static_cast<uint32_t>(clients_.size());
+}
+
+uint64_t sdr::SpectrumStreamServer::getFramesSent()
+{
+    return frames_sent_.load(std::memory_order_relaxed);
+}
+
+uint64_t sdr::SpectrumStreamServer::getFramesDropped()
+{
+    return frames_dropped_.load(std::memory_order_relaxed);
+}
+
+void sdr::SpectrumStreamServer::acceptConnections()
+{
+    while ( ! stop_)
+    {
+        removeClients(true);
+
+        struct pollfd listen_poll = {listen_fd_, POLLIN, 0};
+        if (poll(&listen_poll, 1, ACCEPT_POLL_INTERVAL_MS) <= 0)
+        {
+            continue;
+        }
+
+        int fd = accept(listen_fd_, nullptr, nullptr);
+        if (fd < 0)
+        {
+            continue;
+        }
+
+        // Slices are sent as soon as they're ready, don't let Nagle hold them back
+        int no_delay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+
+        Client* client = new Client();
+        client->fd_ = fd;
+        client->stop_ = false;
+        client->finished_ = false;
+
+        std::lock_guard<std::mutex> guard(clients_lock_);
+
+        client->hello_ = hello_;
+        client->hello_pending_ = true;
+        client->reconstructed_.assign(hello_.bin_count_, 0);
+        client->thread_ = new std::thread(&SpectrumStreamServer::sendToClient, this, client);
+
+        clients_.push_back(client);
+
+        std::cout << "Stream client connected (" << clients_.size() << " connected)" << std::endl;
+    }
+}
+
+void sdr::SpectrumStreamServer::removeClients(bool finished_only)
+{
+    std::vector<Client*> removed;
+
+    {
+        std::lock_guard<std::mutex> guard(clients_lock_);
+
+        for (auto i = clients_.begin(); i != clients_.end(); )
+        {
+            if (finished_only && ! (*i)->finished_)
+            {
+                i++;
+                continue;
+            }
+
+            removed.push_back(*i);
+            i = clients_.erase(i);
+        }
+    }
+
+    for (Client* client : removed)
+    {
+        {
+            std::lock_guard<std::mutex> client_guard(client->lock_);
+            client->stop_ = true;
+            client->pending_changed_.notify_one();
+        }
+
+        // Unblock a sender stuck in send() to a client that stopped reading
+        shutdown(client->fd_, SHUT_RDWR);
+
+        client->thread_->join();
+        delete client->thread_;
+
+        close(client->fd_);
+        delete client;
+
+        std::cout << "Stream client disconnected" << std::endl;
+    }
+}
+
+void sdr::SpectrumStreamServer::sendToClient(Client* client)
+{
+    std::vector<uint8_t> frame;
+
+    while (true)
+    {
+        std::unique_lock<std::mutex> guard(client->lock_);
+        client->pending_changed_.wait(guard, [client]() {
+            return client->stop_ || client->hello_pending_ || ! client->pending_slices_.empty();
+        });
+
+        if (client->stop_)
+        {
+            break;
+        }
+
+        stream::FrameHeader header;
+        memset(&header, 0, sizeof(header));
+        header.magic_ = stream::MAGIC;
+
+        if (client->hello_pending_)
+        {
+            header.type_ = stream::HELLO;
+            header.length_ = sizeof(client->hello_);
+
+            frame.resize(sizeof(header) + sizeof(client->hello_));
+            memcpy(frame.data(), &header, sizeof(header));
+            memcpy(frame.data() + sizeof(header), &client->hello_, sizeof(client->hello_));
+
+            client->hello_pending_ = false;
+        }
+        else
+        {
+            // Send the slice that has been waiting longest
+            auto oldest = client->pending_slices_.begin();
+            for (auto i = client->pending_slices_.begin(); i != client->pending_slices_.end(); i++)
+            {
+                if (i->second.sequence_ < oldest->second.sequence_)
+                {
+                    oldest = i;
+                }
+            }
+
+            PendingSlice& slice = oldest->second;
+            uint32_t bin_count = static_cast<uint32_t>(slice.amplitudes_.size());
+
+            stream::SliceHeader slice_header;
+            slice_header.frame_number_ = slice.sequence_;
+            slice_header.start_bin_ = oldest->first;
+            slice_header.sweep_count_ = slice.sweep_count_;
+            slice_header.timestamp_ns_ = slice.timestamp_ns_;
+            slice_header.bin_count_ = bin_count;
+
+            header.type_ = stream::SLICE;
+            header.length_ = sizeof(slice_header) + (sizeof(int16_t) * bin_count);
+
+            frame.resize(sizeof(header) + header.length_);
+            memcpy(frame.data(), &header, sizeof(header));
+            memcpy(frame.data() + sizeof(header), &slice_header, sizeof(slice_header));
+
+            // Deltas that don't fit in an int16 are clamped, the client then catches up over the following sweeps
+            int16_t* deltas = reinterpret_cast<int16_t*>(frame.data() + sizeof(header) + sizeof(slice_header));
+            int32_t* reconstructed = client->reconstructed_.data() + oldest->first;
+
+            for (uint32_t i = 0; i < bin_count; i++)
+            {
+                int32_t delta = stream::quantize(slice.amplitudes_[i]) - reconstructed[i];
+                delta = delta > SHRT_MAX ? SHRT_MAX : (delta < SHRT_MIN ? SHRT_MIN : delta);
+
+                deltas[i] = static_cast<int16_t>(delta);
+                reconstructed[i] += delta;
+            }
+
+            client->pending_slices_.erase(oldest);
+        }
+
+        // Publishers replace this client's pending slices while it's blocked sending (which is the back-pressure)
+        guard.unlock();
+
+        if ( ! sendFully(client->fd_, frame.data(), frame.size()))
+        {
+            break;
+        }
+
+        frames_sent_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    client->finished_ = true;
+}
+
+bool sdr::SpectrumStreamServer::sendFully(int fd, const void* data, size_t length)
+{
+    const uint8_t* remaining = static_cast<const uint8_t*>(data);
+
+    while (length)
+    {
+        ssize_t sent = send(fd, remaining, length, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (sent <= 0)
+        {
+            return false;
+        }
+
+        remaining += sent;
+        length -= sent;
+    }
+
+    return true;
+}
@@ -0,0 +1,86 @@
+#ifndef WAVEGUIDE_SDR_SPECTRUMSTREAMSERVER_H
+#define WAVEGUIDE_SDR_SPECTRUMSTREAMSERVER_H
+
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <condition_variable>
+#include <cstdint>
+
+#include "SpectrumStreamProtocol.h"
+
+namespace sdr {
+
+    // Streams completed slices to remote viewers over TCP (see SpectrumStreamProtocol.h). Each client has its own
+    // sender thread and at most one pending frame per slice: if a client can't keep up, a newer copy of a slice
+    // replaces the stale one still waiting to be sent rather than queueing behind it.
+    class SpectrumStreamServer {
+    public:
+        // Listens on port (0 picks a free port, see getPort()).
+        SpectrumStreamServer(uint16_t port);
+        ~SpectrumStreamServer();
+
+        bool isListening();
+        uint16_t getPort();
+
+        // Describes the bins being scanned, sent to each client when it connects (and again whenever it changes).
+        void setRange(uint64_t start_freq_hz, uint64_t end_freq_hz, uint64_t sample_rate_hz, double bin_bw_hz, uint64_t bin_count);
+
+        // Queues a slice for every connected client, called by the sampler threads as each slice completes.
+        void publishSlice(uint64_t start_bin, uint32_t bin_count, uint64_t sweep_count, const float* amplitudes);
+
+        uint32_t getClientCount();
+        uint64_t getFramesSent();
+        uint64_t getFramesDropped();
+
+    private:
+        typedef struct
+        {
+            uint64_t sequence_;                 // order the slices were published in
+            uint64_t sweep_count_;
+            int64_t timestamp_ns_;
+            std::vector<float> amplitudes_;
+        } PendingSlice;
+
+        typedef struct
+        {
+            int fd_;
+            std::thread* thread_;
+
+            std::mutex lock_;
+            std::condition_variable pending_changed_;
+            std::map<uint64_t, PendingSlice> pending_slices_;     // keyed by start bin
+            stream::Hello hello_;                 // copy of the server's hello_, sent when hello_pending_
+            bool hello_pending_;
+            bool stop_;
+            std::atomic<bool> finished_;
+
+            std::vector<int32_t> reconstructed_;  // quantized amplitudes the client holds for each bin
+        } Client;
+
+        void acceptConnections();
+        void sendToClient(Client* client);
+        void removeClients(bool finished_only);
+
+        bool sendFully(int fd, const void* data, size_t length);
+
+        int listen_fd_;
+        uint16_t port_;
+
+        std::thread* accept_thread_;
+        std::atomic<bool> stop_;
+
+        std::mutex clients_lock_;               // guards clients_ and hello_
+        std::vector<Client*> clients_;
+        stream::Hello hello_;
+
+        std::atomic<uint64_t> next_sequence_;
+        std::atomic<uint64_t> frames_sent_;
+        std::atomic<uint64_t> frames_dropped_;
+    };
+
+}
+
+#endif //WAVEGUIDE_SDR_SPECTRUMSTREAMSERVER_H
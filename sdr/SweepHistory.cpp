@@ -0,0 +1,158 @@
+#include "SweepHistory.h"
+
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+
+sdr::SweepHistory::SweepHistory(uint64_t start_freq_hz, double bin_bw_hz, uint64_t bin_count, uint32_t coalesce_factor, uint16_t depth) :
+        start_freq_hz_(start_freq_hz), bin_bw_hz_(bin_bw_hz), bin_count_(bin_count), coalesce_factor_(std::max<uint32_t>(coalesce_factor, 1)),
+        depth_(std::max<uint16_t>(depth, 1))
+{
+    column_count_ = (bin_count_ + coalesce_factor_ - 1) / coalesce_factor_;     // integer ceiling
+
+    amplitudes_ = new float[column_count_ * depth_];
+    frames_ = new FrameInfo[depth_];
+    next_slot_ = 0;
+
+    memset(amplitudes_, 0, sizeof(float) * column_count_ * depth_);
+    memset(frames_, 0, sizeof(FrameInfo) * depth_);
+}
+
+sdr::SweepHistory::~SweepHistory()
+{
+    delete[] amplitudes_;
+    delete[] frames_;
+}
+
+uint16_t sdr::SweepHistory::getDepth()
+{
+    return depth_;
+}
+
+uint32_t sdr::SweepHistory::getCoalesceFactor()
+{
+    return coalesce_factor_;
+}
+
+uint64_t sdr::SweepHistory::getColumnCount()
+{
+    return column_count_;
+}
+
+void sdr::SweepHistory::publish(uint64_t sweep_count, int64_t timestamp_ns, int64_t capture_ns, const float* amplitudes)
+{
+    std::lock_guard<std::mutex> guard(lock_);
+
+    memcpy(amplitudes_ + (next_slot_ * column_count_), amplitudes, sizeof(float) * column_count_);
+
+    frames_[next_slot_].sweep_count_ = sweep_count;
+    frames_[next_slot_].timestamp_ns_ = timestamp_ns;
+    frames_[next_slot_].capture_ns_ = capture_ns;
+
+    next_slot_ = (next_slot_ + 1) % depth_;
+}
+
+uint64_t sdr::SweepHistory::getNewestSweepCount()
+{
+    std::lock_guard<std::mutex> guard(lock_);
+
+    return frames_[(next_slot_ + depth_ - 1) % depth_].sweep_count_;
+}
+
+bool sdr::SweepHistory::getAmplitude(uint64_t sweep_count, uint64_t first_bin, uint64_t bin_count, float& amplitude)
+{
+    if ( ! bin_count || first_bin >= bin_count_)
+    {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> guard(lock_);
+
+    int32_t slot = findSlot(sweep_count);
+    if (slot < 0)
+    {
+        return false;
+    }
+
+    uint64_t first_column = first_bin / coalesce_factor_;
+    uint64_t last_column = std::min(first_bin + bin_count - 1, bin_count_ - 1) / coalesce_factor_;
+
+    const float* frame = amplitudes_ + (slot * column_count_);
+
+    float total_amplitude = 0.0f;
+    for (uint64_t column = first_column; column <= last_column; column++)
+    {
+        total_amplitude += frame[column];
+    }
+
+    amplitude = total_amplitude / ((last_column - first_column) + 1);
+
+    return true;
+}
+
+bool sdr::SweepHistory::exportCsv(const std::string& path)
+{
+    std::ofstream csv(path, std::ios::out | std::ios::trunc);
+    if ( ! csv.is_open())
+    {
+        std::cerr << "Could not open " << path << " to export the sweep history" << std::endl;
+        return false;
+    }
+
+    // Each column is labelled with the frequency at its center
+    csv << "sweep,timestamp_ns,capture_ns";
+    for (uint64_t column = 0; column < column_count_; column++)
+    {
+        uint64_t first_bin = column * coalesce_factor_;
+        uint64_t bin_count = std::min<uint64_t>(coalesce_factor_, bin_count_ - first_bin);
+
+        csv << "," << start_freq_hz_ + static_cast<uint64_t>((first_bin + (bin_count / 2.0)) * bin_bw_hz_);
+    }
+    csv << "\n";
+
+    std::lock_guard<std::mutex> guard(lock_);
+
+    uint16_t frames_written = 0;
+    for (uint16_t i = 0; i < depth_; i++)
+    {
+        uint16_t slot = (next_slot_ + i) % depth_;
+        if ( ! frames_[slot].sweep_count_)
+        {
+            continue;
+        }
+
+        csv << frames_[slot].sweep_count_ << "," << frames_[slot].timestamp_ns_ << "," << frames_[slot].capture_ns_;
+
+        const float* frame = amplitudes_ + (slot * column_count_);
+        for (uint64_t column = 0; column < column_count_; column++)
+        {
+            csv << "," << frame[column];
+        }
+        csv << "\n";
+
+        frames_written++;
+    }
+
+    std::cout << "Exported " << frames_written << " sweeps of history to " << path << std::endl;
+
+    return csv.good();
+}
+
+int32_t sdr::SweepHistory::findSlot(uint64_t sweep_count)
+{
+    if ( ! sweep_count)
+    {
+        return -1;
+    }
+
+    for (uint16_t slot = 0; slot < depth_; slot++)
+    {
+        if (frames_[slot].sweep_count_ == sweep_count)
+        {
+            return slot;
+        }
+    }
+
+    return -1;
+}
@@ -0,0 +1,62 @@
+#ifndef WAVEGUIDE_SDR_SWEEPHISTORY_H
+#define WAVEGUIDE_SDR_SWEEPHISTORY_H
+
+#include <mutex>
+#include <string>
+#include <cstdint>
+
+namespace sdr {
+
+    // Fixed depth ring of the amplitudes of the most recent completed sweeps, so that time-sliced views can show what
+    // each sweep actually measured rather than the live bins. Each frame holds one amplitude per column, where a column
+    // averages coalesce_factor neighbouring frequency bins to bound the memory used. All frames are allocated up front
+    // and publishing a sweep is a single copy into the oldest slot.
+    class SweepHistory {
+    public:
+        SweepHistory(uint64_t start_freq_hz, double bin_bw_hz, uint64_t bin_count, uint32_t coalesce_factor, uint16_t depth);
+        ~SweepHistory();
+
+        uint16_t getDepth();
+        uint32_t getCoalesceFactor();
+        uint64_t getColumnCount();
+
+        // Stores a frame of getColumnCount() amplitudes (in dB) for sweep_count, replacing the oldest frame.
+        void publish(uint64_t sweep_count, int64_t timestamp_ns, int64_t capture_ns, const float* amplitudes);
+
+        // Gets the sweep count of the newest frame (0 if nothing has been published).
+        uint64_t getNewestSweepCount();
+
+        // Gets the average amplitude of the columns covering bin_count bins from first_bin in the frame for sweep_count.
+        // Returns false if the frame has been replaced (or was never published).
+        bool getAmplitude(uint64_t sweep_count, uint64_t first_bin, uint64_t bin_count, float& amplitude);
+
+        // Writes every held frame, oldest first, to path as CSV with a row per sweep and a column per frequency.
+        bool exportCsv(const std::string& path);
+
+    private:
+        typedef struct
+        {
+            uint64_t sweep_count_;          // 0 while the slot is unused
+            int64_t timestamp_ns_;          // CLOCK_REALTIME when the sweep completed
+            int64_t capture_ns_;            // CLOCK_REALTIME when its last vector was captured (see sdr::SliceCapture)
+        } FrameInfo;
+
+        // Gets the slot holding sweep_count, or -1 if it isn't held.
+        int32_t findSlot(uint64_t sweep_count);
+
+        uint64_t start_freq_hz_;
+        double bin_bw_hz_;
+        uint64_t bin_count_;
+        uint32_t coalesce_factor_;
+        uint64_t column_count_;
+        uint16_t depth_;
+
+        std::mutex lock_;                   // guards everything below
+        float* amplitudes_;                 // depth_ frames of column_count_ amplitudes
+        FrameInfo* frames_;
+        uint16_t next_slot_;
+    };
+
+}
+
+#endif //WAVEGUIDE_SDR_SWEEPHISTORY_H
@@ -1,22 +1,44 @@
 #include "VectorSinkBlock.h"
 
 #include <cmath>
+#include <ctime>
+#include <vector>
+#include <algorithm>
 
-sdr::VectorSinkBlock::VectorSinkBlock(std::string name, size_t vector_length, double bin_bw_hz, SpectrumSamples* samples) :
+#include <pmt/pmt.h>
+#include <gnuradio/tags.h>
+
+// Key of the tags (sent by some devices, ie. UHD) holding the device time of the sample they're attached to, as a tuple
+// of whole seconds and fractional seconds.
+#define RX_TIME_TAG "rx_time"
+
+sdr::VectorSinkBlock::VectorSinkBlock(std::string name, size_t vector_length, double bin_bw_hz, SpectrumSamples* samples, SamplerStats* stats,
+                                      double vectors_per_sec) :
         gr::block(name, gr::io_signature::make(1, 1, sizeof(float) * vector_length), gr::io_signature::make(0, 0, 0)),
-        vector_length_(vector_length), bin_bw_hz_(bin_bw_hz), samples_(samples)
+        vector_length_(vector_length), bin_bw_hz_(bin_bw_hz), samples_(samples), stats_(stats)
 {
     save_samples_ = false;
+    discard_vectors_ = 0;
     sweep_count_ = 0;
+    vectors_saved_ = 0;
+
+    vector_period_ns_ = (vectors_per_sec > 0.0) ? 1000000000.0 / vectors_per_sec : 0.0;
+    has_rx_time_ = false;
+    rx_time_offset_ = 0;
+    rx_time_ns_ = 0;
+
+    first_capture_ns_ = -1;
+    last_capture_ns_ = -1;
 }
 
 sdr::VectorSinkBlock::~VectorSinkBlock()
 {
 }
 
-sdr::VectorSinkBlock::sptr sdr::VectorSinkBlock::make(std::string block_name, size_t vector_length, double bin_bw_hz, SpectrumSamples* samples)
+sdr::VectorSinkBlock::sptr sdr::VectorSinkBlock::make(std::string block_name, size_t vector_length, double bin_bw_hz, SpectrumSamples* samples, SamplerStats* stats,
+                                                      double vectors_per_sec)
 {
-    return boost::shared_ptr<sdr::VectorSinkBlock>(new VectorSinkBlock(block_name, vector_length, bin_bw_hz, samples));
+    return boost::shared_ptr<sdr::VectorSinkBlock>(new VectorSinkBlock(block_name, vector_length, bin_bw_hz, samples, stats, vectors_per_sec));
 }
 
 int sdr::VectorSinkBlock::general_work(int noutput_items, gr_vector_int &ninput_items,
@@ -24,14 +46,50 @@ int sdr::VectorSinkBlock::general_work(int noutput_items, gr_vector_int &ninput_
 {
     int vector_count = ninput_items[0];
     const float* vectors = static_cast<const float*>(input_items[0]);
+    bool save_samples = save_samples_;
+
+    // Vectors from before the latest retune are dropped, only the sink takes from the count once it's set
+    int discarded = 0;
+    uint32_t discard_vectors = save_samples ? discard_vectors_.load(std::memory_order_acquire) : 0;
+    if (discard_vectors)
+    {
+        discarded = std::min<int>(vector_count, static_cast<int>(discard_vectors));
+        discard_vectors_.fetch_sub(discarded, std::memory_order_relaxed);
+    }
+
+    if (stats_)
+    {
+        stats_->addVectors(discarded, false);
+        stats_->addVectors(vector_count - discarded, save_samples);
+    }
+
+    // The last vector is taken to have just been captured, earlier vectors one vector period before each other
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    int64_t arrived_ns = (static_cast<int64_t>(now.tv_sec) * 1000000000) + now.tv_nsec;
+
+    uint64_t first_offset = nitems_read(0);
+    uint64_t last_offset = first_offset + vector_count - 1;
+    readRxTime(first_offset, vector_count);
 
-    if (save_samples_)
+    if (save_samples && vector_count > discarded)
     {
-        for (int vector = 0; vector < vector_count; vector++)
+        int64_t unset_ns = -1;
+        first_capture_ns_.compare_exchange_strong(unset_ns, getCaptureTime(first_offset + discarded, last_offset, arrived_ns), std::memory_order_relaxed);
+        last_capture_ns_.store(getCaptureTime(last_offset, last_offset, arrived_ns), std::memory_order_relaxed);
+    }
+
+    if (save_samples && vector_count > discarded)
+    {
+        samples_->updateOccupancyBucket();
+
+        for (int vector = discarded; vector < vector_count; vector++)
         {
             const float* current_vector = vectors + (vector * vector_length_);
             updateSamples(current_vector);
         }
+
+        vectors_saved_.fetch_add(vector_count - discarded, std::memory_order_release);
     }
 
     consume_each(vector_count);
@@ -39,12 +97,58 @@ int sdr::VectorSinkBlock::general_work(int noutput_items, gr_vector_int &ninput_
     return 0;
 }
 
-void sdr::VectorSinkBlock::setCurrentFrequencyRange(uint64_t start_fft_freq_hz, uint64_t start_freq_hz, uint64_t end_freq_hz)
+void sdr::VectorSinkBlock::readRxTime(uint64_t offset, int count)
+{
+    std::vector<gr::tag_t> tags;
+    get_tags_in_range(tags, 0, offset, offset + count, pmt::string_to_symbol(RX_TIME_TAG));
+
+    if (tags.empty())
+    {
+        return;
+    }
+
+    const gr::tag_t& tag = tags.back();
+    if ( ! pmt::is_tuple(tag.value) || pmt::length(tag.value) != 2)
+    {
+        return;
+    }
+
+    uint64_t secs = pmt::to_uint64(pmt::tuple_ref(tag.value, 0));
+    double fractional_secs = pmt::to_double(pmt::tuple_ref(tag.value, 1));
+
+    rx_time_ns_ = (static_cast<int64_t>(secs) * 1000000000) + static_cast<int64_t>(fractional_secs * 1000000000.0);
+    rx_time_offset_ = tag.offset;
+    has_rx_time_ = true;
+}
+
+int64_t sdr::VectorSinkBlock::getCaptureTime(uint64_t offset, uint64_t last_offset, int64_t last_arrived_ns)
+{
+    if (has_rx_time_)
+    {
+        return rx_time_ns_ + static_cast<int64_t>((static_cast<int64_t>(offset) - static_cast<int64_t>(rx_time_offset_)) * vector_period_ns_);
+    }
+
+    return last_arrived_ns - static_cast<int64_t>((last_offset - offset) * vector_period_ns_);
+}
+
+bool sdr::VectorSinkBlock::takeCaptureTimes(int64_t& first_capture_ns, int64_t& last_capture_ns)
+{
+    first_capture_ns = first_capture_ns_.exchange(-1, std::memory_order_relaxed);
+    last_capture_ns = last_capture_ns_.exchange(-1, std::memory_order_relaxed);
+
+    return has_rx_time_;
+}
+
+void sdr::VectorSinkBlock::setCurrentFrequencyRange(uint64_t start_fft_freq_hz, uint64_t start_freq_hz, uint64_t end_freq_hz, uint32_t discard_vectors)
 {
     start_fft_freq_hz_ = start_fft_freq_hz;
     start_freq_hz_ = start_freq_hz;
     end_freq_hz_ = end_freq_hz;
 
+    first_capture_ns_ = -1;
+    last_capture_ns_ = -1;
+    discard_vectors_.store(discard_vectors, std::memory_order_release);
+
     setSaveSamples(true);
 }
 
@@ -58,8 +162,15 @@ void sdr::VectorSinkBlock::setSweepCount(uint64_t sweep_count)
     sweep_count_ = sweep_count;
 }
 
+uint64_t sdr::VectorSinkBlock::getVectorsSaved()
+{
+    return vectors_saved_.load(std::memory_order_acquire);
+}
+
 void sdr::VectorSinkBlock::updateSamples(const float* scanned_amplitudes)
 {
+    uint64_t first_bin = UINT64_MAX, last_bin = 0;
+
     for (size_t i = 0; i < vector_length_; i++)
     {
         // TODO: Normalise the amplitude across all FFTs, not just this one
@@ -69,9 +180,18 @@ void sdr::VectorSinkBlock::updateSamples(const float* scanned_amplitudes)
 
         if (freq_hz >= start_freq_hz_ && freq_hz <= end_freq_hz_)
         {
-            samples_->setLatestSample(freq_hz, amplitude, sweep_count_);
+            uint64_t bin_number = samples_->getBinNumber(freq_hz);
+            samples_->setLatestSampleForBin(bin_number, amplitude, sweep_count_, stats_);
+
+            first_bin = std::min(first_bin, bin_number);
+            last_bin = std::max(last_bin, bin_number);
         }
     }
+
+    if (first_bin <= last_bin)
+    {
+        samples_->markBinsWritten(first_bin, (last_bin - first_bin) + 1);
+    }
 }
 
 /**
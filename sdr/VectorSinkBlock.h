@@ -2,38 +2,64 @@
 #define WAVEGUIDE_SDR_VECTORSINKBLOCK_H
 
 #include <string>
+#include <atomic>
 
 #include <gnuradio/block.h>
 
 #include "SpectrumSamples.h"
+#include "SamplerStats.h"
 
 namespace sdr {
 
     class VectorSinkBlock : public gr::block {
     public:
-        VectorSinkBlock(std::string block_name, size_t vector_length, double bin_bw_hz, SpectrumSamples* samples);
+        // vectors_per_sec is the rate vectors are captured at, used to work out when each vector was captured (0 if
+        // capture times aren't needed).
+        VectorSinkBlock(std::string block_name, size_t vector_length, double bin_bw_hz, SpectrumSamples* samples, SamplerStats* stats = nullptr,
+                        double vectors_per_sec = 0.0);
         virtual ~VectorSinkBlock();
 
         typedef boost::shared_ptr<VectorSinkBlock> sptr;
 
-        static sptr make(std::string block_name, size_t vector_length, double bin_bw_hz, SpectrumSamples* samples);
+        static sptr make(std::string block_name, size_t vector_length, double bin_bw_hz, SpectrumSamples* samples, SamplerStats* stats = nullptr,
+                         double vectors_per_sec = 0.0);
 
-        void setCurrentFrequencyRange(uint64_t start_fft_freq_hz, uint64_t start_freq_hz, uint64_t end_freq_hz);
+        // Starts saving the bins from start_freq_hz to end_freq_hz of an FFT starting at start_fft_freq_hz. The first
+        // discard_vectors received afterwards are dropped, as they were already in flight when the device was retuned.
+        void setCurrentFrequencyRange(uint64_t start_fft_freq_hz, uint64_t start_freq_hz, uint64_t end_freq_hz, uint32_t discard_vectors = 0);
 
         void setSaveSamples(bool save_samples);
         void setSweepCount(uint64_t sweep_count);
 
+        // Total vectors saved to samples_, used to mark sweeps when the device stays tuned to one frequency.
+        uint64_t getVectorsSaved();
+
+        // Gets when the first and last vectors saved since the frequency range was set (or since the previous call) were
+        // captured, then starts timing afresh. Times are from the device's rx_time tags when it sends them (returning
+        // true), otherwise CLOCK_MONOTONIC when each vector reached the sink. Both are -1 if nothing was saved.
+        bool takeCaptureTimes(int64_t& first_capture_ns, int64_t& last_capture_ns);
+
+        // Saves one vector of amplitudes as general_work() does, public so the sink can be driven without a flowgraph
+        // (ie. benchmarked).
+        void updateSamples(const float *scanned_amplitudes);
+
     private:
         virtual int general_work(int noutput_items, gr_vector_int &ninput_items, gr_vector_const_void_star &input_items,
                                  gr_vector_void_star &output_items);
 
-        void updateSamples(const float *scanned_amplitudes);
+        // Picks up the latest rx_time tag (if any) in the count vectors from offset.
+        void readRxTime(uint64_t offset, int count);
+
+        // Gets when the vector at offset (counted from the start of the stream) was captured.
+        int64_t getCaptureTime(uint64_t offset, uint64_t last_offset, int64_t last_arrived_ns);
         uint64_t getBinFrequency(size_t bin_id);
 
         size_t vector_length_;
 
         SpectrumSamples *samples_;
+        SamplerStats *stats_;               // optional, owned by the SampleThread
         volatile bool save_samples_;        // samples should be actively saved when received
+        std::atomic<uint32_t> discard_vectors_;     // still to be dropped since the frequency range was set
 
         uint64_t start_fft_freq_hz_;        // the FFT runs from this frequency to this + sample rate
         uint64_t start_freq_hz_;            // sample bins at or past this frequency
@@ -41,6 +67,15 @@ namespace sdr {
         double bin_bw_hz_;                  // each bin is this wide
 
         uint64_t sweep_count_;              // tracks value from SampleThread
+        std::atomic<uint64_t> vectors_saved_;
+
+        double vector_period_ns_;           // time to capture each vector (0 if unknown)
+        std::atomic<bool> has_rx_time_;     // an rx_time tag has been seen, capture times are from the device's clock
+        uint64_t rx_time_offset_;           // vector the latest rx_time tag was attached to
+        int64_t rx_time_ns_;                // and the device time it was captured at
+
+        std::atomic<int64_t> first_capture_ns_;
+        std::atomic<int64_t> last_capture_ns_;
     };
 }
 